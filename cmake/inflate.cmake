@@ -0,0 +1,35 @@
+cmake_minimum_required(VERSION 3.12)
+
+include(FetchContent)
+
+# Default LogContainer inflate backend, zlib is always built in
+set(BLF_INFLATE "zlib" CACHE STRING "Inflate backend: zlib, zlib-ng or libdeflate")
+set_property(CACHE BLF_INFLATE PROPERTY STRINGS zlib zlib-ng libdeflate)
+
+if(BLF_INFLATE STREQUAL "libdeflate")
+    set(LIBDEFLATE_BUILD_SHARED_LIB OFF CACHE BOOL "" FORCE)
+    set(LIBDEFLATE_BUILD_GZIP OFF CACHE BOOL "" FORCE)
+    set(LIBDEFLATE_COMPRESSION_SUPPORT OFF CACHE BOOL "" FORCE)
+    set(LIBDEFLATE_GZIP_SUPPORT OFF CACHE BOOL "" FORCE)
+    FetchContent_Declare(
+        libdeflate
+        GIT_REPOSITORY "https://github.com/ebiggers/libdeflate.git"
+        GIT_TAG "v1.19"
+    )
+    FetchContent_MakeAvailable(libdeflate)
+    set(BLF_INFLATE_LIBRARIES libdeflate_static)
+    set(BLF_INFLATE_INCLUDE_DIRS "${libdeflate_SOURCE_DIR}")
+    set(BLF_INFLATE_DEFINITIONS BLF_HAVE_LIBDEFLATE)
+elseif(BLF_INFLATE STREQUAL "zlib-ng")
+    # zlib-ng in native mode, its targets would clash with the bundled zlib when built here
+    find_path(ZLIB_NG_INCLUDE_DIR zlib-ng.h REQUIRED)
+    find_library(ZLIB_NG_LIBRARY NAMES z-ng zlib-ng REQUIRED)
+    add_library(zlib_ng UNKNOWN IMPORTED)
+    set_target_properties(zlib_ng PROPERTIES
+        IMPORTED_LOCATION "${ZLIB_NG_LIBRARY}"
+        INTERFACE_INCLUDE_DIRECTORIES "${ZLIB_NG_INCLUDE_DIR}")
+    set(BLF_INFLATE_LIBRARIES zlib_ng)
+    set(BLF_INFLATE_DEFINITIONS BLF_HAVE_ZLIB_NG)
+elseif(NOT BLF_INFLATE STREQUAL "zlib")
+    message(FATAL_ERROR "Unknown BLF_INFLATE backend: ${BLF_INFLATE}")
+endif()
@@ -3,827 +3,297 @@
   GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
 */
 
-#include <array>
-#include <codecvt>
-#include <cstring>
-#include <ctime>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
 #include <fstream>
-#include <iomanip>
 #include <iostream>
-#include <locale>
+#include <memory>
+#include <optional>
+#include <set>
+#include <vector>
 
-#include <Vector/BLF.h>
-#include <light_pcapng_ext.h>
-#include "endianness.h"
-#include <pcapng_exporter/lin.h>
-#include <pcapng_exporter/linktype.h>
 #include <pcapng_exporter/pcapng_exporter.hpp>
 #include <args.hxx>
 
-#include "channels.hpp"
-
-using namespace Vector::BLF;
-
-#define HAS_FLAG(var,pos) ((var) & (1<<(pos)))
-
-#define NANOS_PER_SEC 1000000000
-
-#define DIR_IN    1
-#define DIR_OUT   2
-
-// Enumerations
-enum class FlexRayPacketType
-{
-	FlexRayFrame = 1,    // FlexRay Frame
-	FlexRaySymbol = 2     // FlexRay Symbol
-};
-
-class CanFrame {
-private:
-	uint8_t raw[72] = { 0 };
-public:
-
-	uint32_t id() {
-		return ntoh32(*(uint32_t*)raw) & 0x1fffffff;
-	}
-
-	void id(uint32_t value) {
-		uint8_t id_flags = *raw & 0xE0;
-		*(uint32_t*)raw = hton32(value);
-		*raw |= id_flags;
-	}
-
-	bool ext() {
-		return (*raw & 0x80) != 0;
-	}
-	void ext(bool value) {
-		uint8_t masked = *raw & 0x7F;
-		*raw = masked | value << 7;
-	}
-
-	bool rtr() {
-		return (*raw & 0x40) != 0;
-	}
-	void rtr(bool value) {
-		uint8_t masked = *raw & 0xBF;
-		*raw = masked | value << 6;
-	}
-
-	bool err() {
-		return (*raw & 0x20) != 0;
-	}
-	void err(bool value) {
-		uint8_t masked = *raw & 0xDF;
-		*raw = masked | value << 5;
-	}
-
-	bool brs() {
-		return (*(raw + 5) & 0x01) != 0;
-	}
-	void brs(bool value) {
-		uint8_t masked = *(raw + 5) & 0xFE;
-		*(raw + 5) = masked | value << 0;
-	}
-
-	bool esi() {
-		return (*(raw + 5) & 0x02) != 0;
-	}
-	void esi(bool value) {
-		uint8_t masked = *(raw + 5) & 0xFD;
-		*(raw + 5) = masked | value << 1;
-	}
-
-	uint8_t len() {
-		return *(raw + 4);
-	}
-	void len(uint8_t value) {
-		*(raw + 4) = value;
+#include "writer_thread_sink.hpp"
+#include "checkpoint.hpp"
+#include "columnar_sink.hpp"
+#include "converter.hpp"
+#include "dedup_sink.hpp"
+#include "frame_filter.hpp"
+#include "inflate.hpp"
+#include "info.hpp"
+#include "outputs.hpp"
+#include "pcapng_sink.hpp"
+#include "placement.hpp"
+#include "trigger_sink.hpp"
+#include "serve.hpp"
+
+std::atomic<bool> interrupted(false);
+
+void on_interrupt(int) {
+	interrupted = true;
+}
+
+/* Appends the content of src to dst */
+bool append_file(const std::string& dst, const std::string& src) {
+	std::ifstream is(src, std::ios_base::in | std::ios_base::binary);
+	std::ofstream os(dst, std::ios_base::out | std::ios_base::binary | std::ios_base::app);
+	if (!is.is_open() || !os.is_open()) {
+		return false;
+	}
+	os << is.rdbuf();
+	return os.good();
+}
+
+/* Parses "N" or "<link>:N" with link one of can, lin, flexray, ethernet */
+bool parse_snaplen(const std::string& text, std::uint32_t& length, std::optional<std::uint16_t>& link_type) {
+	std::size_t colon = text.find(':');
+	link_type = std::nullopt;
+	if (colon != std::string::npos) {
+		std::uint16_t link;
+		if (!blf_converter::parse_link_type(text.substr(0, colon), link)) {
+			return false;
+		}
+		link_type = link;
 	}
-
-	const uint8_t* data() {
-		return raw + 8;
+	try {
+		length = (std::uint32_t)std::stoul(text.substr(colon == std::string::npos ? 0 : colon + 1));
 	}
-	void data(const uint8_t* value, size_t size) {
-		memcpy(raw + 8, value, size);
+	catch (std::exception&) {
+		return false;
 	}
-
-	const uint8_t* bytes() {
-		return raw;
-	}
-
-	const uint8_t size() {
-		return len() + 8;
-	}
-
-};
-
-template<class ObjectHeaderGeneric>
-std::uint64_t calculate_ts_res(ObjectHeaderGeneric* oh)
-{
-	uint64_t ts_resol = 0;
-	switch (oh->objectFlags) {
-	case ObjectHeader::ObjectFlags::TimeTenMics:
-		ts_resol = 100000;
-		break;
-	case ObjectHeader::ObjectFlags::TimeOneNans:
-		ts_resol = NANOS_PER_SEC;
-		break;
-	default:
-		fprintf(stderr, "ERROR: The timestamp format is unknown (not 10us nor ns)!\n");
-		break;
-	}
-	return ts_resol;
+	return true;
 }
 
-template<class ObjectHeaderGeneric>
-pcapng_exporter::frame_header generate_header(
-	ObjectHeaderGeneric* oh,
-	std::uint64_t date_offset_ns)
-{
-	pcapng_exporter::frame_header header = pcapng_exporter::frame_header();
-	header.channel_id = oh->channel;
-	header.timestamp_resolution = calculate_ts_res(oh);
-	uint64_t ts = (NANOS_PER_SEC / header.timestamp_resolution) * oh->objectTimeStamp + date_offset_ns;
-	header.timestamp.tv_sec = ts / NANOS_PER_SEC;
-	header.timestamp.tv_nsec = ts % NANOS_PER_SEC;
-	return header;
+void report_memory(const blf_converter::MemoryBudget& budget) {
+	fprintf(stderr, "Peak memory: %zu MiB resident, %zu MiB of %zu MiB buffered\n",
+		blf_converter::peak_rss() >> 20, budget.peak() >> 20, budget.limit() >> 20);
 }
 
-template <class ObjHeader>
-int write_packet(
-	pcapng_exporter::PcapngExporter exporter,
-	uint16_t link_type,
-	ObjHeader* oh,
-	uint32_t length,
-	const uint8_t* data,
-	uint64_t date_offset_ns,
-	uint32_t flags = 0,
-	uint32_t hw_channel = 0
-) {
-	light_packet_interface interface = { 0 };
-	interface.link_type = link_type;
-	auto channel_id = 100000 * hw_channel + oh->channel;
-	std::string name = std::to_string(channel_id);
-	char name_str[256] = { 0 };
-	memcpy(name_str, name.c_str(), sizeof(char) * std::min((size_t)255, name.length()));
-	interface.name = name_str;
-
-	uint64_t ts_resol = calculate_ts_res(oh);
-	if (ts_resol == 0) return -3;
-
-	/* since we convert to NS, we need to always set the output to NS */
-	interface.timestamp_resolution = NANOS_PER_SEC;
-
-	light_packet_header header = { 0 };
-	uint64_t ts = (NANOS_PER_SEC / ts_resol) * oh->objectTimeStamp + date_offset_ns;
-	header.timestamp.tv_sec = ts / NANOS_PER_SEC;
-	header.timestamp.tv_nsec = ts % NANOS_PER_SEC;
-	header.captured_length = length;
-	header.original_length = length;
-
-	exporter.write_packet(channel_id, interface, header, data);
-
-	return 0;
-}
-
-// CAN_MESSAGE = 1
-void write(pcapng_exporter::PcapngExporter exporter, CanMessage* obj, uint64_t date_offset_ns) {
-	CanFrame can;
-
-	can.id(obj->id);
-	can.rtr(HAS_FLAG(obj->flags, 7));
-	can.len(obj->dlc);
-	can.data(obj->data.data(), obj->data.size());
-
-	uint32_t flags = HAS_FLAG(obj->flags, 0) ? DIR_OUT : DIR_IN;
-	write_packet(exporter, LINKTYPE_CAN, obj, can.size(), can.bytes(), date_offset_ns, flags);
-}
-
-// CAN_MESSAGE2
-void write(pcapng_exporter::PcapngExporter exporter, CanMessage2* obj, uint64_t date_offset_ns) {
-	CanFrame can;
-
-	can.id(obj->id);
-	can.rtr(HAS_FLAG(obj->flags, 7));
-	can.len(obj->dlc);
-	can.data(obj->data.data(), obj->data.size());
-
-	uint32_t flags = HAS_FLAG(obj->flags, 0) ? DIR_OUT : DIR_IN;
-
-	write_packet(exporter, LINKTYPE_CAN, obj, can.size(), can.bytes(), date_offset_ns, flags);
-}
-
-template <class CanError>
-void write_can_error(pcapng_exporter::PcapngExporter exporter, CanError* obj, uint64_t date_offset_ns) {
-
-	CanFrame can;
-	can.err(true);
-	can.len(8);
-	write_packet(exporter, LINKTYPE_CAN, obj, can.size(), can.bytes(), date_offset_ns);
-}
-
-// CAN_ERROR = 2
-void write(pcapng_exporter::PcapngExporter exporter, CanErrorFrame* obj, uint64_t date_offset_ns) {
-
-	write_can_error(exporter, obj, date_offset_ns);
-}
-
-// CAN_ERROR_EXT = 73
-void write(pcapng_exporter::PcapngExporter exporter, CanErrorFrameExt* obj, uint64_t date_offset_ns) {
-
-	write_can_error(exporter, obj, date_offset_ns);
-}
-
-// CAN_FD_MESSAGE = 100
-void write(pcapng_exporter::PcapngExporter exporter, CanFdMessage* obj, uint64_t date_offset_ns) {
-
-	CanFrame can;
-
-	can.id(obj->id);
-
-	can.rtr(HAS_FLAG(obj->flags, 7));
-
-	can.esi(HAS_FLAG(obj->canFdFlags, 2));
-	can.brs(HAS_FLAG(obj->canFdFlags, 1));
-
-	can.len(obj->validDataBytes);
-	can.data(obj->data.data(), obj->data.size());
-
-	uint32_t flags = HAS_FLAG(obj->flags, 0) ? DIR_OUT : DIR_IN;
-
-	write_packet(exporter, LINKTYPE_CAN, obj, can.size(), can.bytes(), date_offset_ns, flags);
-}
-
-// CAN_FD_MESSAGE_64 = 101
-void write(pcapng_exporter::PcapngExporter exporter, CanFdMessage64* obj, uint64_t date_offset_ns) {
-
-	CanFrame can;
-
-	can.id(obj->id);
-
-	can.rtr(HAS_FLAG(obj->flags, 4));
-
-	can.esi(HAS_FLAG(obj->flags, 14));
-	can.brs(HAS_FLAG(obj->flags, 13));
-
-	can.len(obj->validDataBytes);
-	can.data(obj->data.data(), obj->data.size());
-
-	// TODO obj->crc
-
-	uint32_t flags = HAS_FLAG(obj->flags, 6) || HAS_FLAG(obj->flags, 7) ? DIR_OUT : DIR_IN;
+/// Objects converted and the time from the first object until the outputs are closed
+struct conversion_time {
+	std::uint64_t first_object = 0;
+	std::chrono::steady_clock::time_point started;
+	std::uint64_t objects = 0;
+	double seconds = 0;
 
-	write_packet(exporter, LINKTYPE_CAN, obj, can.size(), can.bytes(), date_offset_ns);
-}
-
-// CAN_FD_ERROR_64 = 104
-void write(pcapng_exporter::PcapngExporter exporter, CanFdErrorFrame64* obj, uint64_t date_offset_ns) {
-
-	write_can_error(exporter, obj, date_offset_ns);
-}
-
-// ETHERNET_FRAME = 71
-void write(pcapng_exporter::PcapngExporter exporter, EthernetFrame* obj, uint64_t date_offset_ns) {
-
-	uint32_t flags = 0;
-	switch (obj->dir)
-	{
-	case 0:
-		flags = DIR_IN;
-		break;
-	case 1:
-		flags = DIR_OUT;
-		break;
+	void start(const blf_converter::Converter& converter) {
+		first_object = converter.objects_read();
+		started = std::chrono::steady_clock::now();
 	}
-
-	std::vector<uint8_t> eth;
-	// Pre allocate to remove need of reallocation
-	eth.reserve(14 + 4 + obj->payLoad.size());
-
-	eth.insert(eth.end(), obj->destinationAddress.begin(), obj->destinationAddress.end());
-	eth.insert(eth.end(), obj->sourceAddress.begin(), obj->sourceAddress.end());
-
-	if (obj->tpid) {
-		std::array<uint8_t, 4> vlan = {
-			(uint8_t)(obj->tpid >> 8),
-			(uint8_t)obj->tpid,
-			(uint8_t)(obj->tci >> 8),
-			(uint8_t)obj->tci
-		};
-		eth.insert(eth.end(), vlan.begin(), vlan.end());
+	void stop(const blf_converter::Converter& converter) {
+		objects = converter.objects_read() - first_object;
+		seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
 	}
+};
 
-	eth.push_back((uint8_t)(obj->type >> 8));
-	eth.push_back((uint8_t)obj->type);
-
-	eth.insert(eth.end(), obj->payLoad.begin(), obj->payLoad.end());
-	
-	write_packet(exporter, LINKTYPE_ETHERNET, obj, eth.size(), eth.data(), date_offset_ns, flags);
+/* Prints the throughput, the inflate backend and the placement of the pipeline threads */
+void report_stats(const conversion_time& time) {
+	fprintf(stderr, "Converted %llu objects in %.3f s, %.0f objects/s\n", (unsigned long long)time.objects, time.seconds,
+		time.seconds > 0 ? time.objects / time.seconds : 0.0);
+	fprintf(stderr, "Inflate backend: %s\n", blf_converter::inflate_backend().c_str());
+	blf_converter::write_placement(std::cerr);
 }
 
-template <class TEthernetFrame>
-void write_ethernet_frame(pcapng_exporter::PcapngExporter exporter, TEthernetFrame* obj, uint64_t date_offset_ns) {
-	std::vector<uint8_t> eth(obj->frameData);
-
-	if (HAS_FLAG(obj->flags, 3)) {
-		uint8_t* crcPtr = (uint8_t*)&obj->frameChecksum;
-		std::vector<uint8_t> crc(crcPtr, crcPtr + 4);
-		eth.insert(eth.end(), crc.begin(), crc.end());
+/* Prints the counters of the pcapng interfaces, including those not in the Interface Statistics Blocks */
+void report_interfaces(const std::vector<blf_converter::interface_statistics>& interfaces) {
+	for (std::size_t id = 0; id < interfaces.size(); id++) {
+		const auto& stats = interfaces[id];
+		fprintf(stderr, "Interface %zu %s: %llu packets, %llu bytes, %llu error frames, %llu filtered, %llu dropped\n",
+			id, stats.name.c_str(), (unsigned long long)stats.packets, (unsigned long long)stats.bytes,
+			(unsigned long long)stats.errors, (unsigned long long)stats.filtered, (unsigned long long)stats.dropped);
 	}
-
-	uint32_t flags = 0;
-	switch (obj->dir)
-	{
-	case 0:
-		flags = DIR_IN;
-		break;
-	case 1:
-		flags = DIR_OUT;
-		break;
-	}
-
-	write_packet(exporter, LINKTYPE_ETHERNET, obj, (uint32_t)eth.size(), eth.data(), date_offset_ns, flags, obj->hardwareChannel);
-}
-
-// ETHERNET_FRAME_EX = 120
-void write(pcapng_exporter::PcapngExporter exporter, EthernetFrameEx* obj, uint64_t date_offset_ns) {
-
-	write_ethernet_frame(exporter, obj, date_offset_ns);
 }
 
-// ETHERNET_FRAME_FORWARDED = 121
-void write(pcapng_exporter::PcapngExporter exporter, EthernetFrameForwarded* obj, uint64_t date_offset_ns) {
-
-	write_ethernet_frame(exporter, obj, date_offset_ns);
+/* Parses stage=cpus, e.g. encoder=4-7 */
+bool parse_stage_cpus(const std::string& text, blf_converter::Stage& stage, std::vector<unsigned>& cpus) {
+	std::size_t equals = text.find('=');
+	return equals != std::string::npos
+		&& blf_converter::parse_stage(text.substr(0, equals), stage)
+		&& blf_converter::parse_cpu_list(text.substr(equals + 1), cpus);
 }
 
-void set_measurment_header(uint8_t& measurementHeader, FlexRayPacketType packetType, uint16_t channelMask = 0)
-{
-	/// Measurement Header (1 byte)
-	// TI[0..6]: Type Index
-	// 0x01: FlexRay Frame
-	// 0x02: FlexRay Symbol
-	switch (packetType)
-	{
-	case FlexRayPacketType::FlexRayFrame:
-		measurementHeader = 0x01;
-		break;
-	case FlexRayPacketType::FlexRaySymbol:
-		measurementHeader = 0x02;
-		break;
-	}
-	// CH: Channel, indicates the Channel
-	// 1	: Channel A
-	// 2/3	: Channel B
-	switch (channelMask)
-	{
-	case 1: /* Channel A */
-		break;
-	case 2: /* Channel B */
-	case 3: /* Channel B */
-		measurementHeader |= 0x80;
-		break;
+/* Prints the ranges skipped in recovery mode */
+void report_skipped(const blf_converter::Converter& converter) {
+	for (const auto& range : converter.skipped()) {
+		if (range.inflated) {
+			fprintf(stderr, "Skipped %llu bytes at offset %llu of the container at offset %lld\n",
+				(unsigned long long)range.length, (unsigned long long)range.inflated_offset, (long long)range.offset);
+		}
+		else {
+			fprintf(stderr, "Skipped %llu bytes at offset %lld\n", (unsigned long long)range.length, (long long)range.offset);
+		}
 	}
 }
 
-void set_header_crc(uint16_t channelMask, uint16_t headerCrc1, uint16_t headerCrc2, uint16_t& headerCrc)
-{
-	// CH: Channel, indicates the Channel
-	// 1	: Channel A
-	// 2/3	: Channel B
-	switch (channelMask)
-	{
-	case 1: /* Channel A */
-		headerCrc = headerCrc1;
-		break;
-	case 2: /* Channel B */
-	case 3: /* Channel B */
-		headerCrc = headerCrc2;
-		break;
-	}
-}
+/// Objects around which frames are kept, see TriggerSink
+struct trigger_settings {
+	std::set<Vector::BLF::ObjectType> types;
+	std::uint64_t pre_ns = 0;
+	std::uint64_t post_ns = 0;
+};
 
-void set_header_flags(uint16_t frameState, uint8_t& headerFlags)
-{
-	if (HAS_FLAG(frameState, 0))
-	{
-		headerFlags |= 0x08; // Payload preample indicator bit set to 1
-	}
-	if (HAS_FLAG(frameState, 1))
-	{
-		headerFlags |= 0x02; // Sync. frame indicator bit set to 1
-	}
-	if (HAS_FLAG(frameState, 2))
-	{
-		headerFlags |= 0x10; // Reserved bit set to 1
-	}
-	if (!HAS_FLAG(frameState, 3))
-	{
-		headerFlags |= 0x04; // Null frame indicator bit set to 1
+/* Wraps sink so only the frames around trigger objects reach it, sink itself without triggers */
+std::unique_ptr<blf_converter::FrameSink> with_trigger(blf_converter::Converter& converter,
+	std::unique_ptr<blf_converter::FrameSink> sink, const trigger_settings& trigger) {
+	if (trigger.types.empty()) {
+		return sink;
+	}
+	auto trigger_sink = std::make_unique<blf_converter::TriggerSink>(std::move(sink), trigger.pre_ns, trigger.post_ns);
+	blf_converter::TriggerSink* target = trigger_sink.get();
+	converter.on_trigger(trigger.types, [target](std::uint64_t ns) { target->trigger(ns); });
+	return trigger_sink;
+}
+
+/* Wraps sink so frames repeated by later segments are dropped, see DedupSink */
+std::unique_ptr<blf_converter::FrameSink> with_dedup(std::unique_ptr<blf_converter::FrameSink> sink,
+	std::uint64_t window_ns, blf_converter::DedupSink*& dedup) {
+	if (window_ns == 0) {
+		dedup = nullptr;
+		return sink;
+	}
+	auto dedup_sink = std::make_unique<blf_converter::DedupSink>(std::move(sink), window_ns);
+	dedup = dedup_sink.get();
+	return dedup_sink;
+}
+
+/* Converts the opened file, then each further segment into the same sink */
+bool run_segments(blf_converter::Converter& converter, blf_converter::FrameSink& sink,
+	const std::vector<std::string>& segments, blf_converter::DedupSink* dedup) {
+	bool complete = converter.run(sink);
+	for (const auto& segment : segments) {
+		converter.close();
+		if (!converter.open(segment)) {
+			std::cerr << "Unable to open: " << segment << std::endl;
+			return false;
+		}
+		if (dedup) {
+			dedup->next_segment();
+		}
+		complete = converter.run(sink) && complete;
 	}
-	if (HAS_FLAG(frameState, 4))
-	{
-		headerFlags |= 0x01; // Startup frame indicator bit set to 1
+	if (dedup) {
+		std::cerr << "Dropped " << dedup->dropped() << " repeated frames" << std::endl;
 	}
+	return complete;
 }
 
-void set_header_flags_rcv_msg(uint32_t frameFlags, uint8_t& headerFlags)
-{
-	if (!HAS_FLAG(frameFlags, 0))
-	{
-		headerFlags |= 0x04; // Null frame indicator bit set to 1
-	}
-	if (HAS_FLAG(frameFlags, 2))
-	{
-		headerFlags |= 0x02; // Sync. frame indicator bit set to 1
-	}
-	if (HAS_FLAG(frameFlags, 3))
-	{
-		headerFlags |= 0x01; // Startup frame indicator bit set to 1
-	}
-	if (HAS_FLAG(frameFlags, 4))
-	{
-		headerFlags |= 0x08; // Payload preample indicator bit set to 1
-	}
-	if (HAS_FLAG(frameFlags, 5))
-	{
-		headerFlags |= 0x10; // Reserved bit set to 1
-	}
-}
+/// Options shared by the single and the multiple output conversion
+struct conversion_settings {
+	bool follow = false;
+	bool prescan = false;
+	trigger_settings trigger;
+	/// Files converted after infile into the same outputs
+	std::vector<std::string> segments;
+	/// Overlap of consecutive segments, 0 to keep repeated frames
+	std::uint64_t dedup_ns = 0;
+	/// Set when decimation or truncation makes the output smaller than the input
+	bool reduced = false;
+};
 
-void set_header(uint64_t& header, uint8_t headerFlags, uint64_t payloadLength, uint8_t cycleCount = 0, uint16_t frameId = 0, uint16_t headerCrc = 0)
-{
-	header = (static_cast<uint64_t>(headerFlags) << 35) | (static_cast<uint64_t>(payloadLength & 0x7F) << 17);
-	if (cycleCount != 0)
-	{
-		header |= static_cast<uint64_t>(cycleCount & 0x3F);
-	}
-	if (frameId != 0)
-	{
-		header |= (static_cast<uint64_t>(frameId & 0x07FF) << 24);
-	}
-	if (headerCrc != 0)
-	{
-		header |= (static_cast<uint64_t>(headerCrc & 0x07FF) << 6);
+/* Size to preallocate for a pcapng output, 0 unless it holds all frames of infile only */
+std::uint64_t preallocate_size(const blf_converter::Converter& converter, const conversion_settings& settings) {
+	if (settings.follow || settings.reduced || !settings.trigger.types.empty() || !settings.segments.empty()) {
+		return 0;
 	}
-
-	// Convert from Host Byte Order to Network Byte Order (network order is big endian)
-	header = hton64(header);
-}
-
-// FLEXRAY_DATA = 29
-void write(pcapng_exporter::PcapngExporter exporter, FlexRayData* obj, uint64_t date_offset_ns) {
-
-	uint64_t header = 0;
-	uint8_t headerFlags = 0;
-	std::array<uint8_t, 261> flexrayData;
-
-	memset(&flexrayData, 0, sizeof(flexrayData));
-
-	/// Measurement Header (1 byte)
-	set_measurment_header(flexrayData[0], FlexRayPacketType::FlexRayFrame);
-
-	/// Error Flags Information (1 byte) -> set to 0
-
-	/// FlexRay Frame Header (5 bytes)
-	//  - Header flags
-	headerFlags |= 0x04; // Null Frame: False (indicator bit set to 1)
-	//  - Payload length
-	uint64_t len = obj->dataBytes.size() / 2;
-	set_header(header, headerFlags, len, 0, obj->messageId, obj->crc);
-
-	// Copy only 5 bytes of header to flexrayData
-	uint8_t* headerPtr = (uint8_t*)&header;
-	memcpy(&flexrayData[2], headerPtr + 3, 5);
-
-	// FlexRay Frame Payload (0-254 bytes)
-	std::copy(obj->dataBytes.begin(), obj->dataBytes.end(), flexrayData.begin() + 7);
-
-	write_packet(exporter, LINKTYPE_FLEXRAY, obj, obj->dataBytes.size() + 7, flexrayData.data(), date_offset_ns);
+	// Unfiltered pcapng has about the size of the uncompressed BLF objects
+	return converter.statistics().uncompressedFileSize;
 }
 
-// FLEXRAY_SYNC = 30
-void write(pcapng_exporter::PcapngExporter exporter, FlexRaySync* obj, uint64_t date_offset_ns) {
-
-	uint64_t header = 0;
-	uint8_t headerFlags = 0;
-	std::array<uint8_t, 261> flexrayData;
-
-	memset(&flexrayData, 0, sizeof(flexrayData));
-
-	/// Measurement Header (1 byte)
-	set_measurment_header(flexrayData[0], FlexRayPacketType::FlexRayFrame);
-
-	/// Error Flags Information (1 byte) -> set to 0
-
-	/// FlexRay Frame Header (5 bytes)
-	//  - Header flags
-	headerFlags |= 0x04; // Null Frame: False (indicator bit set to 1)
-	headerFlags |= 0x02; // Sync. frame indicator bit set to 1
-
-	/// FlexRay Frame Header (5 bytes)
-	//  - Payload length
-	uint64_t len = obj->dataBytes.size() / 2;
-	set_header(header, headerFlags, len, obj->cycle, obj->messageId, obj->crc);
-
-	// Copy only 5 bytes of header to flexrayData
-	uint8_t* headerPtr = (uint8_t*)&header;
-	memcpy(&flexrayData[2], headerPtr + 3, 5);
-
-	// FlexRay Frame Payload (0-254 bytes)
-	std::copy(obj->dataBytes.begin(), obj->dataBytes.end(), flexrayData.begin() + 7);
-
-	write_packet(exporter, LINKTYPE_FLEXRAY, obj, obj->dataBytes.size() + 7, flexrayData.data(), date_offset_ns);
-}
-
-// FLEXRAY_CYCLE = 40
-void write(pcapng_exporter::PcapngExporter exporter, FlexRayV6StartCycleEvent* obj, uint64_t date_offset_ns) {
-
-	uint64_t header = 0;
-	uint8_t headerFlags = 0;
-	std::array<uint8_t, 261> flexrayData;
-
-	memset(&flexrayData, 0, sizeof(flexrayData));
-
-	/// Measurement Header (1 byte)
-	set_measurment_header(flexrayData[0], FlexRayPacketType::FlexRayFrame);
-
-	/// Error Flags Information (1 byte) -> set to 0
-
-	/// FlexRay Frame Header (5 bytes)
-	//  - Header flags
-	headerFlags |= 0x04; // Null Frame: False (indicator bit set to 1)
-	//  - Payload length
-	uint64_t len = obj->dataBytes.size() / 2;
-	set_header(header, headerFlags, len);
-
-	// Copy only 5 bytes of header to flexrayData
-	uint8_t* headerPtr = (uint8_t*)&header;
-	memcpy(&flexrayData[2], headerPtr + 3, 5);
-
-	// FlexRay Frame Payload (0-254 bytes)
-	std::copy(obj->dataBytes.begin(), obj->dataBytes.end(), flexrayData.begin() + 7);
-
-	write_packet(exporter, LINKTYPE_FLEXRAY, obj, obj->dataBytes.size() + 7, flexrayData.data(), date_offset_ns);
-}
-
-// FLEXRAY_MESSAGE = 41
-void write(pcapng_exporter::PcapngExporter exporter, FlexRayV6Message* obj, uint64_t date_offset_ns) {
-
-	uint64_t header = 0;
-	uint8_t headerFlags = 0;
-	std::array<uint8_t, 261> flexrayData;
-
-	memset(&flexrayData, 0, sizeof(flexrayData));
-
-	/// Measurement Header (1 byte)
-	set_measurment_header(flexrayData[0], FlexRayPacketType::FlexRayFrame);
-
-	/// Error Flags Information (1 byte) -> set to 0
-
-	/// FlexRay Frame Header (5 bytes)
-	set_header_flags(obj->frameState, headerFlags);
-	uint64_t len = obj->dataBytes.size() / 2;
-	set_header(header, headerFlags, len, obj->cycle, obj->frameId, obj->headerCrc);
-
-	// Copy only 5 bytes of header to flexrayData
-	uint8_t* headerPtr = (uint8_t*)&header;
-	memcpy(&flexrayData[2], headerPtr + 3, 5);
-
-	// FlexRay Frame Payload (0-254 bytes)
-	std::copy(obj->dataBytes.begin(), obj->dataBytes.end(), flexrayData.begin() + 7);
-
-	write_packet(exporter, LINKTYPE_FLEXRAY, obj, obj->dataBytes.size() + 7, flexrayData.data(), date_offset_ns);
-}
-
-// FR_ERROR = 47
-void write(pcapng_exporter::PcapngExporter exporter, FlexRayVFrError* obj, uint64_t date_offset_ns) {
-
-	uint64_t header = 0;
-	uint8_t headerFlags = 0;
-	std::array<uint8_t, 7> flexrayData;
-
-	memset(&flexrayData, 0, sizeof(flexrayData));
-
-	/// Measurement Header (1 byte)
-	set_measurment_header(flexrayData[0], FlexRayPacketType::FlexRayFrame, obj->channelMask);
-
-	/// Error Flags Information (1 byte)
-	flexrayData[1] |= 0x02; // Coding error bit (CODERR) set to 1
-
-	/// FlexRay Frame Header (5 bytes)
-	//  - Header flags
-	headerFlags |= 0x04; // Null Frame: False (indicator bit set to 1)
-	set_header(header, headerFlags, 0, obj->cycle);
-
-	// Copy only 5 bytes of header to flexrayData
-	uint8_t* headerPtr = (uint8_t*)&header;
-	memcpy(&flexrayData[2], headerPtr + 3, 5);
-
-	/// FlexRay Frame Payload (0-254 bytes) -> no payload
-
-	write_packet(exporter, LINKTYPE_FLEXRAY, obj, 7, flexrayData.data(), date_offset_ns);
-}
-
-// FR_STATUS = 48
-void write(pcapng_exporter::PcapngExporter exporter, FlexRayVFrStatus* obj, uint64_t date_offset_ns) {
-
-	std::array<uint8_t, 2> flexraySymbolData;
-
-	memset(&flexraySymbolData, 0, sizeof(flexraySymbolData));
-
-	/// Measurement Header (1 byte)
-	set_measurment_header(flexraySymbolData[0], FlexRayPacketType::FlexRaySymbol, obj->channelMask);
-
-	/// Symbol length (1 byte)
-	if (obj->tag == 3) /* BUSDOCTOR */
-	{
-		flexraySymbolData[1] = obj->data[1] & 0xFF;
+/* Writes all outputs from one pass over the input */
+int convert_outputs(blf_converter::Converter& converter, const std::vector<blf_converter::output_spec>& outputs,
+	const std::string& channel_map, blf_converter::MemoryBudget& budget, const conversion_settings& settings, conversion_time& time) {
+	auto fanout = std::make_unique<blf_converter::FanoutSink>();
+	blf_converter::Summary summary;
+	bool summarize = false;
+	for (const auto& output : outputs) {
+		if (output.format == "summary") {
+			summarize = true;
+			continue;
+		}
+		std::uint64_t estimate = output.format == "pcapng" && !output.filtered ? preallocate_size(converter, settings) : 0;
+		auto output_sink = blf_converter::open_output(output, channel_map, &budget, estimate);
+		if (!output_sink) {
+			return 1;
+		}
+		fanout->add(std::move(output_sink));
 	}
-	if (obj->tag == 5) /* VN-Interface */
-	{
-		flexraySymbolData[1] = obj->data[0] & 0xFF;
+	blf_converter::DedupSink* dedup;
+	std::unique_ptr<blf_converter::FrameSink> sink = with_trigger(converter, std::move(fanout), settings.trigger);
+	sink = with_dedup(std::move(sink), settings.dedup_ns, dedup);
+	if (summarize) {
+		converter.collect_summary(&summary);
 	}
 
-	write_packet(exporter, LINKTYPE_FLEXRAY, obj, 2, flexraySymbolData.data(), date_offset_ns);
-}
-
-// FR_STARTCYCLE = 49
-void write(pcapng_exporter::PcapngExporter exporter, FlexRayVFrStartCycle* obj, uint64_t date_offset_ns) {
-
-	uint64_t header = 0;
-	uint8_t headerFlags = 0;
-	std::array<uint8_t, 19> flexrayData;
-
-	memset(&flexrayData, 0, sizeof(flexrayData));
-
-	/// Measurement Header (1 byte)
-	set_measurment_header(flexrayData[0], FlexRayPacketType::FlexRayFrame, obj->channelMask);
-
-	/// Error Flags Information (1 byte) -> set to 0
-
-	/// FlexRay Frame Header (5 bytes)
-	//  - Header flags
-	headerFlags |= 0x04; // Null Frame: False (indicator bit set to 1)
-	//  - Payload length
-	uint64_t len = obj->dataBytes.size() / 2;
-	set_header(header, headerFlags, len, obj->cycle);
-
-	// Copy only 5 bytes of header to flexrayData
-	uint8_t* headerPtr = (uint8_t*)&header;
-	memcpy(&flexrayData[2], headerPtr + 3, 5);
-
-	// FlexRay Frame Payload (0-254 bytes)
-	std::copy(obj->dataBytes.begin(), obj->dataBytes.end(), flexrayData.begin() + 7);
-
-	write_packet(exporter, LINKTYPE_FLEXRAY, obj, obj->dataBytes.size() + 7, flexrayData.data(), date_offset_ns);
-}
-
-// FR_RCVMESSAGE = 50
-void write(pcapng_exporter::PcapngExporter exporter, FlexRayVFrReceiveMsg* obj, uint64_t date_offset_ns) {
-
-	uint64_t header = 0;
-	uint16_t headerCrc = 0;
-	uint8_t headerFlags = 0;
-	std::array<uint8_t, 261> flexrayData;
-
-	memset(&flexrayData, 0, sizeof(flexrayData));
-
-	/// Measurement Header (1 byte)
-	set_measurment_header(flexrayData[0], FlexRayPacketType::FlexRayFrame, obj->channelMask);
-
-	/// Error Flags Information (1 byte) -> case Error flag (error frame or invalid frame) set to 1
-	if (HAS_FLAG(obj->frameFlags, 6))
-	{
-		flexrayData[1] |= 0x10; // FCRCERR bit set to 1
+	if (settings.prescan && !converter.prescan(*sink)) {
+		std::cerr << "Unable to read the metadata of the input" << std::endl;
+		return 1;
 	}
-
-	/// FlexRay Frame Header (5 bytes)
-	//  - Header flags
-	set_header_flags_rcv_msg(obj->frameFlags, headerFlags);
-	// 	- Header CRC
-	set_header_crc(obj->channelMask, obj->headerCrc1, obj->headerCrc2, headerCrc);
-	//  - Payload length
-	uint64_t len = obj->dataBytes.size() / 2;
-	set_header(header, headerFlags, len, obj->cycle, obj->frameId, headerCrc);
-
-	// Copy only 5 bytes of header to flexrayData
-	uint8_t* headerPtr = (uint8_t*)&header;
-	memcpy(&flexrayData[2], headerPtr + 3, 5);
-
-	// FlexRay Frame Payload (0-254 bytes)
-	std::copy(obj->dataBytes.begin(), obj->dataBytes.end(), flexrayData.begin() + 7);
-
-	write_packet(exporter, LINKTYPE_FLEXRAY, obj, obj->dataBytes.size() + 7, flexrayData.data(), date_offset_ns);
-}
-
-// FR_RCVMESSAGE_EX = 66
-void write(pcapng_exporter::PcapngExporter exporter, FlexRayVFrReceiveMsgEx* obj, uint64_t date_offset_ns) {
-
-	uint64_t header = 0;
-	uint16_t headerCrc = 0;
-	uint8_t headerFlags = 0;
-	uint8_t measurementHeader = 0;
-	uint8_t errorFlagsInfo = 0;
-	std::vector<uint8_t> flexrayData;
-
-	flexrayData.clear();
-
-	/// Measurement Header (1 byte)
-	set_measurment_header(measurementHeader, FlexRayPacketType::FlexRayFrame, obj->channelMask);
-
-	flexrayData.push_back(measurementHeader);
-
-	/// Error Flags Information (1 byte) -> case Error flag (error frame or invalid frame) set to 1
-	if (HAS_FLAG(obj->frameFlags, 6))
-	{
-		errorFlagsInfo |= 0x10; // FCRCERR bit set to 1
+	time.start(converter);
+	bool complete = true;
+	if (settings.follow) {
+		std::signal(SIGINT, on_interrupt);
+		converter.follow(*sink, interrupted);
+	}
+	else {
+		complete = run_segments(converter, *sink, settings.segments, dedup);
+	}
+	converter.close();
+	report_skipped(converter);
+	// Waits for the writers and closes the outputs
+	sink.reset();
+	time.stop(converter);
+
+	for (const auto& output : outputs) {
+		if (output.format == "summary") {
+			std::ofstream os(output.path);
+			summary.write_json(os);
+		}
 	}
-	flexrayData.push_back(errorFlagsInfo);
-
-	/// FlexRay Frame Header (5 bytes)
-	//  - Header flags
-	set_header_flags_rcv_msg(obj->frameFlags, headerFlags);
-	// 	- Header CRC
-	set_header_crc(obj->channelMask, obj->headerCrc1, obj->headerCrc2, headerCrc);
-	//  - Payload length
-	uint64_t len = obj->dataBytes.size() / 2;
-	set_header(header, headerFlags, len, obj->cycle, obj->frameId, headerCrc);
-
-	// Copy only 5 bytes of header to flexrayData
-	uint8_t* headerPtr = (uint8_t*)&header;
-	std::vector<uint8_t> headerVec(headerPtr + 3, headerPtr + 8);
-	flexrayData.insert(flexrayData.end(), headerVec.begin(), headerVec.end());
-
-	// FlexRay Frame Payload (0-254 bytes)
-	flexrayData.insert(flexrayData.end(), obj->dataBytes.begin(), obj->dataBytes.end());
-
-	write_packet(exporter, LINKTYPE_FLEXRAY, obj, obj->dataBytes.size() + 7, flexrayData.data(), date_offset_ns);
-}
-
-uint64_t calculate_startdate(Vector::BLF::File* infile) {
-	Vector::BLF::SYSTEMTIME startTime;
-	startTime = infile->fileStatistics.measurementStartTime;
-
-	struct tm tms = { 0 };
-	tms.tm_year = startTime.year - 1900;
-	tms.tm_mon = startTime.month - 1;
-	tms.tm_mday = startTime.day;
-	tms.tm_hour = startTime.hour;
-	tms.tm_min = startTime.minute;
-	tms.tm_sec = startTime.second;
-
-	time_t ret = mktime(&tms);
-
-	ret *= 1000;
-	ret += startTime.milliseconds;
-	ret *= 1000 * 1000;
-
-	return ret;
-}
-
-template<class LinErrorBase>
-int write_lin_error(
-	pcapng_exporter::PcapngExporter writer,
-	LinErrorBase* lerr,
-	std::uint8_t errors,
-	uint64_t date_offset_ns)
-{
-	pcapng_exporter::frame_header header = generate_header(lerr, date_offset_ns);
-	if (header.timestamp_resolution == 0) return -3;
-	lin_frame frame = lin_frame();
-	frame.errors = errors;
-	writer.write_lin(header, frame);
-	return 0;
-}
-
-template<class LinMessageBase>
-int write_lin_message(
-	pcapng_exporter::PcapngExporter writer,
-	LinMessageBase* msg,
-	uint64_t date_offset_ns)
-{
-	pcapng_exporter::frame_header header = generate_header(msg, date_offset_ns);
-	if (header.timestamp_resolution == 0) return -3;
-	lin_frame frame = lin_frame();
-	frame.pid = msg->id;
-	frame.payload_length = (std::uint8_t)(msg->data.size());
-	memcpy(frame.data, &(msg->data), frame.payload_length);
-	frame.checksum = msg->crc;
-	writer.write_lin(header, frame);
-	return 0;
+	return complete ? 0 : 1;
 }
 
 int main(int argc, char* argv[]) {
+	if (argc > 1 && std::string(argv[1]) == "serve") {
+		return blf_converter::serve_main(argc - 1, argv + 1);
+	}
+	if (argc > 1 && std::string(argv[1]) == "info") {
+		return blf_converter::info_main(argc - 1, argv + 1);
+	}
 	args::ArgumentParser parser("This tool is intended for converting BLF files to plain PCAPNG files.");
 	parser.helpParams.showTerminator = false;
 	parser.helpParams.proglineShowFlags = true;
 
 	args::HelpFlag help(parser, "help", "", { 'h', "help" }, args::Options::HiddenFromUsage);
 	args::ValueFlag<std::string> maparg(parser, "map-file", "Configuration file for channel mapping", { "channel-map" });
+	args::ValueFlag<std::string> formatarg(parser, "format", "Output format: pcapng (default) or columnar, which writes CAN and LIN columns to outfile.can.* and outfile.lin.*", { "format" }, "pcapng");
+	args::Flag followarg(parser, "follow", "Keep converting data appended to infile until it is complete", { "follow" });
+	args::ValueFlag<int> checkpointarg(parser, "seconds", "Save a checkpoint to outfile.checkpoint every N seconds", { "checkpoint" });
+	args::Flag resumearg(parser, "resume", "Continue from outfile.checkpoint, if present", { "resume" });
+	args::Flag recoverarg(parser, "recover", "Skip corrupt data and continue with the next valid object", { "recover" });
+	args::Flag prescanarg(parser, "prescan", "Read all channel metadata before converting, so no interface is named before its mapping is known", { "prescan" });
+	args::ValueFlagList<std::string> snaplenarg(parser, "[link:]bytes", "Truncate frames to this length, for one link type (can, lin, flexray, ethernet) if given", { "snaplen" });
+	args::ValueFlag<std::uint32_t> decimatearg(parser, "N", "Keep only every Nth message per channel and id, error frames are always kept", { "decimate" }, 1);
+	args::ValueFlag<double> maxratearg(parser, "hz", "Keep at most this many messages per second per channel and id", { "max-rate-per-id" }, 0);
+	args::ValueFlag<std::string> triggerarg(parser, "types", "Only keep frames around objects of these types, e.g. CanErrorFrame,CanFdErrorFrame64,FlexRayVFrError,LinCrcError", { "trigger" });
+	args::ValueFlag<std::string> prearg(parser, "duration", "Frames kept before each trigger, e.g. 500ms", { "pre" }, "0");
+	args::ValueFlag<std::string> postarg(parser, "duration", "Frames kept after each trigger, e.g. 2s", { "post" }, "0");
+	args::ValueFlagList<std::string> segmentarg(parser, "file", "Convert this BLF file after infile into the same output, for logger segments", { "segment" });
+	args::ValueFlag<std::string> deduparg(parser, "duration", "Drop frames repeated by the next segment within this overlap, e.g. 10s", { "dedup" });
+	args::ValueFlag<unsigned> threadsarg(parser, "threads", "Encode frames on N threads, 1 (default) encodes on the reading thread", { "threads" }, 1);
+	args::ValueFlag<std::string> inflatearg(parser, "backend", "Container inflate backend, one of the built in: zlib, zlib-ng, libdeflate", { "inflate" });
+	args::ValueFlagList<std::string> cpusarg(parser, "stage=cpus", "Pin the threads of a stage (reader, encoder, writer) to CPUs, e.g. encoder=4-7, buffers are then allocated on their NUMA node", { "cpus" });
+	args::Flag hugepagesarg(parser, "huge-pages", "Back the inflated containers with transparent huge pages (Linux)", { "huge-pages" });
+	args::Flag statsarg(parser, "stats", "Print the memory use, throughput, inflate backend and thread placement at the end", { "stats" });
+	args::ValueFlag<std::string> maxmemoryarg(parser, "size", "Limit the buffered data to e.g. 512M and report the peak memory use", { "max-memory" });
+	args::ValueFlagList<std::string> outputarg(parser, "spec", "Also write path[,format=pcapng|pcapng.gz|columnar|summary][,types=can+ethernet][,channels=1+2][,channel-map=file], all outputs from one pass", { "output" });
+	args::Flag summaryarg(parser, "summary", "Only print per channel and per id statistics as JSON, to outfile if given", { "summary" });
 
 	args::Positional<std::string> inarg(parser, "infile", "Input File", args::Options::Required);
-	args::Positional<std::string> outarg(parser, "outfile", "Output File", args::Options::Required);
+	args::Positional<std::string> outarg(parser, "outfile", "Output File");
 
 	try
 	{
@@ -841,181 +311,252 @@ int main(int argc, char* argv[]) {
 		return 1;
 	}
 
-	Vector::BLF::File infile;
-	infile.open(args::get(inarg));
-	if (!infile.is_open()) {
-		fprintf(stderr, "Unable to open: %s\n", argv[1]);
+	if (inflatearg && !blf_converter::set_inflate_backend(args::get(inflatearg))) {
+		std::cerr << "Inflate backend not available: " << args::get(inflatearg) << std::endl;
 		return 1;
 	}
-	pcapng_exporter::PcapngExporter exporter = pcapng_exporter::PcapngExporter(args::get(outarg), maparg.Get());
 
-	uint64_t startDate_ns = calculate_startdate(&infile);
+	for (const auto& text : args::get(cpusarg)) {
+		blf_converter::Stage stage;
+		std::vector<unsigned> cpus;
+		if (!parse_stage_cpus(text, stage, cpus)) {
+			std::cerr << "Invalid CPU placement: " << text << std::endl;
+			return 1;
+		}
+		blf_converter::set_stage_cpus(stage, std::move(cpus));
+	}
+	// Inflating happens on the reading thread, pinned before its buffers are first touched
+	blf_converter::pin_thread(blf_converter::Stage::Reader);
 
-	while (infile.good()) {
-		ObjectHeaderBase* ohb = nullptr;
+	blf_converter::Converter converter;
+	if (!converter.open(args::get(inarg))) {
+		fprintf(stderr, "Unable to open: %s\n", args::get(inarg).c_str());
+		return 1;
+	}
+	converter.recover(recoverarg);
+	converter.huge_pages(hugepagesarg);
+
+	blf_converter::MemoryBudget budget(maxmemoryarg ? blf_converter::parse_size(args::get(maxmemoryarg)) : 0);
+	if (maxmemoryarg && budget.limit() == 0) {
+		std::cerr << "Invalid memory size: " << args::get(maxmemoryarg) << std::endl;
+		return 1;
+	}
+	converter.memory_budget(&budget);
+	converter.threads(args::get(threadsarg));
+	converter.decimate(args::get(decimatearg), args::get(maxratearg));
+	for (const auto& snaplen : args::get(snaplenarg)) {
+		std::uint32_t length;
+		std::optional<std::uint16_t> link_type;
+		if (!parse_snaplen(snaplen, length, link_type)) {
+			std::cerr << "Invalid snap length: " << snaplen << std::endl;
+			return 1;
+		}
+		converter.snaplen(length, link_type);
+	}
+
+	conversion_settings settings;
+	settings.follow = followarg;
+	settings.prescan = prescanarg;
+	settings.reduced = args::get(decimatearg) > 1 || args::get(maxratearg) > 0 || !args::get(snaplenarg).empty();
+	trigger_settings& trigger = settings.trigger;
+	if (triggerarg) {
+		if (!blf_converter::parse_trigger_types(args::get(triggerarg), trigger.types)) {
+			std::cerr << "Invalid trigger types: " << args::get(triggerarg) << std::endl;
+			return 1;
+		}
+		if (!blf_converter::parse_duration(args::get(prearg), trigger.pre_ns) || !blf_converter::parse_duration(args::get(postarg), trigger.post_ns)) {
+			std::cerr << "Invalid duration: " << args::get(prearg) << ", " << args::get(postarg) << std::endl;
+			return 1;
+		}
+		if (summaryarg || checkpointarg || resumearg) {
+			std::cerr << "--trigger can not be combined with --summary, --checkpoint or --resume" << std::endl;
+			return 1;
+		}
+	}
+	settings.segments = args::get(segmentarg);
+	if (deduparg && !blf_converter::parse_duration(args::get(deduparg), settings.dedup_ns)) {
+		std::cerr << "Invalid duration: " << args::get(deduparg) << std::endl;
+		return 1;
+	}
+	if (!settings.segments.empty() && (summaryarg || checkpointarg || resumearg || followarg)) {
+		std::cerr << "--segment can not be combined with --summary, --checkpoint, --resume or --follow" << std::endl;
+		return 1;
+	}
 
-		/* read and capture exceptions, e.g. unfinished files */
-		try {
-			ohb = infile.read();
+	if (!outputarg.Get().empty()) {
+		if (summaryarg || checkpointarg || resumearg) {
+			std::cerr << "--output can not be combined with --summary, --checkpoint or --resume" << std::endl;
+			return 1;
 		}
-		catch (std::runtime_error& e) {
-			std::cout << "Exception: " << e.what() << std::endl;
+		std::vector<blf_converter::output_spec> outputs;
+		if (outarg) {
+			outputs.push_back({ args::get(outarg), args::get(formatarg) });
 		}
-		if (ohb == nullptr) {
-			break;
+		for (const auto& text : args::get(outputarg)) {
+			blf_converter::output_spec output;
+			std::string error;
+			if (!blf_converter::parse_output_spec(text, output, error)) {
+				std::cerr << error << std::endl;
+				return 1;
+			}
+			outputs.push_back(output);
 		}
-		/* Object */
-		std::uint8_t errors = 0;
-		switch (ohb->objectType) {
-
-		case ObjectType::CAN_MESSAGE:
-			write(exporter, reinterpret_cast<CanMessage*>(ohb), startDate_ns);
-			break;
-
-		case ObjectType::CAN_ERROR:
-			write(exporter, reinterpret_cast<CanErrorFrame*>(ohb), startDate_ns);
-			break;
-
-		case ObjectType::CAN_FD_MESSAGE:
-			write(exporter, reinterpret_cast<CanFdMessage*>(ohb), startDate_ns);
-			break;
-
-		case ObjectType::CAN_FD_MESSAGE_64:
-			write(exporter, reinterpret_cast<CanFdMessage64*>(ohb), startDate_ns);
-			break;
-
-		case ObjectType::CAN_FD_ERROR_64:
-			write(exporter, reinterpret_cast<CanFdErrorFrame64*>(ohb), startDate_ns);
-			break;
-
-		case ObjectType::ETHERNET_FRAME:
-			write(exporter, reinterpret_cast<EthernetFrame*>(ohb), startDate_ns);
-			break;
-
-		case ObjectType::CAN_ERROR_EXT:
-			write(exporter, reinterpret_cast<CanErrorFrameExt*>(ohb), startDate_ns);
-			break;
-
-		case ObjectType::CAN_MESSAGE2:
-			write(exporter, reinterpret_cast<CanMessage2*>(ohb), startDate_ns);
-			break;
-
-		case ObjectType::ETHERNET_FRAME_EX:
-			write(exporter, reinterpret_cast<EthernetFrameEx*>(ohb), startDate_ns);
-			break;
-
-		case ObjectType::ETHERNET_FRAME_FORWARDED:
-			write(exporter, reinterpret_cast<EthernetFrameForwarded*>(ohb), startDate_ns);
-			break;
-
-		case ObjectType::FLEXRAY_DATA:
-			write(exporter, reinterpret_cast<FlexRayData*>(ohb), startDate_ns);
-			break;
-
-		case ObjectType::FLEXRAY_SYNC:
-			write(exporter, reinterpret_cast<FlexRaySync*>(ohb), startDate_ns);
-			break;
-
-		case ObjectType::FLEXRAY_CYCLE:
-			write(exporter, reinterpret_cast<FlexRayV6StartCycleEvent*>(ohb), startDate_ns);
-			break;
-
-		case ObjectType::FLEXRAY_MESSAGE:
-			write(exporter, reinterpret_cast<FlexRayV6Message*>(ohb), startDate_ns);
-			break;
-
-		case ObjectType::FLEXRAY_STATUS:
-			// We do not have reliable BLF file or clear documentation for this type
-			break;
-
-		case ObjectType::FR_ERROR:
-			write(exporter, reinterpret_cast<FlexRayVFrError*>(ohb), startDate_ns);
-			break;
-
-		case ObjectType::FR_STATUS:
-			write(exporter, reinterpret_cast<FlexRayVFrStatus*>(ohb), startDate_ns);
-			break;
-
-		case ObjectType::FR_STARTCYCLE:
-			write(exporter, reinterpret_cast<FlexRayVFrStartCycle*>(ohb), startDate_ns);
-			break;
-
-		case ObjectType::FR_RCVMESSAGE:
-			write(exporter, reinterpret_cast<FlexRayVFrReceiveMsg*>(ohb), startDate_ns);
-			break;
-
-		case ObjectType::FR_RCVMESSAGE_EX:
-			write(exporter, reinterpret_cast<FlexRayVFrReceiveMsgEx*>(ohb), startDate_ns);
-			break;
-
-		case ObjectType::APP_TEXT:
-			configure_channels(&exporter, reinterpret_cast<AppText*>(ohb));
-			break;
-
-		case ObjectType::LIN_MESSAGE:
-			write_lin_message(exporter, reinterpret_cast<LinMessage*>(ohb), startDate_ns);
-			break;
-
-		case ObjectType::LIN_MESSAGE2:
-			write_lin_message(exporter, reinterpret_cast<LinMessage2*>(ohb), startDate_ns);
-			break;
-
-		case ObjectType::LIN_CRC_ERROR:
-			errors = LIN_ERROR_CHECKSUM;
-			write_lin_error(exporter, reinterpret_cast<LinCrcError*>(ohb), errors, startDate_ns);
-			break;
-
-		case ObjectType::LIN_CRC_ERROR2:
-			errors = LIN_ERROR_CHECKSUM;
-			write_lin_error(exporter, reinterpret_cast<LinCrcError2*>(ohb), errors, startDate_ns);
-			break;
-
-		case ObjectType::LIN_RCV_ERROR:
-			errors = LIN_ERROR_FRAMING;
-			write_lin_error(exporter, reinterpret_cast<LinReceiveError*>(ohb), errors, startDate_ns);
-			break;
-
-		case ObjectType::LIN_RCV_ERROR2:
-			errors = LIN_ERROR_FRAMING;
-			write_lin_error(exporter, reinterpret_cast<LinReceiveError2*>(ohb), errors, startDate_ns);
-			break;
-
-		case ObjectType::LIN_SLV_TIMEOUT:
-			errors = LIN_ERROR_NOSLAVE;
-			write_lin_error(exporter, reinterpret_cast<LinSlaveTimeout*>(ohb), errors, startDate_ns);
-			break;
-
-		case ObjectType::LIN_SND_ERROR:
-			errors = LIN_ERROR_FRAMING;
-			write_lin_error(exporter, reinterpret_cast<LinSendError*>(ohb), errors, startDate_ns);
-			break;
-
-		case ObjectType::LIN_SND_ERROR2:
-			errors = LIN_ERROR_FRAMING;
-			write_lin_error(exporter, reinterpret_cast<LinSendError2*>(ohb), errors, startDate_ns);
-			break;
-
-		case ObjectType::LIN_SYN_ERROR:
-			errors = LIN_ERROR_FRAMING;
-			write_lin_error(exporter, reinterpret_cast<LinSyncError*>(ohb), errors, startDate_ns);
-			break;
-
-		case ObjectType::LIN_SYN_ERROR2:
-			errors = LIN_ERROR_FRAMING;
-			write_lin_error(exporter, reinterpret_cast<LinSyncError2*>(ohb), errors, startDate_ns);
-			break;
-
-		default:
-#ifdef DEBUG
-			std::cerr << (std::uint32_t)(ohb->objectType) << " is not implemented." << std::endl;
-#endif
-			break;
+		conversion_time time;
+		int result = convert_outputs(converter, outputs, maparg.Get(), budget, settings, time);
+		if (maxmemoryarg || statsarg) {
+			report_memory(budget);
+		}
+		if (statsarg) {
+			report_stats(time);
+		}
+		return result;
+	}
+
+	if (summaryarg) {
+		blf_converter::Summary summary;
+		conversion_time time;
+		time.start(converter);
+		bool complete = converter.summarize(summary);
+		time.stop(converter);
+		converter.close();
+		if (outarg) {
+			std::ofstream os(args::get(outarg));
+			summary.write_json(os);
+		}
+		else {
+			summary.write_json(std::cout);
+		}
+		if (maxmemoryarg || statsarg) {
+			report_memory(budget);
+		}
+		if (statsarg) {
+			report_stats(time);
+		}
+		return complete ? 0 : 1;
+	}
+	if (!outarg) {
+		std::cerr << "Argument 'outfile' is required" << std::endl;
+		std::cerr << parser;
+		return 1;
+	}
+
+	std::string outfile = args::get(outarg);
+	std::string format = args::get(formatarg);
+	if (format != "pcapng" && format != "columnar") {
+		std::cerr << "Unknown format: " << format << std::endl;
+		return 1;
+	}
+	if (prescanarg && followarg) {
+		std::cerr << "--prescan can not be combined with --follow" << std::endl;
+		return 1;
+	}
+	if (format != "pcapng" && (checkpointarg || resumearg)) {
+		std::cerr << "Checkpoints are only supported for pcapng output" << std::endl;
+		return 1;
+	}
+
+	std::string checkpoint_path = outfile + ".checkpoint";
+	// A resumed run writes a new pcapng section to this file, appended to outfile at the end
+	std::string resume_path = outfile + ".resume";
 
+	blf_converter::checkpoint cp;
+	channel_state resumed_channels;
+	bool resume = resumearg && blf_converter::load_checkpoint(checkpoint_path, cp, resumed_channels);
+	if (resumearg && !resume) {
+		std::cerr << "No checkpoint found, converting from the start" << std::endl;
+	}
+	std::error_code ec;
+	if (resume) {
+		if (std::filesystem::exists(resume_path, ec)) {
+			// Output of a previous resumed run that did not complete
+			append_file(outfile, resume_path);
+		}
+		std::filesystem::resize_file(outfile, cp.output_offset, ec);
+		if (ec) {
+			std::cerr << "Unable to truncate " << outfile << ": " << ec.message() << std::endl;
+			return 1;
+		}
+	}
+	std::string output_path = resume ? resume_path : outfile;
+	std::uint64_t output_base = resume ? cp.output_offset : 0;
+
+	// Filled when the pcapng output is closed
+	std::vector<blf_converter::interface_statistics> interfaces;
+	std::unique_ptr<blf_converter::FrameSink> sink;
+	if (format == "columnar") {
+		auto columnar = std::make_unique<blf_converter::ColumnarSink>(outfile, &budget);
+		if (!columnar->is_open()) {
+			std::cerr << "Unable to create columnar files for " << outfile << std::endl;
+			return 1;
+		}
+		sink = std::move(columnar);
+	}
+	else {
+		auto pcapng = std::make_unique<blf_converter::PcapngSink>(output_path, maparg.Get());
+		pcapng->report_to(&interfaces);
+		// Writes happen on a separate thread, the conversion continues during slow I/O
+		auto writer = std::make_unique<blf_converter::WriterThreadSink>(std::move(pcapng), &budget);
+		// A resumed output only holds the rest of the input
+		std::uint64_t estimate = resume ? 0 : preallocate_size(converter, settings);
+		if (estimate > 0) {
+			writer->preallocate(output_path, estimate);
 		}
+		sink = std::move(writer);
+	}
+	blf_converter::DedupSink* dedup;
+	sink = with_trigger(converter, std::move(sink), trigger);
+	sink = with_dedup(std::move(sink), settings.dedup_ns, dedup);
+
+	if (prescanarg && !converter.prescan(*sink)) {
+		std::cerr << "Unable to read the metadata of " << args::get(inarg) << std::endl;
+		return 1;
+	}
+	if (resume) {
+		converter.resume(cp, resumed_channels, *sink);
+	}
+	if (checkpointarg) {
+		converter.on_progress(std::chrono::seconds(args::get(checkpointarg)), [&]() {
+			sink->flush();
+			std::error_code size_ec;
+			cp.output_offset = output_base + std::filesystem::file_size(output_path, size_ec);
+			converter.position(cp);
+			if (size_ec || !blf_converter::save_checkpoint(checkpoint_path, cp, converter.channel_mappings())) {
+				std::cerr << "Unable to save checkpoint " << checkpoint_path << std::endl;
+			}
+		});
+	}
+
+	conversion_time time;
+	time.start(converter);
+	bool complete = true;
+	if (followarg) {
+		std::signal(SIGINT, on_interrupt);
+		converter.follow(*sink, interrupted);
+	}
+	else {
+		complete = run_segments(converter, *sink, settings.segments, dedup);
+	}
+	converter.close();
 
-		/* delete object */
-		delete ohb;
+	report_skipped(converter);
+
+	// Closes the outputs, their interface statistics are written before the files are merged
+	sink.reset();
+	time.stop(converter);
+	if (resume) {
+		append_file(outfile, resume_path);
+		// Fails where open files cannot be removed, the content is already merged
+		std::filesystem::remove(resume_path, ec);
+	}
+	if (complete && (checkpointarg || resume)) {
+		std::filesystem::remove(checkpoint_path, ec);
+	}
+	if (maxmemoryarg || statsarg) {
+		report_memory(budget);
+	}
+	if (statsarg) {
+		report_stats(time);
+		report_interfaces(interfaces);
 	}
-	infile.close();
-	return 0;
+	return complete ? 0 : 1;
 }
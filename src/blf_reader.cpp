@@ -0,0 +1,529 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "blf_reader.hpp"
+#include "inflate.hpp"
+#include "placement.hpp"
+
+using namespace Vector::BLF;
+
+namespace blf_converter {
+
+	/// AbstractFile over a single object in memory, used to build Vector::BLF objects
+	class MemoryFile : public AbstractFile {
+	public:
+		MemoryFile(const std::uint8_t* data, std::size_t size)
+			: data(data), size(size) {}
+
+		std::streamsize gcount() const override {
+			return count;
+		}
+		void read(char* s, std::streamsize n) override {
+			count = std::min<std::streamsize>(n, size - position);
+			memcpy(s, data + position, count);
+			position += count;
+			if (count < n) {
+				at_end = true;
+			}
+		}
+		std::streampos tellg() override {
+			return position;
+		}
+		void seekg(std::streamoff off, const std::ios_base::seekdir way) override {
+			std::streamoff base = way == std::ios_base::beg ? 0 : way == std::ios_base::end ? size : position;
+			position = std::min<std::size_t>(std::max<std::streamoff>(base + off, 0), size);
+		}
+		void write(const char* s, std::streamsize n) override {
+			throw std::runtime_error("MemoryFile is read only");
+		}
+		std::streampos tellp() override {
+			return position;
+		}
+		bool good() const override {
+			return !at_end;
+		}
+		bool eof() const override {
+			return at_end;
+		}
+
+	private:
+		const std::uint8_t* data;
+		std::size_t size;
+		std::size_t position = 0;
+		std::streamsize count = 0;
+		bool at_end = false;
+	};
+
+	SYSTEMTIME read_systemtime(const std::uint8_t* data) {
+		SYSTEMTIME time;
+		time.year = read_le<WORD>(data);
+		time.month = read_le<WORD>(data + 2);
+		time.dayOfWeek = read_le<WORD>(data + 4);
+		time.day = read_le<WORD>(data + 6);
+		time.hour = read_le<WORD>(data + 8);
+		time.minute = read_le<WORD>(data + 10);
+		time.second = read_le<WORD>(data + 12);
+		time.milliseconds = read_le<WORD>(data + 14);
+		return time;
+	}
+
+	bool BlfReader::open(const std::string& path) {
+		file.open(path, std::ios_base::in | std::ios_base::binary);
+		if (!file.is_open()) {
+			return false;
+		}
+
+		std::array<std::uint8_t, 144> header;
+		file.read((char*)header.data(), header.size());
+		if (file.gcount() != (std::streamsize)header.size() || read_le<DWORD>(header.data()) != FileSignature) {
+			file.close();
+			return false;
+		}
+		fileStatistics.signature = read_le<DWORD>(header.data());
+		fileStatistics.statisticsSize = read_le<DWORD>(header.data() + 4);
+		fileStatistics.apiNumber = read_le<DWORD>(header.data() + 8);
+		fileStatistics.applicationId = header[12];
+		fileStatistics.compressionLevel = header[13];
+		fileStatistics.applicationMajor = header[14];
+		fileStatistics.applicationMinor = header[15];
+		fileStatistics.fileSize = read_le<ULONGLONG>(header.data() + 16);
+		fileStatistics.uncompressedFileSize = read_le<ULONGLONG>(header.data() + 24);
+		fileStatistics.objectCount = read_le<DWORD>(header.data() + 32);
+		fileStatistics.applicationBuild = read_le<DWORD>(header.data() + 36);
+		fileStatistics.measurementStartTime = read_systemtime(header.data() + 40);
+		fileStatistics.lastObjectTime = read_systemtime(header.data() + 56);
+		fileStatistics.restorePointsOffset = read_le<ULONGLONG>(header.data() + 72);
+
+		// Objects start right after the statistics
+		container_offset = fileStatistics.statisticsSize;
+		file.seekg(container_offset, std::ios_base::beg);
+		buffer.clear();
+		containers.clear();
+		position = 0;
+		return true;
+	}
+
+	bool BlfReader::is_open() const {
+		return file.is_open();
+	}
+
+	void BlfReader::close() {
+		file.close();
+		buffer = std::vector<std::uint8_t>();
+		compressed = std::vector<std::uint8_t>();
+		containers.clear();
+		position = 0;
+		account();
+	}
+
+	void BlfReader::account() {
+		if (budget == nullptr) {
+			return;
+		}
+		std::size_t bytes = compressed.capacity() + buffer.capacity();
+		budget->update(charged, bytes);
+		charged = bytes;
+		if (budget->exceeded()) {
+			// Capacity kept from larger containers is given back, the compressed data is already inflated
+			compressed = std::vector<std::uint8_t>();
+			buffer.shrink_to_fit();
+			bytes = buffer.capacity();
+			budget->update(charged, bytes);
+			charged = bytes;
+		}
+	}
+
+	void BlfReader::resize_buffer(std::size_t size) {
+		if (huge_pages && size > buffer.capacity()) {
+			std::vector<std::uint8_t> grown;
+			grown.reserve(std::max(size, 2 * buffer.capacity()));
+			advise_huge_pages(grown.data(), grown.capacity());
+			grown.assign(buffer.begin(), buffer.end());
+			buffer.swap(grown);
+		}
+		buffer.resize(size);
+	}
+
+	const std::uint8_t* find_signature(const std::uint8_t* begin, const std::uint8_t* end) {
+		const std::uint8_t* p = begin;
+#ifdef __SSE2__
+		// Compare the first and last signature byte of 16 positions at once
+		const __m128i first = _mm_set1_epi8('L');
+		const __m128i last = _mm_set1_epi8('J');
+		for (; p + 16 + 3 <= end; p += 16) {
+			__m128i eq_first = _mm_cmpeq_epi8(first, _mm_loadu_si128((const __m128i*)p));
+			__m128i eq_last = _mm_cmpeq_epi8(last, _mm_loadu_si128((const __m128i*)(p + 3)));
+			unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(eq_first, eq_last));
+			while (mask != 0) {
+				unsigned bit = __builtin_ctz(mask);
+				if (read_le<DWORD>(p + bit) == ObjectSignature) {
+					return p + bit;
+				}
+				mask &= mask - 1;
+			}
+		}
+#endif
+		while (p + 4 <= end) {
+			p = (const std::uint8_t*)memchr(p, 'L', end - p - 3);
+			if (p == nullptr) {
+				return end;
+			}
+			if (read_le<DWORD>(p) == ObjectSignature) {
+				return p;
+			}
+			p++;
+		}
+		return end;
+	}
+
+	/* Checks an object header found by scanning, stricter than the sequential checks */
+	bool valid_object_header(const std::uint8_t* data) {
+		WORD headerSize = read_le<WORD>(data + 4);
+		WORD headerVersion = read_le<WORD>(data + 6);
+		DWORD objectSize = read_le<DWORD>(data + 8);
+		DWORD objectType = read_le<DWORD>(data + 12);
+		return read_le<DWORD>(data) == ObjectSignature
+			&& ((headerVersion == 1 && headerSize == 32) || (headerVersion == 2 && headerSize == 40))
+			&& objectSize >= headerSize && objectSize <= MaxObjectSize
+			&& objectType != 0 && objectType != (DWORD)ObjectType::LOG_CONTAINER && objectType < 0x100;
+	}
+
+	bool valid_container_header(const std::uint8_t* data) {
+		DWORD objectSize = read_le<DWORD>(data + 8);
+		WORD compressionMethod = read_le<WORD>(data + 16);
+		DWORD uncompressedSize = read_le<DWORD>(data + 24);
+		return read_le<DWORD>(data) == ObjectSignature
+			&& read_le<WORD>(data + 4) == ObjectHeaderBaseSize
+			&& read_le<WORD>(data + 6) == 1
+			&& read_le<DWORD>(data + 12) == (DWORD)ObjectType::LOG_CONTAINER
+			&& objectSize >= LogContainerHeaderSize && objectSize <= MaxContainerSize
+			&& (compressionMethod == 0 || compressionMethod == 2)
+			&& uncompressedSize <= MaxContainerSize;
+	}
+
+	void BlfReader::add_skipped(const skipped_range& range) {
+		if (!skipped.empty()) {
+			skipped_range& last = skipped.back();
+			if (!range.inflated && !last.inflated && last.offset + (std::streamoff)last.length == range.offset) {
+				last.length += range.length;
+				return;
+			}
+		}
+		skipped.push_back(range);
+	}
+
+	bool BlfReader::resync_container() {
+		std::streamoff start = container_offset;
+		std::vector<std::uint8_t> chunk(1 << 20);
+		std::streamoff offset = container_offset + 1;
+		while (true) {
+			file.clear();
+			file.seekg(offset, std::ios_base::beg);
+			file.read((char*)chunk.data(), chunk.size());
+			std::size_t length = (std::size_t)file.gcount();
+			const std::uint8_t* end = chunk.data() + length;
+			for (const std::uint8_t* p = find_signature(chunk.data(), end); p != end; p = find_signature(p + 1, end)) {
+				if (end - p < (std::ptrdiff_t)LogContainerHeaderSize) {
+					// Header continues in the next chunk
+					break;
+				}
+				if (valid_container_header(p)) {
+					container_offset = offset + (p - chunk.data());
+					add_skipped({ start, 0, (std::uint64_t)(container_offset - start), false });
+					discontinuity = true;
+					return true;
+				}
+			}
+			if (length < chunk.size()) {
+				// Nothing left that could hold a container
+				container_offset = offset + length;
+				add_skipped({ start, 0, (std::uint64_t)(container_offset - start), false });
+				discontinuity = true;
+				return false;
+			}
+			// Overlap the chunks so a header on the boundary is still found
+			offset += length - LogContainerHeaderSize + 1;
+		}
+	}
+
+	bool BlfReader::read_container() {
+		if (on_refill) {
+			on_refill();
+		}
+		cut_off = false;
+		while (true) {
+			std::array<std::uint8_t, LogContainerHeaderSize> header;
+			file.clear();
+			file.seekg(container_offset, std::ios_base::beg);
+			file.read((char*)header.data(), ObjectHeaderBaseSize);
+			if (file.gcount() != ObjectHeaderBaseSize) {
+				cut_off = file.gcount() > 0;
+				return false;
+			}
+			if (read_le<DWORD>(header.data()) != ObjectSignature) {
+				if (!recover) {
+					throw std::runtime_error("Unexpected container signature");
+				}
+				if (!resync_container()) {
+					return false;
+				}
+				continue;
+			}
+			DWORD objectSize = read_le<DWORD>(header.data() + 8);
+			auto objectType = (ObjectType)read_le<DWORD>(header.data() + 12);
+			if (objectType != ObjectType::LOG_CONTAINER) {
+				// Only containers are expected on top level, skip anything else
+				if (objectSize < ObjectHeaderBaseSize || (recover && objectSize > MaxContainerSize)) {
+					if (!recover) {
+						throw std::runtime_error("Invalid object size");
+					}
+					if (!resync_container()) {
+						return false;
+					}
+					continue;
+				}
+				container_offset += objectSize + objectSize % 4;
+				continue;
+			}
+
+			file.read((char*)header.data() + ObjectHeaderBaseSize, LogContainerHeaderSize - ObjectHeaderBaseSize);
+			if (file.gcount() != LogContainerHeaderSize - ObjectHeaderBaseSize) {
+				cut_off = true;
+				return false;
+			}
+			if (recover ? !valid_container_header(header.data()) : objectSize < LogContainerHeaderSize) {
+				if (!recover) {
+					throw std::runtime_error("Invalid container size");
+				}
+				if (!resync_container()) {
+					return false;
+				}
+				continue;
+			}
+			WORD compressionMethod = read_le<WORD>(header.data() + 16);
+			DWORD uncompressedSize = read_le<DWORD>(header.data() + 24);
+
+			std::size_t data_size = objectSize - LogContainerHeaderSize;
+			if (compressionMethod != 0) {
+				compressed.resize(data_size);
+				file.read((char*)compressed.data(), compressed.size());
+				if (file.gcount() != (std::streamsize)compressed.size()) {
+					// Truncated container, e.g. unfinished file
+					cut_off = true;
+					return false;
+				}
+			}
+			std::streamoff offset_in_file = container_offset;
+			container_offset += objectSize + objectSize % 4;
+
+			if (discontinuity) {
+				// The buffered data is not continued by this container
+				if (position < buffer.size()) {
+					skipped_range range;
+					tell(range.offset, range.inflated_offset);
+					range.length = buffer.size() - position;
+					range.inflated = true;
+					add_skipped(range);
+				}
+				buffer.clear();
+				containers.clear();
+				position = 0;
+				discontinuity = false;
+				resyncing = true;
+			}
+
+			// Keep the unread part of the previous container, objects may span containers
+			std::size_t skip = 0;
+			if (position < buffer.size()) {
+				buffer.erase(buffer.begin(), buffer.begin() + position);
+				for (auto& container : containers) {
+					if (container.start >= position) {
+						container.start -= position;
+					}
+					else {
+						container.skip += position - container.start;
+						container.start = 0;
+					}
+				}
+				while (containers.size() > 1 && containers[1].start == 0) {
+					containers.erase(containers.begin());
+				}
+			}
+			else {
+				skip = position - buffer.size();
+				buffer.clear();
+				containers.clear();
+			}
+			position = skip;
+
+			std::size_t offset = buffer.size();
+			containers.push_back({ offset_in_file, offset, 0 });
+			if (compressionMethod == 0) {
+				// Stored data is read straight into the object buffer, without staging
+				resize_buffer(offset + data_size);
+				file.read((char*)buffer.data() + offset, data_size);
+				if (file.gcount() != (std::streamsize)data_size) {
+					// Truncated container, read again once the file is complete
+					buffer.resize(offset);
+					containers.pop_back();
+					container_offset = offset_in_file;
+					cut_off = true;
+					return false;
+				}
+				account();
+				return true;
+			}
+			resize_buffer(offset + uncompressedSize);
+			std::size_t length;
+			if (!inflate_container(compressed.data(), compressed.size(), buffer.data() + offset, uncompressedSize, length)) {
+				if (!recover) {
+					throw std::runtime_error("Unable to inflate container");
+				}
+				buffer.resize(offset);
+				containers.pop_back();
+				add_skipped({ offset_in_file, 0, (std::uint64_t)(container_offset - offset_in_file), false });
+				discontinuity = true;
+				continue;
+			}
+			buffer.resize(offset + length);
+			account();
+			return true;
+		}
+	}
+
+	bool BlfReader::resync_object() {
+		if (!skipping) {
+			tell(pending_skip.offset, pending_skip.inflated_offset);
+			pending_skip.length = 0;
+			pending_skip.inflated = true;
+			skipping = true;
+		}
+		const std::uint8_t* begin = buffer.data() + position + 1;
+		const std::uint8_t* end = buffer.data() + buffer.size();
+		for (const std::uint8_t* p = find_signature(begin, end); p != end; p = find_signature(p + 1, end)) {
+			if (end - p < (std::ptrdiff_t)ObjectHeaderBaseSize) {
+				// Header continues in the next container
+				pending_skip.length += (p - buffer.data()) - position;
+				position = p - buffer.data();
+				return false;
+			}
+			if (valid_object_header(p)) {
+				pending_skip.length += (p - buffer.data()) - position;
+				position = p - buffer.data();
+				return true;
+			}
+		}
+		// Keep the last bytes, they may start a signature
+		std::size_t keep = std::min<std::size_t>(3, buffer.size() - position - 1);
+		pending_skip.length += buffer.size() - keep - position;
+		position = buffer.size() - keep;
+		return false;
+	}
+
+	bool BlfReader::next(ObjectRef& object) {
+		while (true) {
+			std::size_t available = position < buffer.size() ? buffer.size() - position : 0;
+			if (available >= ObjectHeaderBaseSize) {
+				const std::uint8_t* data = buffer.data() + position;
+				DWORD objectSize = read_le<DWORD>(data + 8);
+				bool valid = resyncing
+					? valid_object_header(data)
+					: read_le<DWORD>(data) == ObjectSignature && objectSize >= ObjectHeaderBaseSize
+						&& (!recover || objectSize <= MaxObjectSize);
+				if (!valid) {
+					if (!recover) {
+						throw std::runtime_error(read_le<DWORD>(data) != ObjectSignature
+							? "Unexpected object signature" : "Invalid object size");
+					}
+					resyncing = true;
+					if (resync_object()) {
+						continue;
+					}
+				}
+				else if (available >= objectSize) {
+					if (skipping) {
+						add_skipped(pending_skip);
+						skipping = false;
+					}
+					resyncing = false;
+					object.type = (ObjectType)read_le<DWORD>(data + 12);
+					object.data = data;
+					object.size = objectSize;
+					// Objects are followed by objectSize % 4 padding bytes
+					position += objectSize + objectSize % 4;
+					return true;
+				}
+			}
+			if (!read_container()) {
+				return false;
+			}
+		}
+	}
+
+	bool BlfReader::truncated() const {
+		return cut_off;
+	}
+
+	bool BlfReader::finished() {
+		std::array<std::uint8_t, 8> fileSize;
+		file.clear();
+		file.seekg(16, std::ios_base::beg);
+		file.read((char*)fileSize.data(), fileSize.size());
+		if (file.gcount() != (std::streamsize)fileSize.size()) {
+			return false;
+		}
+		fileStatistics.fileSize = read_le<ULONGLONG>(fileSize.data());
+		file.seekg(0, std::ios_base::end);
+		std::streamoff size = file.tellg();
+
+		// The writer only sets the file size once it closed the file
+		return fileStatistics.fileSize != 0
+			&& (std::streamoff)fileStatistics.fileSize == size
+			&& container_offset + (std::streamoff)ObjectHeaderBaseSize > size;
+	}
+
+	void BlfReader::tell(std::streamoff& offset, std::uint64_t& skip) const {
+		offset = container_offset;
+		skip = position;
+		for (const auto& container : containers) {
+			if (container.start > position) {
+				break;
+			}
+			offset = container.offset;
+			skip = container.skip + (position - container.start);
+		}
+	}
+
+	void BlfReader::seek(std::streamoff offset, std::uint64_t skip) {
+		buffer.clear();
+		containers.clear();
+		container_offset = offset;
+		// Skipped once the container has been read
+		position = skip;
+		discontinuity = false;
+		resyncing = false;
+		skipping = false;
+		cut_off = false;
+	}
+
+	ObjectHeaderBase* BlfReader::materialize(const ObjectRef& object) {
+		ObjectHeaderBase* ohb = objectFactory.createObject(object.type);
+		if (ohb == nullptr) {
+			return nullptr;
+		}
+		MemoryFile is(object.data, object.size);
+		ohb->read(is);
+		return ohb;
+	}
+
+}
@@ -0,0 +1,145 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+#ifndef _APP_BLF_READER_H
+#define _APP_BLF_READER_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <Vector/BLF.h>
+
+#include "memory_budget.hpp"
+
+namespace blf_converter {
+
+	/// "LOGG"
+	const std::uint32_t FileSignature = 0x47474F4C;
+	/// "LOBJ"
+	const std::uint32_t ObjectSignature = 0x4A424F4C;
+
+	/// Size of ObjectHeaderBase in the file
+	const std::uint32_t ObjectHeaderBaseSize = 16;
+	/// Size of the LogContainer header, including ObjectHeaderBase
+	const std::uint32_t LogContainerHeaderSize = 32;
+
+	/// Upper bounds used to tell real headers from random data when recovering
+	const std::uint32_t MaxObjectSize = 1 << 24;
+	const std::uint32_t MaxContainerSize = 1 << 26;
+
+	/// Returns the first LOBJ signature in [begin, end), or end
+	const std::uint8_t* find_signature(const std::uint8_t* begin, const std::uint8_t* end);
+
+	template<class T>
+	T read_le(const std::uint8_t* data) {
+		T value;
+		memcpy(&value, data, sizeof(T));
+		return value;
+	}
+
+	/// Raw object inside the inflated container memory
+	struct ObjectRef {
+		Vector::BLF::ObjectType type;
+		/// Object bytes, starting at the LOBJ signature
+		const std::uint8_t* data;
+		std::uint32_t size;
+	};
+
+	/// Data skipped while recovering from a corrupt file
+	struct skipped_range {
+		/// File offset of the skipped data, or of its container if inflated is set
+		std::streamoff offset;
+		/// Offset inside the inflated container data, if inflated is set
+		std::uint64_t inflated_offset;
+		std::uint64_t length;
+		bool inflated;
+	};
+
+	/// Reads BLF objects directly from the inflated LogContainers.
+	/// Returned objects stay valid until the next container is read, see on_refill.
+	class BlfReader {
+	public:
+		Vector::BLF::FileStatistics fileStatistics {};
+
+		/// Skip corrupt containers and objects instead of throwing
+		bool recover = false;
+		/// Ranges skipped in recovery mode
+		std::vector<skipped_range> skipped;
+		/// Accounts the read buffers, which are shrunk while the budget is exceeded
+		MemoryBudget* budget = nullptr;
+		/// Backs the inflated data with transparent huge pages where available
+		bool huge_pages = false;
+		/// Called before the next container replaces the buffered data, all objects returned so far become invalid
+		std::function<void()> on_refill;
+
+		bool open(const std::string& path);
+		bool is_open() const;
+		void close();
+
+		/// Reads the next object, returns false at the end of the file.
+		/// A truncated last container is not consumed, so next() can be called
+		/// again once more data has been appended to the file.
+		bool next(ObjectRef& object);
+		/// True if the last next() returned false at a container cut off by the end of the file
+		bool truncated() const;
+
+		/// True if the file header reports a complete file and all of it has been read
+		bool finished();
+
+		/// Position of the next object: offset of its container in the file
+		/// and offset of the object inside the inflated container data
+		void tell(std::streamoff& offset, std::uint64_t& skip) const;
+		/// Continues reading at a position returned by tell()
+		void seek(std::streamoff offset, std::uint64_t skip);
+
+		/// Creates the Vector::BLF object for a raw object, nullptr if the type is unknown
+		Vector::BLF::ObjectHeaderBase* materialize(const ObjectRef& object);
+
+	private:
+		bool read_container();
+		/// Moves container_offset to the next valid container header
+		bool resync_container();
+		/// Moves position to the next valid object header, false if more data is needed
+		bool resync_object();
+		void add_skipped(const skipped_range& range);
+		/// Updates the budget with the current buffer sizes
+		void account();
+		/// Resizes buffer, new memory is advised for huge pages before it is touched
+		void resize_buffer(std::size_t size);
+
+		/// Container whose inflated data starts at offset skip at buffer[start]
+		struct buffered_container {
+			std::streamoff offset;
+			std::size_t start;
+			std::size_t skip;
+		};
+
+		std::ifstream file;
+		Vector::BLF::File objectFactory;
+		std::vector<std::uint8_t> compressed;
+		/// Inflated data, starting with the remainder of the previous container
+		std::vector<std::uint8_t> buffer;
+		std::size_t position = 0;
+		/// File offset of the next container to read
+		std::streamoff container_offset = 0;
+		std::vector<buffered_container> containers;
+		std::size_t charged = 0;
+
+		/// Set when container data was lost, the buffered data does not continue
+		bool discontinuity = false;
+		/// Set while the object stream is not known to be aligned to an object
+		bool resyncing = false;
+		bool skipping = false;
+		/// Set when the last container read stopped at the end of the file
+		bool cut_off = false;
+		skipped_range pending_skip {};
+	};
+
+}
+
+#endif
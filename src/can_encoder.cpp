@@ -0,0 +1,101 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+#include "can_encoder.hpp"
+#include "endianness.h"
+
+namespace blf_converter {
+
+	/* Only the valid bytes are written, fixed size copies for the common sizes */
+	void encode_can_data(const can_records& records, std::size_t i, std::uint8_t* frame) {
+		std::size_t length = records.length[i] < 64 ? records.length[i] : 64;
+		std::size_t size = records.data_size[i] < length ? records.data_size[i] : length;
+		std::uint8_t* data = frame + 8;
+		if (size == 8) {
+			memcpy(data, records.data[i], 8);
+		}
+		else if (size == 64) {
+			memcpy(data, records.data[i], 64);
+		}
+		else {
+			memcpy(data, records.data[i], size);
+		}
+		if (size < length) {
+			memset(data + size, 0, length - size);
+		}
+	}
+
+#ifdef __SSE2__
+	/// Four 32 bit values from four bytes
+	__m128i widen(const std::uint8_t* values) {
+		std::uint32_t packed;
+		memcpy(&packed, values, 4);
+		__m128i zero = _mm_setzero_si128();
+		__m128i words = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)packed), zero);
+		return _mm_unpacklo_epi16(words, zero);
+	}
+
+	__m128i byte_swap(__m128i values) {
+#ifdef __SSSE3__
+		return _mm_shuffle_epi8(values, _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3));
+#else
+		__m128i bytes02 = _mm_or_si128(_mm_slli_epi32(values, 24), _mm_srli_epi32(values, 24));
+		__m128i mask = _mm_set1_epi32(0x0000FF00);
+		__m128i bytes13 = _mm_or_si128(
+			_mm_and_si128(_mm_srli_epi32(values, 8), mask),
+			_mm_slli_epi32(_mm_and_si128(values, mask), 8));
+		return _mm_or_si128(bytes02, bytes13);
+#endif
+	}
+#endif
+
+	void encode_can_records(const can_records& records, std::uint8_t* out) {
+		std::size_t i = 0;
+#ifdef __SSE2__
+		for (; i + 4 <= records.count; i += 4) {
+			// First header word: big endian id with the EFF flag from bit 31, RTR flag in the top byte
+			__m128i ids = _mm_loadu_si128((const __m128i*)(records.id + i));
+			__m128i first = _mm_or_si128(
+				_mm_andnot_si128(_mm_set1_epi32(CAN_RECORD_RTR), byte_swap(ids)),
+				widen(records.rtr + i));
+			// Second header word: length, CAN FD flags, two reserved bytes
+			__m128i second = _mm_or_si128(widen(records.length + i), _mm_slli_epi32(widen(records.fd_flags + i), 8));
+
+			__m128i low = _mm_unpacklo_epi32(first, second);
+			__m128i high = _mm_unpackhi_epi32(first, second);
+			std::uint8_t* frame = out + i * CAN_RECORD_STRIDE;
+			_mm_storel_epi64((__m128i*)frame, low);
+			_mm_storel_epi64((__m128i*)(frame + CAN_RECORD_STRIDE), _mm_srli_si128(low, 8));
+			_mm_storel_epi64((__m128i*)(frame + 2 * CAN_RECORD_STRIDE), high);
+			_mm_storel_epi64((__m128i*)(frame + 3 * CAN_RECORD_STRIDE), _mm_srli_si128(high, 8));
+
+			for (std::size_t j = i; j < i + 4; j++) {
+				encode_can_data(records, j, out + j * CAN_RECORD_STRIDE);
+			}
+		}
+#endif
+		for (; i < records.count; i++) {
+			std::uint8_t* frame = out + i * CAN_RECORD_STRIDE;
+			std::uint32_t first = hton32(records.id[i]);
+			memcpy(frame, &first, 4);
+			frame[0] = (frame[0] & ~CAN_RECORD_RTR) | records.rtr[i];
+			frame[4] = records.length[i];
+			frame[5] = records.fd_flags[i];
+			frame[6] = 0;
+			frame[7] = 0;
+			encode_can_data(records, i, frame);
+		}
+	}
+
+}
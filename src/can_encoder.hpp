@@ -0,0 +1,46 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+#ifndef _APP_CAN_ENCODER_H
+#define _APP_CAN_ENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/// Bytes between two frames written by encode_can_records, SocketCAN header and 64 data bytes
+#define CAN_RECORD_STRIDE 72
+/// Records encoded at once
+#define CAN_RECORD_BATCH  64
+
+/// SocketCAN flags in the first id byte
+#define CAN_RECORD_RTR 0x40
+/// SocketCAN CAN FD flags
+#define CAN_RECORD_BRS 0x01
+#define CAN_RECORD_ESI 0x02
+
+namespace blf_converter {
+
+	/// CAN and CAN FD messages, one array per field so that several records are encoded at once
+	struct can_records {
+		/// BLF id, bit 31 set for extended ids
+		std::uint32_t id[CAN_RECORD_BATCH];
+		/// 0 or CAN_RECORD_RTR
+		std::uint8_t rtr[CAN_RECORD_BATCH];
+		/// CAN_RECORD_BRS, CAN_RECORD_ESI
+		std::uint8_t fd_flags[CAN_RECORD_BATCH];
+		/// DLC of CAN messages, valid data bytes of CAN FD messages
+		std::uint8_t length[CAN_RECORD_BATCH];
+		const std::uint8_t* data[CAN_RECORD_BATCH];
+		/// Bytes readable at data, at most 64
+		std::uint8_t data_size[CAN_RECORD_BATCH];
+		std::size_t count = 0;
+	};
+
+	/// Writes the records as SocketCAN frames to out, CAN_RECORD_STRIDE bytes apart.
+	/// A frame has min(length, 64) + 8 valid bytes, data after data_size is zero.
+	void encode_can_records(const can_records& records, std::uint8_t* out);
+
+}
+
+#endif
@@ -5,8 +5,6 @@
 
 #include "channels.hpp"
 #include <tinyxml2.h>
-#include <sstream>
-#include <map>
 #include <pcapng_exporter/linktype.h>
 
 using namespace Vector::BLF;
@@ -42,7 +40,7 @@ std::optional<uint16_t> bus_name_to_linklayer(std::string bus_type) {
 	return std::nullopt;
 }
 
-void configure_db_channel(pcapng_exporter::PcapngExporter* exporter, AppText* obj) {
+void configure_db_channel(channel_state* state, AppText* obj) {
 
 	auto channel_id = (obj->reservedAppText1 >> 8) & 0xFF;
 	auto channel_link = bus_type_to_linklayer((obj->reservedAppText1 >> 16) & 0xFF);
@@ -55,12 +53,12 @@ void configure_db_channel(pcapng_exporter::PcapngExporter* exporter, AppText* ob
 	mapping.when.chl_id = channel_id;
 	mapping.when.chl_link = channel_link;
 	mapping.change.inf_name = db_channels[1];
-	exporter->mappings.push_back(mapping);
+	state->mappings.push_back(mapping);
 
 }
 
 
-void configure_xml_channel(pcapng_exporter::PcapngExporter* exporter, tinyxml2::XMLElement* channel) {
+void configure_xml_channel(channel_state* state, tinyxml2::XMLElement* channel) {
 
 	auto channel_type = std::string(channel->Attribute("type") ? channel->Attribute("type") : "");
 	auto channel_id = channel->IntAttribute("number");
@@ -71,7 +69,7 @@ void configure_xml_channel(pcapng_exporter::PcapngExporter* exporter, tinyxml2::
 		mapping.when.chl_id = channel_id;
 		mapping.when.chl_link = bus_name_to_linklayer(channel_type);
 		mapping.change.inf_name = channel_name;
-		exporter->mappings.push_back(mapping);
+		state->mappings.push_back(mapping);
 	}
 
 	auto channel_properties = channel->FirstChildElement("channel_properties");
@@ -107,21 +105,20 @@ void configure_xml_channel(pcapng_exporter::PcapngExporter* exporter, tinyxml2::
 			}
 
 			if (mapping.change.inf_name && mapping.when.chl_id) {
-				exporter->mappings.push_back(mapping);
+				state->mappings.push_back(mapping);
 			}
 		}
 	}
 }
 
-std::map<int, std::stringstream> xml_channel_mapping;
-void configure_xml_channels(pcapng_exporter::PcapngExporter* exporter, AppText* obj) {
+void configure_xml_channels(channel_state* state, AppText* obj) {
 	auto metadata_id = obj->reservedAppText1 >> 24;
 	auto remaining_len = obj->reservedAppText1 & 0xffffff;
 	auto part_len = obj->text.size();
-	if (!xml_channel_mapping.count(metadata_id)) {
-		xml_channel_mapping.insert_or_assign(metadata_id, std::stringstream());
+	if (!state->xml_channel_mapping.count(metadata_id)) {
+		state->xml_channel_mapping.insert_or_assign(metadata_id, std::stringstream());
 	}
-	std::stringstream& xml_stream = xml_channel_mapping[metadata_id];
+	std::stringstream& xml_stream = state->xml_channel_mapping[metadata_id];
 	xml_stream << obj->text;
 	if (obj->textLength != remaining_len) {
 		// More text is pending
@@ -139,15 +136,15 @@ void configure_xml_channels(pcapng_exporter::PcapngExporter* exporter, AppText*
 	}
 	for (auto channel = channels->FirstChildElement("channel"); channel != NULL; channel = channel->NextSiblingElement("channel"))
 	{
-		configure_xml_channel(exporter, channel);
+		configure_xml_channel(state, channel);
 	}
 }
 
-void configure_channels(pcapng_exporter::PcapngExporter* exporter, AppText* obj) {
+void configure_channels(channel_state* state, AppText* obj) {
 	if (obj->source == AppText::Source::DbChannelInfo) {
-		configure_db_channel(exporter, obj);
+		configure_db_channel(state, obj);
 	}
 	if (obj->source == AppText::Source::MetaData) {
-		configure_xml_channels(exporter, obj);
+		configure_xml_channels(state, obj);
 	}
 }
\ No newline at end of file
@@ -5,9 +5,19 @@
 #ifndef _APP_CHANNELS_H
 #define _APP_CHANNELS_H
 
+#include <map>
+#include <sstream>
+#include <vector>
+
 #include <Vector/BLF.h>
 #include <pcapng_exporter/pcapng_exporter.hpp>
 
-void configure_channels(pcapng_exporter::PcapngExporter* exporter, Vector::BLF::AppText* obj);
+struct channel_state {
+	std::vector<pcapng_exporter::channel_mapping> mappings;
+	// Pending XML metadata parts, by metadata id
+	std::map<int, std::stringstream> xml_channel_mapping;
+};
+
+void configure_channels(channel_state* state, Vector::BLF::AppText* obj);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,114 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+
+#include <cstdio>
+#include <fstream>
+
+#include "checkpoint.hpp"
+
+#define CHECKPOINT_MAGIC "blf_converter-checkpoint"
+#define CHECKPOINT_VERSION 1
+
+namespace blf_converter {
+
+	/* Strings are stored as "<length> <bytes>", they may contain any character */
+	void write_string(std::ostream& os, const std::string& value) {
+		os << value.size() << ' ' << value << '\n';
+	}
+
+	bool read_string(std::istream& is, std::string& value) {
+		size_t length = 0;
+		if (!(is >> length) || is.get() != ' ') {
+			return false;
+		}
+		value.resize(length);
+		is.read(&value[0], length);
+		return is.good();
+	}
+
+	bool save_checkpoint(const std::string& path, const checkpoint& cp, const channel_state& channels) {
+		std::string tmp_path = path + ".tmp";
+		{
+			std::ofstream os(tmp_path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+			if (!os.is_open()) {
+				return false;
+			}
+			os << CHECKPOINT_MAGIC << ' ' << CHECKPOINT_VERSION << '\n';
+			os << "input " << cp.container_offset << ' ' << cp.container_skip << '\n';
+			os << "output " << cp.output_offset << '\n';
+			for (const auto& mapping : channels.mappings) {
+				os << "mapping "
+					<< (mapping.when.chl_id ? (int64_t)*mapping.when.chl_id : -1) << ' '
+					<< (mapping.when.chl_link ? (int32_t)*mapping.when.chl_link : -1) << ' ';
+				write_string(os, mapping.change.inf_name.value_or(""));
+			}
+			for (const auto& xml : channels.xml_channel_mapping) {
+				os << "xml " << xml.first << ' ';
+				write_string(os, xml.second.str());
+			}
+			os.flush();
+			if (!os.good()) {
+				return false;
+			}
+		}
+		// Keep the previous checkpoint until the new one is complete
+		std::remove(path.c_str());
+		return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+	}
+
+	bool load_checkpoint(const std::string& path, checkpoint& cp, channel_state& channels) {
+		std::ifstream is(path, std::ios_base::in | std::ios_base::binary);
+		std::string magic;
+		int version = 0;
+		if (!(is >> magic >> version) || magic != CHECKPOINT_MAGIC || version != CHECKPOINT_VERSION) {
+			return false;
+		}
+		channels.mappings.clear();
+		channels.xml_channel_mapping.clear();
+
+		std::string key;
+		while (is >> key) {
+			if (key == "input") {
+				is >> cp.container_offset >> cp.container_skip;
+			}
+			else if (key == "output") {
+				is >> cp.output_offset;
+			}
+			else if (key == "mapping") {
+				int64_t chl_id = -1;
+				int32_t chl_link = -1;
+				std::string inf_name;
+				if (!(is >> chl_id >> chl_link) || !read_string(is, inf_name)) {
+					return false;
+				}
+				pcapng_exporter::channel_mapping mapping;
+				if (chl_id >= 0) {
+					mapping.when.chl_id = (uint32_t)chl_id;
+				}
+				if (chl_link >= 0) {
+					mapping.when.chl_link = (uint16_t)chl_link;
+				}
+				mapping.change.inf_name = inf_name;
+				channels.mappings.push_back(mapping);
+			}
+			else if (key == "xml") {
+				int metadata_id = 0;
+				std::string text;
+				if (!(is >> metadata_id) || !read_string(is, text)) {
+					return false;
+				}
+				channels.xml_channel_mapping[metadata_id] << text;
+			}
+			else {
+				return false;
+			}
+			if (!is.good()) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+}
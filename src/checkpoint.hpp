@@ -0,0 +1,31 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+#ifndef _APP_CHECKPOINT_H
+#define _APP_CHECKPOINT_H
+
+#include <cstdint>
+#include <ios>
+#include <string>
+
+#include "channels.hpp"
+
+namespace blf_converter {
+
+	/// State needed to continue an interrupted conversion
+	struct checkpoint {
+		/// Input position, see BlfReader::tell()
+		std::streamoff container_offset = 0;
+		std::uint64_t container_skip = 0;
+		/// Output bytes that are complete at this position
+		std::uint64_t output_offset = 0;
+	};
+
+	/// Writes the checkpoint and the channel mapping state, replacing path atomically
+	bool save_checkpoint(const std::string& path, const checkpoint& cp, const channel_state& channels);
+	bool load_checkpoint(const std::string& path, checkpoint& cp, channel_state& channels);
+
+}
+
+#endif
@@ -0,0 +1,95 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+
+#include <algorithm>
+
+#include <pcapng_exporter/linktype.h>
+
+#include "blf_reader.hpp"
+#include "columnar_sink.hpp"
+#include "endianness.h"
+
+#define NANOS_PER_SEC 1000000000
+
+namespace blf_converter {
+
+	bool bus_columns::open(const std::string& prefix, MemoryBudget* budget) {
+		bool ok = timestamp.open(prefix + ".timestamp", budget)
+			&& channel.open(prefix + ".channel", budget)
+			&& id.open(prefix + ".id", budget)
+			&& flags.open(prefix + ".flags", budget)
+			&& payload.open(prefix + ".payload", budget)
+			&& offsets.open(prefix + ".offsets", budget);
+		// Offsets have one more entry than rows
+		offsets.push(0);
+		return ok;
+	}
+
+	void bus_columns::add(const Frame& frame, std::uint32_t id_value, std::uint32_t flags_value, const std::uint8_t* data, std::size_t size) {
+		timestamp.push((std::int64_t)frame.timestamp.tv_sec * NANOS_PER_SEC + frame.timestamp.tv_nsec);
+		channel.push(frame.channel_id);
+		id.push(id_value);
+		flags.push(flags_value | (frame.flags << COLUMNAR_FLAG_DIR_SHIFT));
+		payload.push(data, size);
+		payload_size += size;
+		offsets.push(payload_size);
+	}
+
+	void bus_columns::close() {
+		timestamp.close();
+		channel.close();
+		id.close();
+		flags.close();
+		payload.close();
+		offsets.close();
+	}
+
+	ColumnarSink::ColumnarSink(const std::string& prefix, MemoryBudget* budget) {
+		opened = can.open(prefix + ".can", budget) && lin.open(prefix + ".lin", budget);
+	}
+
+	ColumnarSink::~ColumnarSink() {
+		can.close();
+		lin.close();
+	}
+
+	bool ColumnarSink::is_open() const {
+		return opened;
+	}
+
+	void ColumnarSink::write_frame(const Frame& frame) {
+		if (frame.link_type == LINKTYPE_CAN && frame.length >= 8) {
+			// SocketCAN layout, as written by CanFrame
+			std::uint32_t can_id = ntoh32(read_le<std::uint32_t>(frame.data));
+			std::uint8_t fd_flags = frame.data[5];
+			std::uint32_t flags = 0;
+			if (can_id & 0x80000000) flags |= COLUMNAR_FLAG_EXT;
+			if (can_id & 0x40000000) flags |= COLUMNAR_FLAG_RTR;
+			if (can_id & 0x20000000) flags |= COLUMNAR_FLAG_ERR;
+			if (fd_flags & 0x01) flags |= COLUMNAR_FLAG_BRS;
+			if (fd_flags & 0x02) flags |= COLUMNAR_FLAG_ESI;
+			std::size_t len = std::min<std::size_t>(frame.data[4], frame.length - 8);
+			can.add(frame, can_id & 0x1fffffff, flags, frame.data + 8, len);
+		}
+		else if (frame.link_type == LINKTYPE_LIN && frame.lin != nullptr) {
+			const lin_frame& l = *frame.lin;
+			std::size_t len = std::min<std::size_t>(l.payload_length, 8);
+			lin.add(frame, l.pid, (std::uint32_t)l.errors << COLUMNAR_LIN_ERRORS_SHIFT, l.data, len);
+		}
+	}
+
+	void ColumnarSink::flush() {
+		for (bus_columns* bus : { &can, &lin }) {
+			bus->timestamp.flush();
+			bus->channel.flush();
+			bus->id.flush();
+			bus->flags.flush();
+			bus->payload.flush();
+			bus->offsets.flush();
+		}
+		fflush(nullptr);
+	}
+
+}
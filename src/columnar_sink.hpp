@@ -0,0 +1,115 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+#ifndef _APP_COLUMNAR_SINK_H
+#define _APP_COLUMNAR_SINK_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "memory_budget.hpp"
+#include "sink.hpp"
+
+/// Flags column bits
+#define COLUMNAR_FLAG_EXT  0x0001  // CAN: extended id
+#define COLUMNAR_FLAG_RTR  0x0002  // CAN: remote frame
+#define COLUMNAR_FLAG_ERR  0x0004  // CAN: error frame
+#define COLUMNAR_FLAG_BRS  0x0008  // CAN FD: bit rate switch
+#define COLUMNAR_FLAG_ESI  0x0010  // CAN FD: error state indicator
+#define COLUMNAR_FLAG_DIR_SHIFT 8  // 2 bits, 1 = in, 2 = out
+#define COLUMNAR_LIN_ERRORS_SHIFT 16 // LIN: 8 bits of LIN_ERROR_* flags
+
+namespace blf_converter {
+
+	/// Append only file of fixed size little endian values
+	template<class T>
+	class column_file {
+	public:
+		/// The buffer is reduced to a minimum if it does not fit into the budget
+		bool open(const std::string& path, MemoryBudget* budget = nullptr) {
+			file = fopen(path.c_str(), "wb");
+			capacity = BufferSize;
+			if (budget != nullptr && !budget->try_acquire(capacity * sizeof(T))) {
+				capacity = MinBufferSize;
+				budget->update(0, capacity * sizeof(T));
+			}
+			this->budget = budget;
+			buffer.reserve(capacity);
+			return file != nullptr;
+		}
+		void push(T value) {
+			buffer.push_back(value);
+			if (buffer.size() == capacity) {
+				flush();
+			}
+		}
+		void push(const T* values, std::size_t count) {
+			buffer.insert(buffer.end(), values, values + count);
+			if (buffer.size() >= capacity) {
+				flush();
+			}
+		}
+		void flush() {
+			if (file != nullptr && !buffer.empty()) {
+				fwrite(buffer.data(), sizeof(T), buffer.size(), file);
+			}
+			buffer.clear();
+		}
+		void close() {
+			flush();
+			if (file != nullptr) {
+				fclose(file);
+				file = nullptr;
+			}
+			if (budget != nullptr) {
+				budget->release(capacity * sizeof(T));
+				budget = nullptr;
+			}
+		}
+	private:
+		static const std::size_t BufferSize = (1 << 20) / sizeof(T);
+		static const std::size_t MinBufferSize = (1 << 12) / sizeof(T);
+		FILE* file = nullptr;
+		MemoryBudget* budget = nullptr;
+		std::size_t capacity = 0;
+		std::vector<T> buffer;
+	};
+
+	/// Columns of one bus, every frame adds one row
+	struct bus_columns {
+		column_file<std::int64_t> timestamp;  // ns since the epoch
+		column_file<std::uint32_t> channel;   // Frame::channel_id
+		column_file<std::uint32_t> id;        // CAN id, LIN protected id
+		column_file<std::uint32_t> flags;     // COLUMNAR_FLAG_*
+		column_file<std::uint8_t> payload;    // payload of all rows
+		column_file<std::uint64_t> offsets;   // row n payload is [offsets[n], offsets[n + 1])
+		std::uint64_t payload_size = 0;
+
+		bool open(const std::string& prefix, MemoryBudget* budget);
+		void add(const Frame& frame, std::uint32_t id, std::uint32_t flags, const std::uint8_t* data, std::size_t size);
+		void close();
+	};
+
+	/// Writes CAN and LIN frames as columnar files, e.g. <prefix>.can.timestamp.
+	/// Other link types are not written.
+	class ColumnarSink : public FrameSink {
+	public:
+		explicit ColumnarSink(const std::string& prefix, MemoryBudget* budget = nullptr);
+		~ColumnarSink();
+
+		bool is_open() const;
+		void write_frame(const Frame& frame) override;
+		void flush() override;
+
+	private:
+		bus_columns can;
+		bus_columns lin;
+		bool opened;
+	};
+
+}
+
+#endif
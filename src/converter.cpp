@@ -0,0 +1,1824 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+
+#include <algorithm>
+#include <array>
+#include <codecvt>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <locale>
+#include <thread>
+
+#include <Vector/BLF.h>
+#include "endianness.h"
+#include <pcapng_exporter/lin.h>
+#include <pcapng_exporter/linktype.h>
+
+#include "can_encoder.hpp"
+#include "converter.hpp"
+#include "encoding_pool.hpp"
+#include "views.hpp"
+
+using namespace Vector::BLF;
+using namespace blf_converter;
+
+#define HAS_FLAG(var,pos) ((var) & (1<<(pos)))
+
+#define NANOS_PER_SEC 1000000000
+
+#define DIR_IN    1
+#define DIR_OUT   2
+
+// Enumerations
+enum class FlexRayPacketType
+{
+	FlexRayFrame = 1,    // FlexRay Frame
+	FlexRaySymbol = 2     // FlexRay Symbol
+};
+
+class CanFrame {
+private:
+	uint8_t raw[72] = { 0 };
+public:
+
+	uint32_t id() {
+		return ntoh32(*(uint32_t*)raw) & 0x1fffffff;
+	}
+
+	void id(uint32_t value) {
+		uint8_t id_flags = *raw & 0xE0;
+		*(uint32_t*)raw = hton32(value);
+		*raw |= id_flags;
+	}
+
+	bool ext() {
+		return (*raw & 0x80) != 0;
+	}
+	void ext(bool value) {
+		uint8_t masked = *raw & 0x7F;
+		*raw = masked | value << 7;
+	}
+
+	bool rtr() {
+		return (*raw & 0x40) != 0;
+	}
+	void rtr(bool value) {
+		uint8_t masked = *raw & 0xBF;
+		*raw = masked | value << 6;
+	}
+
+	bool err() {
+		return (*raw & 0x20) != 0;
+	}
+	void err(bool value) {
+		uint8_t masked = *raw & 0xDF;
+		*raw = masked | value << 5;
+	}
+
+	bool brs() {
+		return (*(raw + 5) & 0x01) != 0;
+	}
+	void brs(bool value) {
+		uint8_t masked = *(raw + 5) & 0xFE;
+		*(raw + 5) = masked | value << 0;
+	}
+
+	bool esi() {
+		return (*(raw + 5) & 0x02) != 0;
+	}
+	void esi(bool value) {
+		uint8_t masked = *(raw + 5) & 0xFD;
+		*(raw + 5) = masked | value << 1;
+	}
+
+	uint8_t len() {
+		return *(raw + 4);
+	}
+	void len(uint8_t value) {
+		*(raw + 4) = value;
+	}
+
+	const uint8_t* data() {
+		return raw + 8;
+	}
+	void data(const uint8_t* value, size_t size) {
+		memcpy(raw + 8, value, size);
+	}
+
+	const uint8_t* bytes() {
+		return raw;
+	}
+
+	const uint8_t size() {
+		return len() + 8;
+	}
+
+};
+
+template<class ObjectHeaderGeneric>
+std::uint64_t calculate_ts_res(ObjectHeaderGeneric* oh)
+{
+	uint64_t ts_resol = 0;
+	switch (oh->objectFlags) {
+	case ObjectHeader::ObjectFlags::TimeTenMics:
+		ts_resol = 100000;
+		break;
+	case ObjectHeader::ObjectFlags::TimeOneNans:
+		ts_resol = NANOS_PER_SEC;
+		break;
+	default:
+		fprintf(stderr, "ERROR: The timestamp format is unknown (not 10us nor ns)!\n");
+		break;
+	}
+	return ts_resol;
+}
+
+template<class ObjectHeaderGeneric>
+pcapng_exporter::frame_header generate_header(
+	ObjectHeaderGeneric* oh,
+	std::uint64_t date_offset_ns)
+{
+	pcapng_exporter::frame_header header = pcapng_exporter::frame_header();
+	header.channel_id = oh->channel;
+	header.timestamp_resolution = calculate_ts_res(oh);
+	uint64_t ts = (NANOS_PER_SEC / header.timestamp_resolution) * oh->objectTimeStamp + date_offset_ns;
+	header.timestamp.tv_sec = ts / NANOS_PER_SEC;
+	header.timestamp.tv_nsec = ts % NANOS_PER_SEC;
+	return header;
+}
+
+/* Fills all fields of a frame except its data, false if the timestamp resolution is unknown */
+template <class ObjHeader>
+bool make_frame(
+	Frame& frame,
+	uint16_t link_type,
+	ObjHeader* oh,
+	const encode_options& options,
+	uint32_t flags = 0,
+	uint32_t hw_channel = 0
+) {
+	uint64_t ts_resol = calculate_ts_res(oh);
+	if (ts_resol == 0) return false;
+
+	frame = Frame();
+	frame.link_type = link_type;
+	frame.channel_id = 100000 * hw_channel + oh->channel;
+	frame.flags = flags;
+	frame.timestamp_resolution = ts_resol;
+
+	uint64_t ts = (NANOS_PER_SEC / ts_resol) * oh->objectTimeStamp + options.date_offset_ns;
+	frame.timestamp.tv_sec = ts / NANOS_PER_SEC;
+	frame.timestamp.tv_nsec = ts % NANOS_PER_SEC;
+	return true;
+}
+
+template <class ObjHeader>
+int write_packet(
+	FrameSink& sink,
+	uint16_t link_type,
+	ObjHeader* oh,
+	uint32_t length,
+	const uint8_t* data,
+	const encode_options& options,
+	uint32_t flags = 0,
+	uint32_t hw_channel = 0,
+	uint32_t original_length = 0
+) {
+	Frame frame;
+	if (!make_frame(frame, link_type, oh, options, flags, hw_channel)) return -3;
+
+	frame.length = options.captured_length(link_type, length);
+	frame.original_length = std::max(original_length, length);
+	frame.data = data;
+
+	sink.write_frame(frame);
+
+	return 0;
+}
+
+template <class TCanMessage>
+void write_can_message(FrameSink& sink, TCanMessage* obj, const encode_options& options) {
+	CanFrame can;
+
+	can.id(obj->id);
+	can.rtr(HAS_FLAG(obj->flags, 7));
+	can.len(obj->dlc);
+	can.data(obj->data.data(), obj->data.size());
+
+	uint32_t flags = HAS_FLAG(obj->flags, 0) ? DIR_OUT : DIR_IN;
+
+	write_packet(sink, LINKTYPE_CAN, obj, can.size(), can.bytes(), options, flags);
+}
+
+// CAN_MESSAGE = 1
+void write(FrameSink& sink, CanMessage* obj, const encode_options& options) {
+	write_can_message(sink, obj, options);
+}
+
+// CAN_MESSAGE2
+void write(FrameSink& sink, CanMessage2* obj, const encode_options& options) {
+	write_can_message(sink, obj, options);
+}
+
+// CAN_MESSAGE = 1, CAN_MESSAGE2
+void write(FrameSink& sink, CanMessageView* obj, const encode_options& options) {
+	write_can_message(sink, obj, options);
+}
+
+template <class CanError>
+void write_can_error(FrameSink& sink, CanError* obj, const encode_options& options) {
+
+	CanFrame can;
+	can.err(true);
+	can.len(8);
+	write_packet(sink, LINKTYPE_CAN, obj, can.size(), can.bytes(), options);
+}
+
+// CAN_ERROR = 2
+void write(FrameSink& sink, CanErrorFrame* obj, const encode_options& options) {
+
+	write_can_error(sink, obj, options);
+}
+
+// CAN_ERROR_EXT = 73
+void write(FrameSink& sink, CanErrorFrameExt* obj, const encode_options& options) {
+
+	write_can_error(sink, obj, options);
+}
+
+template <class TCanFdMessage>
+void write_can_fd_message(FrameSink& sink, TCanFdMessage* obj, const encode_options& options) {
+
+	CanFrame can;
+
+	can.id(obj->id);
+
+	can.rtr(HAS_FLAG(obj->flags, 7));
+
+	can.esi(HAS_FLAG(obj->canFdFlags, 2));
+	can.brs(HAS_FLAG(obj->canFdFlags, 1));
+
+	can.len(obj->validDataBytes);
+	can.data(obj->data.data(), obj->data.size());
+
+	uint32_t flags = HAS_FLAG(obj->flags, 0) ? DIR_OUT : DIR_IN;
+
+	write_packet(sink, LINKTYPE_CAN, obj, can.size(), can.bytes(), options, flags);
+}
+
+// CAN_FD_MESSAGE = 100
+void write(FrameSink& sink, CanFdMessage* obj, const encode_options& options) {
+	write_can_fd_message(sink, obj, options);
+}
+
+void write(FrameSink& sink, CanFdMessageView* obj, const encode_options& options) {
+	write_can_fd_message(sink, obj, options);
+}
+
+template <class TCanFdMessage64>
+void write_can_fd_message64(FrameSink& sink, TCanFdMessage64* obj, const encode_options& options) {
+
+	CanFrame can;
+
+	can.id(obj->id);
+
+	can.rtr(HAS_FLAG(obj->flags, 4));
+
+	can.esi(HAS_FLAG(obj->flags, 14));
+	can.brs(HAS_FLAG(obj->flags, 13));
+
+	can.len(obj->validDataBytes);
+	can.data(obj->data.data(), obj->data.size());
+
+	// TODO obj->crc
+
+	uint32_t flags = HAS_FLAG(obj->flags, 6) || HAS_FLAG(obj->flags, 7) ? DIR_OUT : DIR_IN;
+
+	write_packet(sink, LINKTYPE_CAN, obj, can.size(), can.bytes(), options);
+}
+
+// CAN_FD_MESSAGE_64 = 101
+void write(FrameSink& sink, CanFdMessage64* obj, const encode_options& options) {
+	write_can_fd_message64(sink, obj, options);
+}
+
+void write(FrameSink& sink, CanFdMessage64View* obj, const encode_options& options) {
+	write_can_fd_message64(sink, obj, options);
+}
+
+// CAN_FD_ERROR_64 = 104
+void write(FrameSink& sink, CanFdErrorFrame64* obj, const encode_options& options) {
+
+	write_can_error(sink, obj, options);
+}
+
+// ETHERNET_FRAME = 71
+void write(FrameSink& sink, EthernetFrame* obj, const encode_options& options) {
+
+	uint32_t flags = 0;
+	switch (obj->dir)
+	{
+	case 0:
+		flags = DIR_IN;
+		break;
+	case 1:
+		flags = DIR_OUT;
+		break;
+	}
+
+	uint32_t header_length = obj->tpid ? 18 : 14;
+	uint32_t original_length = header_length + (uint32_t)obj->payLoad.size();
+	// Payload beyond the snap length is not copied
+	uint32_t captured_length = options.captured_length(LINKTYPE_ETHERNET, original_length);
+	uint32_t payload_length = captured_length > header_length ? captured_length - header_length : 0;
+
+	std::vector<uint8_t> eth;
+	// Pre allocate to remove need of reallocation
+	eth.reserve(header_length + payload_length);
+
+	eth.insert(eth.end(), obj->destinationAddress.begin(), obj->destinationAddress.end());
+	eth.insert(eth.end(), obj->sourceAddress.begin(), obj->sourceAddress.end());
+
+	if (obj->tpid) {
+		std::array<uint8_t, 4> vlan = {
+			(uint8_t)(obj->tpid >> 8),
+			(uint8_t)obj->tpid,
+			(uint8_t)(obj->tci >> 8),
+			(uint8_t)obj->tci
+		};
+		eth.insert(eth.end(), vlan.begin(), vlan.end());
+	}
+
+	eth.push_back((uint8_t)(obj->type >> 8));
+	eth.push_back((uint8_t)obj->type);
+
+	eth.insert(eth.end(), obj->payLoad.begin(), obj->payLoad.begin() + payload_length);
+	
+	write_packet(sink, LINKTYPE_ETHERNET, obj, eth.size(), eth.data(), options, flags, 0, original_length);
+}
+
+template <class TEthernetFrame>
+void write_ethernet_frame(FrameSink& sink, TEthernetFrame* obj, const encode_options& options) {
+	uint32_t flags = 0;
+	switch (obj->dir)
+	{
+	case 0:
+		flags = DIR_IN;
+		break;
+	case 1:
+		flags = DIR_OUT;
+		break;
+	}
+
+	uint32_t original_length = (uint32_t)obj->frameData.size() + (HAS_FLAG(obj->flags, 3) ? 4 : 0);
+	if (options.captured_length(LINKTYPE_ETHERNET, original_length) <= obj->frameData.size()) {
+		// No checksum to append or it is cut off, frame data can be written as is
+		write_packet(sink, LINKTYPE_ETHERNET, obj, (uint32_t)obj->frameData.size(), obj->frameData.data(), options, flags, obj->hardwareChannel, original_length);
+		return;
+	}
+
+	std::vector<uint8_t> eth(obj->frameData.begin(), obj->frameData.end());
+	uint8_t* crcPtr = (uint8_t*)&obj->frameChecksum;
+	eth.insert(eth.end(), crcPtr, crcPtr + 4);
+
+	write_packet(sink, LINKTYPE_ETHERNET, obj, (uint32_t)eth.size(), eth.data(), options, flags, obj->hardwareChannel);
+}
+
+// ETHERNET_FRAME_EX = 120
+void write(FrameSink& sink, EthernetFrameEx* obj, const encode_options& options) {
+
+	write_ethernet_frame(sink, obj, options);
+}
+
+// ETHERNET_FRAME_FORWARDED = 121
+void write(FrameSink& sink, EthernetFrameForwarded* obj, const encode_options& options) {
+
+	write_ethernet_frame(sink, obj, options);
+}
+
+// ETHERNET_FRAME_EX = 120, ETHERNET_FRAME_FORWARDED = 121
+void write(FrameSink& sink, EthernetFrameExView* obj, const encode_options& options) {
+
+	write_ethernet_frame(sink, obj, options);
+}
+
+/* Consecutive CAN messages, their SocketCAN bytes are encoded together */
+struct can_run {
+	can_records records;
+	std::array<Frame, CAN_RECORD_BATCH> frames;
+	std::array<uint8_t, CAN_RECORD_BATCH * CAN_RECORD_STRIDE> bytes;
+};
+
+void flush_can_run(FrameSink& sink, can_run& run, const encode_options& options) {
+	encode_can_records(run.records, run.bytes.data());
+	for (size_t i = 0; i < run.records.count; i++) {
+		Frame& frame = run.frames[i];
+		uint32_t length = std::min<uint32_t>(run.records.length[i], 64) + 8;
+		frame.data = run.bytes.data() + i * CAN_RECORD_STRIDE;
+		frame.length = options.captured_length(LINKTYPE_CAN, length);
+		frame.original_length = length;
+		sink.write_frame(frame);
+	}
+	run.records.count = 0;
+}
+
+template <class TCanMessage>
+void add_can_record(can_run& run, TCanMessage* obj, uint32_t flags, uint8_t rtr, uint8_t fd_flags, uint8_t length, const encode_options& options) {
+	can_records& records = run.records;
+	size_t i = records.count;
+	if (!make_frame(run.frames[i], LINKTYPE_CAN, obj, options, flags)) return;
+	records.id[i] = obj->id;
+	records.rtr[i] = rtr;
+	records.fd_flags[i] = fd_flags;
+	records.length[i] = length;
+	records.data[i] = obj->data.data();
+	records.data_size[i] = (uint8_t)std::min<size_t>(obj->data.size(), 64);
+	records.count++;
+}
+
+// Same fields as write_can_message, write_can_fd_message and write_can_fd_message64
+void add_can_record(can_run& run, CanMessageView* obj, const encode_options& options) {
+	add_can_record(run, obj, HAS_FLAG(obj->flags, 0) ? DIR_OUT : DIR_IN,
+		HAS_FLAG(obj->flags, 7) ? CAN_RECORD_RTR : 0, 0, obj->dlc, options);
+}
+
+void add_can_record(can_run& run, CanFdMessageView* obj, const encode_options& options) {
+	uint8_t fd_flags = (HAS_FLAG(obj->canFdFlags, 1) ? CAN_RECORD_BRS : 0) | (HAS_FLAG(obj->canFdFlags, 2) ? CAN_RECORD_ESI : 0);
+	add_can_record(run, obj, HAS_FLAG(obj->flags, 0) ? DIR_OUT : DIR_IN,
+		HAS_FLAG(obj->flags, 7) ? CAN_RECORD_RTR : 0, fd_flags, obj->validDataBytes, options);
+}
+
+void add_can_record(can_run& run, CanFdMessage64View* obj, const encode_options& options) {
+	uint8_t fd_flags = (HAS_FLAG(obj->flags, 13) ? CAN_RECORD_BRS : 0) | (HAS_FLAG(obj->flags, 14) ? CAN_RECORD_ESI : 0);
+	add_can_record(run, obj, 0, HAS_FLAG(obj->flags, 4) ? CAN_RECORD_RTR : 0, fd_flags, obj->validDataBytes, options);
+}
+
+/* Adds CAN and CAN FD messages to run, false for other objects */
+bool add_can_record(can_run& run, const ObjectRef& object, const encode_options& options) {
+	switch (object.type) {
+
+	case ObjectType::CAN_MESSAGE:
+	case ObjectType::CAN_MESSAGE2: {
+		CanMessageView view(object);
+		add_can_record(run, &view, options);
+		return true;
+	}
+
+	case ObjectType::CAN_FD_MESSAGE: {
+		CanFdMessageView view(object);
+		add_can_record(run, &view, options);
+		return true;
+	}
+
+	case ObjectType::CAN_FD_MESSAGE_64: {
+		CanFdMessage64View view(object);
+		add_can_record(run, &view, options);
+		return true;
+	}
+
+	default:
+		return false;
+	}
+}
+
+void set_measurment_header(uint8_t& measurementHeader, FlexRayPacketType packetType, uint16_t channelMask = 0)
+{
+	/// Measurement Header (1 byte)
+	// TI[0..6]: Type Index
+	// 0x01: FlexRay Frame
+	// 0x02: FlexRay Symbol
+	switch (packetType)
+	{
+	case FlexRayPacketType::FlexRayFrame:
+		measurementHeader = 0x01;
+		break;
+	case FlexRayPacketType::FlexRaySymbol:
+		measurementHeader = 0x02;
+		break;
+	}
+	// CH: Channel, indicates the Channel
+	// 1	: Channel A
+	// 2/3	: Channel B
+	switch (channelMask)
+	{
+	case 1: /* Channel A */
+		break;
+	case 2: /* Channel B */
+	case 3: /* Channel B */
+		measurementHeader |= 0x80;
+		break;
+	}
+}
+
+void set_header_crc(uint16_t channelMask, uint16_t headerCrc1, uint16_t headerCrc2, uint16_t& headerCrc)
+{
+	// CH: Channel, indicates the Channel
+	// 1	: Channel A
+	// 2/3	: Channel B
+	switch (channelMask)
+	{
+	case 1: /* Channel A */
+		headerCrc = headerCrc1;
+		break;
+	case 2: /* Channel B */
+	case 3: /* Channel B */
+		headerCrc = headerCrc2;
+		break;
+	}
+}
+
+void set_header_flags(uint16_t frameState, uint8_t& headerFlags)
+{
+	if (HAS_FLAG(frameState, 0))
+	{
+		headerFlags |= 0x08; // Payload preample indicator bit set to 1
+	}
+	if (HAS_FLAG(frameState, 1))
+	{
+		headerFlags |= 0x02; // Sync. frame indicator bit set to 1
+	}
+	if (HAS_FLAG(frameState, 2))
+	{
+		headerFlags |= 0x10; // Reserved bit set to 1
+	}
+	if (!HAS_FLAG(frameState, 3))
+	{
+		headerFlags |= 0x04; // Null frame indicator bit set to 1
+	}
+	if (HAS_FLAG(frameState, 4))
+	{
+		headerFlags |= 0x01; // Startup frame indicator bit set to 1
+	}
+}
+
+void set_header_flags_rcv_msg(uint32_t frameFlags, uint8_t& headerFlags)
+{
+	if (!HAS_FLAG(frameFlags, 0))
+	{
+		headerFlags |= 0x04; // Null frame indicator bit set to 1
+	}
+	if (HAS_FLAG(frameFlags, 2))
+	{
+		headerFlags |= 0x02; // Sync. frame indicator bit set to 1
+	}
+	if (HAS_FLAG(frameFlags, 3))
+	{
+		headerFlags |= 0x01; // Startup frame indicator bit set to 1
+	}
+	if (HAS_FLAG(frameFlags, 4))
+	{
+		headerFlags |= 0x08; // Payload preample indicator bit set to 1
+	}
+	if (HAS_FLAG(frameFlags, 5))
+	{
+		headerFlags |= 0x10; // Reserved bit set to 1
+	}
+}
+
+void set_header(uint64_t& header, uint8_t headerFlags, uint64_t payloadLength, uint8_t cycleCount = 0, uint16_t frameId = 0, uint16_t headerCrc = 0)
+{
+	header = (static_cast<uint64_t>(headerFlags) << 35) | (static_cast<uint64_t>(payloadLength & 0x7F) << 17);
+	if (cycleCount != 0)
+	{
+		header |= static_cast<uint64_t>(cycleCount & 0x3F);
+	}
+	if (frameId != 0)
+	{
+		header |= (static_cast<uint64_t>(frameId & 0x07FF) << 24);
+	}
+	if (headerCrc != 0)
+	{
+		header |= (static_cast<uint64_t>(headerCrc & 0x07FF) << 6);
+	}
+
+	// Convert from Host Byte Order to Network Byte Order (network order is big endian)
+	header = hton64(header);
+}
+
+// FLEXRAY_DATA = 29
+void write(FrameSink& sink, FlexRayData* obj, const encode_options& options) {
+
+	uint64_t header = 0;
+	uint8_t headerFlags = 0;
+	std::array<uint8_t, 261> flexrayData;
+
+	memset(&flexrayData, 0, sizeof(flexrayData));
+
+	/// Measurement Header (1 byte)
+	set_measurment_header(flexrayData[0], FlexRayPacketType::FlexRayFrame);
+
+	/// Error Flags Information (1 byte) -> set to 0
+
+	/// FlexRay Frame Header (5 bytes)
+	//  - Header flags
+	headerFlags |= 0x04; // Null Frame: False (indicator bit set to 1)
+	//  - Payload length
+	uint64_t len = obj->dataBytes.size() / 2;
+	set_header(header, headerFlags, len, 0, obj->messageId, obj->crc);
+
+	// Copy only 5 bytes of header to flexrayData
+	uint8_t* headerPtr = (uint8_t*)&header;
+	memcpy(&flexrayData[2], headerPtr + 3, 5);
+
+	// FlexRay Frame Payload (0-254 bytes)
+	std::copy(obj->dataBytes.begin(), obj->dataBytes.end(), flexrayData.begin() + 7);
+
+	write_packet(sink, LINKTYPE_FLEXRAY, obj, obj->dataBytes.size() + 7, flexrayData.data(), options);
+}
+
+// FLEXRAY_SYNC = 30
+void write(FrameSink& sink, FlexRaySync* obj, const encode_options& options) {
+
+	uint64_t header = 0;
+	uint8_t headerFlags = 0;
+	std::array<uint8_t, 261> flexrayData;
+
+	memset(&flexrayData, 0, sizeof(flexrayData));
+
+	/// Measurement Header (1 byte)
+	set_measurment_header(flexrayData[0], FlexRayPacketType::FlexRayFrame);
+
+	/// Error Flags Information (1 byte) -> set to 0
+
+	/// FlexRay Frame Header (5 bytes)
+	//  - Header flags
+	headerFlags |= 0x04; // Null Frame: False (indicator bit set to 1)
+	headerFlags |= 0x02; // Sync. frame indicator bit set to 1
+
+	/// FlexRay Frame Header (5 bytes)
+	//  - Payload length
+	uint64_t len = obj->dataBytes.size() / 2;
+	set_header(header, headerFlags, len, obj->cycle, obj->messageId, obj->crc);
+
+	// Copy only 5 bytes of header to flexrayData
+	uint8_t* headerPtr = (uint8_t*)&header;
+	memcpy(&flexrayData[2], headerPtr + 3, 5);
+
+	// FlexRay Frame Payload (0-254 bytes)
+	std::copy(obj->dataBytes.begin(), obj->dataBytes.end(), flexrayData.begin() + 7);
+
+	write_packet(sink, LINKTYPE_FLEXRAY, obj, obj->dataBytes.size() + 7, flexrayData.data(), options);
+}
+
+// FLEXRAY_CYCLE = 40
+void write(FrameSink& sink, FlexRayV6StartCycleEvent* obj, const encode_options& options) {
+
+	uint64_t header = 0;
+	uint8_t headerFlags = 0;
+	std::array<uint8_t, 261> flexrayData;
+
+	memset(&flexrayData, 0, sizeof(flexrayData));
+
+	/// Measurement Header (1 byte)
+	set_measurment_header(flexrayData[0], FlexRayPacketType::FlexRayFrame);
+
+	/// Error Flags Information (1 byte) -> set to 0
+
+	/// FlexRay Frame Header (5 bytes)
+	//  - Header flags
+	headerFlags |= 0x04; // Null Frame: False (indicator bit set to 1)
+	//  - Payload length
+	uint64_t len = obj->dataBytes.size() / 2;
+	set_header(header, headerFlags, len);
+
+	// Copy only 5 bytes of header to flexrayData
+	uint8_t* headerPtr = (uint8_t*)&header;
+	memcpy(&flexrayData[2], headerPtr + 3, 5);
+
+	// FlexRay Frame Payload (0-254 bytes)
+	std::copy(obj->dataBytes.begin(), obj->dataBytes.end(), flexrayData.begin() + 7);
+
+	write_packet(sink, LINKTYPE_FLEXRAY, obj, obj->dataBytes.size() + 7, flexrayData.data(), options);
+}
+
+// FLEXRAY_MESSAGE = 41
+void write(FrameSink& sink, FlexRayV6Message* obj, const encode_options& options) {
+
+	uint64_t header = 0;
+	uint8_t headerFlags = 0;
+	std::array<uint8_t, 261> flexrayData;
+
+	memset(&flexrayData, 0, sizeof(flexrayData));
+
+	/// Measurement Header (1 byte)
+	set_measurment_header(flexrayData[0], FlexRayPacketType::FlexRayFrame);
+
+	/// Error Flags Information (1 byte) -> set to 0
+
+	/// FlexRay Frame Header (5 bytes)
+	set_header_flags(obj->frameState, headerFlags);
+	uint64_t len = obj->dataBytes.size() / 2;
+	set_header(header, headerFlags, len, obj->cycle, obj->frameId, obj->headerCrc);
+
+	// Copy only 5 bytes of header to flexrayData
+	uint8_t* headerPtr = (uint8_t*)&header;
+	memcpy(&flexrayData[2], headerPtr + 3, 5);
+
+	// FlexRay Frame Payload (0-254 bytes)
+	std::copy(obj->dataBytes.begin(), obj->dataBytes.end(), flexrayData.begin() + 7);
+
+	write_packet(sink, LINKTYPE_FLEXRAY, obj, obj->dataBytes.size() + 7, flexrayData.data(), options);
+}
+
+// FR_ERROR = 47
+void write(FrameSink& sink, FlexRayVFrError* obj, const encode_options& options) {
+
+	uint64_t header = 0;
+	uint8_t headerFlags = 0;
+	std::array<uint8_t, 7> flexrayData;
+
+	memset(&flexrayData, 0, sizeof(flexrayData));
+
+	/// Measurement Header (1 byte)
+	set_measurment_header(flexrayData[0], FlexRayPacketType::FlexRayFrame, obj->channelMask);
+
+	/// Error Flags Information (1 byte)
+	flexrayData[1] |= 0x02; // Coding error bit (CODERR) set to 1
+
+	/// FlexRay Frame Header (5 bytes)
+	//  - Header flags
+	headerFlags |= 0x04; // Null Frame: False (indicator bit set to 1)
+	set_header(header, headerFlags, 0, obj->cycle);
+
+	// Copy only 5 bytes of header to flexrayData
+	uint8_t* headerPtr = (uint8_t*)&header;
+	memcpy(&flexrayData[2], headerPtr + 3, 5);
+
+	/// FlexRay Frame Payload (0-254 bytes) -> no payload
+
+	write_packet(sink, LINKTYPE_FLEXRAY, obj, 7, flexrayData.data(), options);
+}
+
+// FR_STATUS = 48
+void write(FrameSink& sink, FlexRayVFrStatus* obj, const encode_options& options) {
+
+	std::array<uint8_t, 2> flexraySymbolData;
+
+	memset(&flexraySymbolData, 0, sizeof(flexraySymbolData));
+
+	/// Measurement Header (1 byte)
+	set_measurment_header(flexraySymbolData[0], FlexRayPacketType::FlexRaySymbol, obj->channelMask);
+
+	/// Symbol length (1 byte)
+	if (obj->tag == 3) /* BUSDOCTOR */
+	{
+		flexraySymbolData[1] = obj->data[1] & 0xFF;
+	}
+	if (obj->tag == 5) /* VN-Interface */
+	{
+		flexraySymbolData[1] = obj->data[0] & 0xFF;
+	}
+
+	write_packet(sink, LINKTYPE_FLEXRAY, obj, 2, flexraySymbolData.data(), options);
+}
+
+// FR_STARTCYCLE = 49
+void write(FrameSink& sink, FlexRayVFrStartCycle* obj, const encode_options& options) {
+
+	uint64_t header = 0;
+	uint8_t headerFlags = 0;
+	std::array<uint8_t, 19> flexrayData;
+
+	memset(&flexrayData, 0, sizeof(flexrayData));
+
+	/// Measurement Header (1 byte)
+	set_measurment_header(flexrayData[0], FlexRayPacketType::FlexRayFrame, obj->channelMask);
+
+	/// Error Flags Information (1 byte) -> set to 0
+
+	/// FlexRay Frame Header (5 bytes)
+	//  - Header flags
+	headerFlags |= 0x04; // Null Frame: False (indicator bit set to 1)
+	//  - Payload length
+	uint64_t len = obj->dataBytes.size() / 2;
+	set_header(header, headerFlags, len, obj->cycle);
+
+	// Copy only 5 bytes of header to flexrayData
+	uint8_t* headerPtr = (uint8_t*)&header;
+	memcpy(&flexrayData[2], headerPtr + 3, 5);
+
+	// FlexRay Frame Payload (0-254 bytes)
+	std::copy(obj->dataBytes.begin(), obj->dataBytes.end(), flexrayData.begin() + 7);
+
+	write_packet(sink, LINKTYPE_FLEXRAY, obj, obj->dataBytes.size() + 7, flexrayData.data(), options);
+}
+
+// FR_RCVMESSAGE = 50
+void write(FrameSink& sink, FlexRayVFrReceiveMsg* obj, const encode_options& options) {
+
+	uint64_t header = 0;
+	uint16_t headerCrc = 0;
+	uint8_t headerFlags = 0;
+	std::array<uint8_t, 261> flexrayData;
+
+	memset(&flexrayData, 0, sizeof(flexrayData));
+
+	/// Measurement Header (1 byte)
+	set_measurment_header(flexrayData[0], FlexRayPacketType::FlexRayFrame, obj->channelMask);
+
+	/// Error Flags Information (1 byte) -> case Error flag (error frame or invalid frame) set to 1
+	if (HAS_FLAG(obj->frameFlags, 6))
+	{
+		flexrayData[1] |= 0x10; // FCRCERR bit set to 1
+	}
+
+	/// FlexRay Frame Header (5 bytes)
+	//  - Header flags
+	set_header_flags_rcv_msg(obj->frameFlags, headerFlags);
+	// 	- Header CRC
+	set_header_crc(obj->channelMask, obj->headerCrc1, obj->headerCrc2, headerCrc);
+	//  - Payload length
+	uint64_t len = obj->dataBytes.size() / 2;
+	set_header(header, headerFlags, len, obj->cycle, obj->frameId, headerCrc);
+
+	// Copy only 5 bytes of header to flexrayData
+	uint8_t* headerPtr = (uint8_t*)&header;
+	memcpy(&flexrayData[2], headerPtr + 3, 5);
+
+	// FlexRay Frame Payload (0-254 bytes)
+	std::copy(obj->dataBytes.begin(), obj->dataBytes.end(), flexrayData.begin() + 7);
+
+	write_packet(sink, LINKTYPE_FLEXRAY, obj, obj->dataBytes.size() + 7, flexrayData.data(), options);
+}
+
+// FR_RCVMESSAGE_EX = 66
+void write(FrameSink& sink, FlexRayVFrReceiveMsgEx* obj, const encode_options& options) {
+
+	uint64_t header = 0;
+	uint16_t headerCrc = 0;
+	uint8_t headerFlags = 0;
+	uint8_t measurementHeader = 0;
+	uint8_t errorFlagsInfo = 0;
+	std::vector<uint8_t> flexrayData;
+
+	flexrayData.clear();
+
+	/// Measurement Header (1 byte)
+	set_measurment_header(measurementHeader, FlexRayPacketType::FlexRayFrame, obj->channelMask);
+
+	flexrayData.push_back(measurementHeader);
+
+	/// Error Flags Information (1 byte) -> case Error flag (error frame or invalid frame) set to 1
+	if (HAS_FLAG(obj->frameFlags, 6))
+	{
+		errorFlagsInfo |= 0x10; // FCRCERR bit set to 1
+	}
+	flexrayData.push_back(errorFlagsInfo);
+
+	/// FlexRay Frame Header (5 bytes)
+	//  - Header flags
+	set_header_flags_rcv_msg(obj->frameFlags, headerFlags);
+	// 	- Header CRC
+	set_header_crc(obj->channelMask, obj->headerCrc1, obj->headerCrc2, headerCrc);
+	//  - Payload length
+	uint64_t len = obj->dataBytes.size() / 2;
+	set_header(header, headerFlags, len, obj->cycle, obj->frameId, headerCrc);
+
+	// Copy only 5 bytes of header to flexrayData
+	uint8_t* headerPtr = (uint8_t*)&header;
+	std::vector<uint8_t> headerVec(headerPtr + 3, headerPtr + 8);
+	flexrayData.insert(flexrayData.end(), headerVec.begin(), headerVec.end());
+
+	// FlexRay Frame Payload (0-254 bytes)
+	flexrayData.insert(flexrayData.end(), obj->dataBytes.begin(), obj->dataBytes.end());
+
+	write_packet(sink, LINKTYPE_FLEXRAY, obj, obj->dataBytes.size() + 7, flexrayData.data(), options);
+}
+
+namespace blf_converter {
+
+	std::uint64_t systemtime_ns(const Vector::BLF::SYSTEMTIME& time) {
+		struct tm tms = { 0 };
+		tms.tm_year = time.year - 1900;
+		tms.tm_mon = time.month - 1;
+		tms.tm_mday = time.day;
+		tms.tm_hour = time.hour;
+		tms.tm_min = time.minute;
+		tms.tm_sec = time.second;
+
+		time_t ret = mktime(&tms);
+
+		ret *= 1000;
+		ret += time.milliseconds;
+		ret *= 1000 * 1000;
+
+		return ret;
+	}
+
+}
+
+uint64_t calculate_startdate(const Vector::BLF::FileStatistics& fileStatistics) {
+	return blf_converter::systemtime_ns(fileStatistics.measurementStartTime);
+}
+
+/* Encodes a LIN frame following the LINKTYPE_LIN layout */
+uint32_t encode_lin(const lin_frame& lin, uint8_t* buffer) {
+	uint8_t payload_length = std::min<uint8_t>(lin.payload_length, 8);
+	memset(buffer, 0, 8);
+	buffer[0] = 1; // Message format revision
+	buffer[4] = payload_length << 4; // Payload length, message type frame
+	buffer[5] = lin.pid;
+	buffer[6] = lin.checksum;
+	buffer[7] = lin.errors;
+	memcpy(buffer + 8, lin.data, payload_length);
+	return 8 + payload_length;
+}
+
+int write_lin(
+	FrameSink& sink,
+	const pcapng_exporter::frame_header& header,
+	const lin_frame& lin)
+{
+	std::array<uint8_t, 16> linData;
+
+	Frame frame = Frame();
+	frame.link_type = LINKTYPE_LIN;
+	frame.channel_id = header.channel_id;
+	frame.timestamp_resolution = header.timestamp_resolution;
+	frame.timestamp.tv_sec = header.timestamp.tv_sec;
+	frame.timestamp.tv_nsec = header.timestamp.tv_nsec;
+	frame.length = encode_lin(lin, linData.data());
+	frame.data = linData.data();
+	frame.lin = &lin;
+
+	sink.write_frame(frame);
+	return 0;
+}
+
+template<class LinErrorBase>
+int write_lin_error(
+	FrameSink& sink,
+	LinErrorBase* lerr,
+	std::uint8_t errors,
+	const encode_options& options)
+{
+	pcapng_exporter::frame_header header = generate_header(lerr, options.date_offset_ns);
+	if (header.timestamp_resolution == 0) return -3;
+	lin_frame frame = lin_frame();
+	frame.errors = errors;
+	return write_lin(sink, header, frame);
+}
+
+template<class LinMessageBase>
+int write_lin_message(
+	FrameSink& sink,
+	LinMessageBase* msg,
+	const encode_options& options)
+{
+	pcapng_exporter::frame_header header = generate_header(msg, options.date_offset_ns);
+	if (header.timestamp_resolution == 0) return -3;
+	lin_frame frame = lin_frame();
+	frame.pid = msg->id;
+	frame.payload_length = (std::uint8_t)(msg->data.size());
+	memcpy(frame.data, &(msg->data), frame.payload_length);
+	frame.checksum = msg->crc;
+	return write_lin(sink, header, frame);
+}
+
+/* Timestamp relative to the measurement start, false for unknown resolutions */
+template<class ObjectHeaderGeneric>
+bool relative_time_ns(ObjectHeaderGeneric* oh, uint64_t& ns) {
+	uint64_t ts_resol = calculate_ts_res(oh);
+	if (ts_resol == 0) return false;
+	ns = (NANOS_PER_SEC / ts_resol) * oh->objectTimeStamp;
+	return true;
+}
+
+template<class ObjectHeaderGeneric>
+void summarize_message(Summary& summary, Bus bus, ObjectHeaderGeneric* oh, uint32_t channel, uint32_t id) {
+	uint64_t ns;
+	if (relative_time_ns(oh, ns)) {
+		summary.add_message(bus, channel, id, ns);
+	}
+}
+
+template<class ObjectHeaderGeneric>
+void summarize_error(Summary& summary, Bus bus, ObjectHeaderGeneric* oh) {
+	uint64_t ns;
+	if (relative_time_ns(oh, ns)) {
+		summary.add_error(bus, oh->channel, ns);
+	}
+}
+
+template<class ObjectHeaderGeneric>
+void summarize_message(Summary& summary, Bus bus, ObjectHeaderGeneric* oh, uint32_t id) {
+	summarize_message(summary, bus, oh, oh->channel, id);
+}
+
+namespace blf_converter {
+
+	bool Converter::open(const std::string& path) {
+		reader.open(path);
+		if (!reader.is_open()) {
+			return false;
+		}
+		options.date_offset_ns = calculate_startdate(reader.fileStatistics);
+		return true;
+	}
+
+	template<class Handler>
+	bool Converter::read_objects(Handler handler) {
+		ObjectRef object;
+		auto last_progress = std::chrono::steady_clock::now();
+		for (uint64_t count = 1; ; count++) {
+			/* read and capture exceptions, e.g. unfinished files */
+			try {
+				if (stop_offset >= 0) {
+					std::streamoff offset;
+					std::uint64_t skip;
+					reader.tell(offset, skip);
+					if (offset >= stop_offset) {
+						return true;
+					}
+				}
+				if (!reader.next(object)) {
+					if (reader.truncated() && !following) {
+						/* only follow() waits for the rest of an unfinished file */
+						std::cerr << "Truncated container at the end of the file" << std::endl;
+						return false;
+					}
+					return true;
+				}
+				read_count++;
+				handler(object);
+			}
+			catch (std::runtime_error& e) {
+				/* stderr, stdout may carry a report */
+				std::cerr << "Exception: " << e.what() << std::endl;
+				if (!reader.recover) {
+					return false;
+				}
+			}
+
+			/* checking the clock on every object is too expensive */
+			if (progress_callback && count % 1024 == 0) {
+				auto now = std::chrono::steady_clock::now();
+				if (now - last_progress >= progress_interval) {
+					last_progress = now;
+					progress_callback();
+				}
+			}
+		}
+	}
+
+	bool Converter::run(FrameSink& sink) {
+		if (worker_threads > 1) {
+			return run_parallel(*encoding_pool(sink));
+		}
+		/* CAN messages are encoded in runs, written before their container data is replaced */
+		auto run = std::make_unique<can_run>();
+		reader.on_refill = [&]() {
+			flush_can_run(sink, *run, options);
+		};
+		/* a checkpoint must not be ahead of the written frames */
+		std::function<void()> callback = progress_callback;
+		if (callback) {
+			progress_callback = [&]() {
+				flush_can_run(sink, *run, options);
+				callback();
+			};
+		}
+		bool complete = read_objects([&](const ObjectRef& object) {
+			if (run_summary) {
+				summarize(object, *run_summary);
+			}
+			std::uint64_t trigger_ns;
+			if (trigger_time(object, trigger_ns)) {
+				/* the frames before the trigger must reach the sink first */
+				flush_can_run(sink, *run, options);
+				trigger_callback(trigger_ns);
+			}
+			if (!keep(object)) {
+				return;
+			}
+			if (!add_can_record(*run, object, options)) {
+				/* frames stay in object order */
+				flush_can_run(sink, *run, options);
+				convert(object, sink);
+			}
+			else if (run->records.count == CAN_RECORD_BATCH) {
+				flush_can_run(sink, *run, options);
+			}
+		});
+		flush_can_run(sink, *run, options);
+		reader.on_refill = nullptr;
+		progress_callback = callback;
+		return complete;
+	}
+
+	std::unique_ptr<EncodingPool> Converter::encoding_pool(FrameSink& sink) {
+		return std::make_unique<EncodingPool>(worker_threads, [this](const ObjectRef* objects, std::size_t count, FrameSink& output) {
+			return convert(objects, count, output);
+		}, sink, reader.budget);
+	}
+
+	bool Converter::run_parallel(EncodingPool& pool) {
+		/* a checkpoint must not be ahead of the written frames */
+		std::function<void()> callback = progress_callback;
+		if (callback) {
+			progress_callback = [&]() {
+				pool.wait();
+				callback();
+			};
+		}
+		bool complete = read_objects([&](const ObjectRef& object) {
+			if (pool.failed() && !reader.recover) {
+				throw std::runtime_error("Unable to convert an object");
+			}
+			if (run_summary) {
+				summarize(object, *run_summary);
+			}
+			std::uint64_t trigger_ns;
+			if (trigger_time(object, trigger_ns)) {
+				/* ordered with the frames of the objects added before */
+				pool.call([this, trigger_ns]() { trigger_callback(trigger_ns); });
+			}
+			if (object.type == ObjectType::APP_TEXT) {
+				/* mappings change on this thread, ordered with the frames around them */
+				convert(object, pool);
+				return;
+			}
+			/* decimation depends on the object order */
+			if (keep(object)) {
+				pool.add(object);
+			}
+		});
+		pool.wait();
+		progress_callback = callback;
+		return complete && (reader.recover || !pool.failed());
+	}
+
+	void Converter::collect_summary(Summary* summary) {
+		run_summary = summary;
+		if (summary) {
+			summary->measurement_start_ns = options.date_offset_ns;
+		}
+	}
+
+	bool Converter::summarize(Summary& summary) {
+		summary.measurement_start_ns = options.date_offset_ns;
+		return read_objects([&](const ObjectRef& object) { summarize(object, summary); });
+	}
+
+	void Converter::follow(FrameSink& sink, const std::atomic<bool>& stop, std::chrono::milliseconds interval) {
+		/* the workers are started once, not on every poll */
+		std::unique_ptr<EncodingPool> pool;
+		if (worker_threads > 1) {
+			pool = encoding_pool(sink);
+		}
+		following = true;
+		while (!stop) {
+			if (!(pool ? run_parallel(*pool) : run(sink))) {
+				break;
+			}
+			/* make the new frames visible to readers of the output */
+			if (pool) {
+				pool->flush();
+			}
+			else {
+				sink.flush();
+			}
+			if (reader.finished()) {
+				break;
+			}
+			std::this_thread::sleep_for(interval);
+		}
+		following = false;
+	}
+
+	void Converter::close() {
+		reader.close();
+	}
+
+	std::uint64_t Converter::objects_read() const {
+		return read_count;
+	}
+
+	const Vector::BLF::FileStatistics& Converter::statistics() const {
+		return reader.fileStatistics;
+	}
+
+	void Converter::recover(bool enabled) {
+		reader.recover = enabled;
+	}
+
+	const std::vector<skipped_range>& Converter::skipped() const {
+		return reader.skipped;
+	}
+
+	void Converter::decimate(std::uint32_t every, double max_rate_hz) {
+		decimator.every(every);
+		decimator.max_rate(max_rate_hz);
+	}
+
+	bool Converter::keep(const ObjectRef& object) {
+		if (!decimator.enabled()) {
+			return true;
+		}
+		/* only messages are decimated, error frames and other objects always pass */
+		switch (object.type) {
+
+		case ObjectType::CAN_MESSAGE:
+		case ObjectType::CAN_MESSAGE2: {
+			CanMessageView view(object);
+			return keep(Bus::CAN, &view, view.channel, view.id);
+		}
+
+		case ObjectType::CAN_FD_MESSAGE: {
+			CanFdMessageView view(object);
+			return keep(Bus::CAN, &view, view.channel, view.id);
+		}
+
+		case ObjectType::CAN_FD_MESSAGE_64: {
+			CanFdMessage64View view(object);
+			return keep(Bus::CAN, &view, view.channel, view.id);
+		}
+
+		case ObjectType::LIN_MESSAGE: {
+			MessageIdView view(object, 0, 2, 1);
+			return keep(Bus::LIN, &view, view.channel, view.id);
+		}
+
+		case ObjectType::LIN_MESSAGE2: {
+			// LinBusEvent channel, LinMessageDescriptor id
+			MessageIdView view(object, 12, 37, 1);
+			return keep(Bus::LIN, &view, view.channel, view.id);
+		}
+
+		case ObjectType::FLEXRAY_DATA:
+		case ObjectType::FLEXRAY_SYNC: {
+			MessageIdView view(object, 0, 4, 2);
+			return keep(Bus::FlexRay, &view, view.channel, view.id);
+		}
+
+		case ObjectType::FLEXRAY_MESSAGE: {
+			MessageIdView view(object, 0, 20, 2);
+			return keep(Bus::FlexRay, &view, view.channel, view.id);
+		}
+
+		case ObjectType::FR_RCVMESSAGE:
+		case ObjectType::FR_RCVMESSAGE_EX: {
+			MessageIdView view(object, 0, 16, 2);
+			return keep(Bus::FlexRay, &view, view.channel, view.id);
+		}
+
+		default:
+			return true;
+		}
+	}
+
+	template<class View>
+	bool Converter::keep(Bus bus, View* view, std::uint32_t channel, std::uint32_t id) {
+		uint64_t ns;
+		if (!relative_time_ns(view, ns)) {
+			return true;
+		}
+		return decimator.keep(bus, channel, id, ns);
+	}
+
+	void Converter::on_trigger(std::set<ObjectType> types, std::function<void(std::uint64_t)> callback) {
+		trigger_types = std::move(types);
+		trigger_callback = std::move(callback);
+	}
+
+	bool Converter::trigger_time(const ObjectRef& object, std::uint64_t& ns) {
+		if (!trigger_callback || trigger_types.count(object.type) == 0) {
+			return false;
+		}
+		ObjectView view(object, 0);
+		if (!relative_time_ns(&view, ns)) {
+			return false;
+		}
+		ns += options.date_offset_ns;
+		return true;
+	}
+
+	void Converter::snaplen(std::uint32_t length, std::optional<std::uint16_t> link_type) {
+		if (link_type) {
+			options.link_snaplen[*link_type] = length;
+		}
+		else {
+			options.snaplen = length;
+		}
+	}
+
+	void Converter::threads(unsigned threads) {
+		worker_threads = std::max(threads, 1u);
+	}
+
+	void Converter::memory_budget(MemoryBudget* budget) {
+		reader.budget = budget;
+	}
+
+	void Converter::huge_pages(bool enabled) {
+		reader.huge_pages = enabled;
+	}
+
+	void Converter::on_progress(std::chrono::milliseconds interval, std::function<void()> callback) {
+		progress_interval = interval;
+		progress_callback = std::move(callback);
+	}
+
+	void Converter::position(checkpoint& cp) const {
+		reader.tell(cp.container_offset, cp.container_skip);
+	}
+
+	const channel_state& Converter::channel_mappings() const {
+		return channels;
+	}
+
+	bool Converter::prescan(FrameSink& sink) {
+		std::streamoff offset;
+		std::uint64_t skip;
+		reader.tell(offset, skip);
+		size_t skipped = reader.skipped.size();
+
+		reader.seek(reader.fileStatistics.statisticsSize, 0);
+		bool complete = read_objects([&](const ObjectRef& object) {
+			/* only metadata is materialized */
+			if (object.type != ObjectType::APP_TEXT) {
+				return;
+			}
+			ObjectHeaderBase* ohb = reader.materialize(object);
+			if (ohb == nullptr) {
+				return;
+			}
+			configure(reinterpret_cast<AppText*>(ohb), sink);
+			delete ohb;
+		});
+
+		/* corrupt ranges are reported by the conversion itself */
+		reader.skipped.resize(skipped);
+		reader.seek(offset, skip);
+		metadata_frozen = true;
+		return complete;
+	}
+
+	bool Converter::index(std::vector<container_index_entry>& entries) {
+		size_t first = entries.size();
+		container_index_entry next {};
+		reader.tell(next.offset, next.skip);
+		bool complete = read_objects([&](const ObjectRef& object) {
+			container_index_entry position = next;
+			reader.tell(next.offset, next.skip);
+			uint64_t ns;
+			ObjectView view(object, 0);
+			if (!relative_time_ns(&view, ns)) {
+				return;
+			}
+			ns += options.date_offset_ns;
+			if (entries.size() == first || entries.back().offset != position.offset) {
+				position.max_ns = position.min_ns = ns;
+				entries.push_back(position);
+				return;
+			}
+			entries.back().max_ns = std::max(entries.back().max_ns, ns);
+			entries.back().min_ns = std::min(entries.back().min_ns, ns);
+		});
+
+		/* later objects can be older, e.g. with several loggers */
+		for (size_t i = entries.size(); i-- > first + 1; ) {
+			entries[i - 1].min_ns = std::min(entries[i - 1].min_ns, entries[i].min_ns);
+		}
+		return complete;
+	}
+
+	void Converter::seek(const container_index_entry& entry, FrameSink& sink) {
+		reader.seek(entry.offset, entry.skip);
+		for (const auto& mapping : channels.mappings) {
+			sink.add_mapping(mapping);
+		}
+	}
+
+	void Converter::stop_at(std::streamoff offset) {
+		stop_offset = offset;
+	}
+
+	void Converter::resume(const checkpoint& cp, channel_state& state, FrameSink& sink) {
+		reader.seek(cp.container_offset, cp.container_skip);
+		if (metadata_frozen) {
+			// The prescanned mappings are complete already
+			return;
+		}
+		std::swap(channels, state);
+		for (const auto& mapping : channels.mappings) {
+			sink.add_mapping(mapping);
+		}
+	}
+
+	bool Converter::convert(const ObjectRef* objects, std::size_t count, FrameSink& sink) {
+		can_run run;
+		bool complete = true;
+		for (std::size_t i = 0; i < count; i++) {
+			const ObjectRef& object = objects[i];
+			try {
+				if (!add_can_record(run, object, options)) {
+					/* frames stay in object order */
+					flush_can_run(sink, run, options);
+					convert(object, sink);
+				}
+			}
+			catch (std::runtime_error& e) {
+				std::cerr << "Exception: " << e.what() << std::endl;
+				complete = false;
+			}
+			if (run.records.count == CAN_RECORD_BATCH) {
+				flush_can_run(sink, run, options);
+			}
+		}
+		flush_can_run(sink, run, options);
+		return complete;
+	}
+
+	void Converter::convert(const ObjectRef& object, FrameSink& sink) {
+		switch (object.type) {
+
+		case ObjectType::CAN_MESSAGE:
+		case ObjectType::CAN_MESSAGE2: {
+			CanMessageView view(object);
+			write(sink, &view, options);
+			break;
+		}
+
+		case ObjectType::CAN_FD_MESSAGE: {
+			CanFdMessageView view(object);
+			write(sink, &view, options);
+			break;
+		}
+
+		case ObjectType::CAN_FD_MESSAGE_64: {
+			CanFdMessage64View view(object);
+			write(sink, &view, options);
+			break;
+		}
+
+		case ObjectType::ETHERNET_FRAME_EX:
+		case ObjectType::ETHERNET_FRAME_FORWARDED: {
+			EthernetFrameExView view(object);
+			write(sink, &view, options);
+			break;
+		}
+
+		default: {
+			if (metadata_frozen && object.type == ObjectType::APP_TEXT) {
+				break;
+			}
+			/* less frequent objects go through Vector::BLF */
+			ObjectHeaderBase* ohb = reader.materialize(object);
+			if (ohb == nullptr) {
+				break;
+			}
+			convert(ohb, sink);
+
+			/* delete object */
+			delete ohb;
+			break;
+		}
+
+		}
+	}
+
+	void Converter::convert(ObjectHeaderBase* ohb, FrameSink& sink) {
+		/* Object */
+		std::uint8_t errors = 0;
+		switch (ohb->objectType) {
+
+		case ObjectType::CAN_MESSAGE:
+			write(sink, reinterpret_cast<CanMessage*>(ohb), options);
+			break;
+
+		case ObjectType::CAN_ERROR:
+			write(sink, reinterpret_cast<CanErrorFrame*>(ohb), options);
+			break;
+
+		case ObjectType::CAN_FD_MESSAGE:
+			write(sink, reinterpret_cast<CanFdMessage*>(ohb), options);
+			break;
+
+		case ObjectType::CAN_FD_MESSAGE_64:
+			write(sink, reinterpret_cast<CanFdMessage64*>(ohb), options);
+			break;
+
+		case ObjectType::CAN_FD_ERROR_64:
+			write(sink, reinterpret_cast<CanFdErrorFrame64*>(ohb), options);
+			break;
+
+		case ObjectType::ETHERNET_FRAME:
+			write(sink, reinterpret_cast<EthernetFrame*>(ohb), options);
+			break;
+
+		case ObjectType::CAN_ERROR_EXT:
+			write(sink, reinterpret_cast<CanErrorFrameExt*>(ohb), options);
+			break;
+
+		case ObjectType::CAN_MESSAGE2:
+			write(sink, reinterpret_cast<CanMessage2*>(ohb), options);
+			break;
+
+		case ObjectType::ETHERNET_FRAME_EX:
+			write(sink, reinterpret_cast<EthernetFrameEx*>(ohb), options);
+			break;
+
+		case ObjectType::ETHERNET_FRAME_FORWARDED:
+			write(sink, reinterpret_cast<EthernetFrameForwarded*>(ohb), options);
+			break;
+
+		case ObjectType::FLEXRAY_DATA:
+			write(sink, reinterpret_cast<FlexRayData*>(ohb), options);
+			break;
+
+		case ObjectType::FLEXRAY_SYNC:
+			write(sink, reinterpret_cast<FlexRaySync*>(ohb), options);
+			break;
+
+		case ObjectType::FLEXRAY_CYCLE:
+			write(sink, reinterpret_cast<FlexRayV6StartCycleEvent*>(ohb), options);
+			break;
+
+		case ObjectType::FLEXRAY_MESSAGE:
+			write(sink, reinterpret_cast<FlexRayV6Message*>(ohb), options);
+			break;
+
+		case ObjectType::FLEXRAY_STATUS:
+			// We do not have reliable BLF file or clear documentation for this type
+			break;
+
+		case ObjectType::FR_ERROR:
+			write(sink, reinterpret_cast<FlexRayVFrError*>(ohb), options);
+			break;
+
+		case ObjectType::FR_STATUS:
+			write(sink, reinterpret_cast<FlexRayVFrStatus*>(ohb), options);
+			break;
+
+		case ObjectType::FR_STARTCYCLE:
+			write(sink, reinterpret_cast<FlexRayVFrStartCycle*>(ohb), options);
+			break;
+
+		case ObjectType::FR_RCVMESSAGE:
+			write(sink, reinterpret_cast<FlexRayVFrReceiveMsg*>(ohb), options);
+			break;
+
+		case ObjectType::FR_RCVMESSAGE_EX:
+			write(sink, reinterpret_cast<FlexRayVFrReceiveMsgEx*>(ohb), options);
+			break;
+
+		case ObjectType::APP_TEXT:
+			if (!metadata_frozen) {
+				configure(reinterpret_cast<AppText*>(ohb), sink);
+			}
+			break;
+
+		case ObjectType::LIN_MESSAGE:
+			write_lin_message(sink, reinterpret_cast<LinMessage*>(ohb), options);
+			break;
+
+		case ObjectType::LIN_MESSAGE2:
+			write_lin_message(sink, reinterpret_cast<LinMessage2*>(ohb), options);
+			break;
+
+		case ObjectType::LIN_CRC_ERROR:
+			errors = LIN_ERROR_CHECKSUM;
+			write_lin_error(sink, reinterpret_cast<LinCrcError*>(ohb), errors, options);
+			break;
+
+		case ObjectType::LIN_CRC_ERROR2:
+			errors = LIN_ERROR_CHECKSUM;
+			write_lin_error(sink, reinterpret_cast<LinCrcError2*>(ohb), errors, options);
+			break;
+
+		case ObjectType::LIN_RCV_ERROR:
+			errors = LIN_ERROR_FRAMING;
+			write_lin_error(sink, reinterpret_cast<LinReceiveError*>(ohb), errors, options);
+			break;
+
+		case ObjectType::LIN_RCV_ERROR2:
+			errors = LIN_ERROR_FRAMING;
+			write_lin_error(sink, reinterpret_cast<LinReceiveError2*>(ohb), errors, options);
+			break;
+
+		case ObjectType::LIN_SLV_TIMEOUT:
+			errors = LIN_ERROR_NOSLAVE;
+			write_lin_error(sink, reinterpret_cast<LinSlaveTimeout*>(ohb), errors, options);
+			break;
+
+		case ObjectType::LIN_SND_ERROR:
+			errors = LIN_ERROR_FRAMING;
+			write_lin_error(sink, reinterpret_cast<LinSendError*>(ohb), errors, options);
+			break;
+
+		case ObjectType::LIN_SND_ERROR2:
+			errors = LIN_ERROR_FRAMING;
+			write_lin_error(sink, reinterpret_cast<LinSendError2*>(ohb), errors, options);
+			break;
+
+		case ObjectType::LIN_SYN_ERROR:
+			errors = LIN_ERROR_FRAMING;
+			write_lin_error(sink, reinterpret_cast<LinSyncError*>(ohb), errors, options);
+			break;
+
+		case ObjectType::LIN_SYN_ERROR2:
+			errors = LIN_ERROR_FRAMING;
+			write_lin_error(sink, reinterpret_cast<LinSyncError2*>(ohb), errors, options);
+			break;
+
+		default:
+#ifdef DEBUG
+			std::cerr << (std::uint32_t)(ohb->objectType) << " is not implemented." << std::endl;
+#endif
+			break;
+
+		}
+	}
+
+	void Converter::summarize(const ObjectRef& object, Summary& summary) {
+		summary.add_object();
+		switch (object.type) {
+
+		case ObjectType::CAN_MESSAGE:
+		case ObjectType::CAN_MESSAGE2: {
+			CanMessageView view(object);
+			summarize_message(summary, Bus::CAN, &view, view.id & (CAN_ID_EXTENDED | 0x1fffffff));
+			break;
+		}
+
+		case ObjectType::CAN_FD_MESSAGE: {
+			CanFdMessageView view(object);
+			summarize_message(summary, Bus::CAN, &view, view.id & (CAN_ID_EXTENDED | 0x1fffffff));
+			break;
+		}
+
+		case ObjectType::CAN_FD_MESSAGE_64: {
+			CanFdMessage64View view(object);
+			summarize_message(summary, Bus::CAN, &view, view.id & (CAN_ID_EXTENDED | 0x1fffffff));
+			break;
+		}
+
+		case ObjectType::ETHERNET_FRAME_EX:
+		case ObjectType::ETHERNET_FRAME_FORWARDED: {
+			/* Ethernet frames are counted per EtherType */
+			EthernetFrameExView view(object);
+			uint32_t type = view.frameData.size() >= 14 ? (view.frameData.data()[12] << 8) | view.frameData.data()[13] : 0;
+			summarize_message(summary, Bus::Ethernet, &view, 100000 * view.hardwareChannel + view.channel, type);
+			break;
+		}
+
+		case ObjectType::CAN_ERROR:
+		case ObjectType::CAN_ERROR_EXT:
+		case ObjectType::CAN_FD_ERROR_64:
+		case ObjectType::ETHERNET_FRAME:
+		case ObjectType::FLEXRAY_DATA:
+		case ObjectType::FLEXRAY_SYNC:
+		case ObjectType::FLEXRAY_MESSAGE:
+		case ObjectType::FR_ERROR:
+		case ObjectType::FR_RCVMESSAGE:
+		case ObjectType::FR_RCVMESSAGE_EX:
+		case ObjectType::LIN_MESSAGE:
+		case ObjectType::LIN_MESSAGE2:
+		case ObjectType::LIN_CRC_ERROR:
+		case ObjectType::LIN_CRC_ERROR2:
+		case ObjectType::LIN_RCV_ERROR:
+		case ObjectType::LIN_RCV_ERROR2:
+		case ObjectType::LIN_SLV_TIMEOUT:
+		case ObjectType::LIN_SND_ERROR:
+		case ObjectType::LIN_SND_ERROR2:
+		case ObjectType::LIN_SYN_ERROR:
+		case ObjectType::LIN_SYN_ERROR2: {
+			/* less frequent objects go through Vector::BLF, without building their frames */
+			ObjectHeaderBase* ohb = reader.materialize(object);
+			if (ohb == nullptr) {
+				break;
+			}
+			summarize(ohb, summary);
+			delete ohb;
+			break;
+		}
+
+		default:
+			/* status, cycle and text objects are only counted */
+			break;
+		}
+	}
+
+	void Converter::summarize(ObjectHeaderBase* ohb, Summary& summary) {
+		switch (ohb->objectType) {
+
+		case ObjectType::CAN_ERROR:
+			summarize_error(summary, Bus::CAN, reinterpret_cast<CanErrorFrame*>(ohb));
+			break;
+
+		case ObjectType::CAN_ERROR_EXT:
+			summarize_error(summary, Bus::CAN, reinterpret_cast<CanErrorFrameExt*>(ohb));
+			break;
+
+		case ObjectType::CAN_FD_ERROR_64:
+			summarize_error(summary, Bus::CAN, reinterpret_cast<CanFdErrorFrame64*>(ohb));
+			break;
+
+		case ObjectType::ETHERNET_FRAME: {
+			EthernetFrame* obj = reinterpret_cast<EthernetFrame*>(ohb);
+			summarize_message(summary, Bus::Ethernet, obj, obj->type);
+			break;
+		}
+
+		case ObjectType::FLEXRAY_DATA: {
+			FlexRayData* obj = reinterpret_cast<FlexRayData*>(ohb);
+			summarize_message(summary, Bus::FlexRay, obj, obj->messageId);
+			break;
+		}
+
+		case ObjectType::FLEXRAY_SYNC: {
+			FlexRaySync* obj = reinterpret_cast<FlexRaySync*>(ohb);
+			summarize_message(summary, Bus::FlexRay, obj, obj->messageId);
+			break;
+		}
+
+		case ObjectType::FLEXRAY_MESSAGE: {
+			FlexRayV6Message* obj = reinterpret_cast<FlexRayV6Message*>(ohb);
+			summarize_message(summary, Bus::FlexRay, obj, obj->frameId);
+			break;
+		}
+
+		case ObjectType::FR_ERROR:
+			summarize_error(summary, Bus::FlexRay, reinterpret_cast<FlexRayVFrError*>(ohb));
+			break;
+
+		case ObjectType::FR_RCVMESSAGE: {
+			FlexRayVFrReceiveMsg* obj = reinterpret_cast<FlexRayVFrReceiveMsg*>(ohb);
+			summarize_message(summary, Bus::FlexRay, obj, obj->frameId);
+			break;
+		}
+
+		case ObjectType::FR_RCVMESSAGE_EX: {
+			FlexRayVFrReceiveMsgEx* obj = reinterpret_cast<FlexRayVFrReceiveMsgEx*>(ohb);
+			summarize_message(summary, Bus::FlexRay, obj, obj->frameId);
+			break;
+		}
+
+		case ObjectType::LIN_MESSAGE: {
+			LinMessage* obj = reinterpret_cast<LinMessage*>(ohb);
+			summarize_message(summary, Bus::LIN, obj, obj->id);
+			break;
+		}
+
+		case ObjectType::LIN_MESSAGE2: {
+			LinMessage2* obj = reinterpret_cast<LinMessage2*>(ohb);
+			summarize_message(summary, Bus::LIN, obj, obj->id);
+			break;
+		}
+
+		case ObjectType::LIN_CRC_ERROR:
+			summarize_error(summary, Bus::LIN, reinterpret_cast<LinCrcError*>(ohb));
+			break;
+
+		case ObjectType::LIN_CRC_ERROR2:
+			summarize_error(summary, Bus::LIN, reinterpret_cast<LinCrcError2*>(ohb));
+			break;
+
+		case ObjectType::LIN_RCV_ERROR:
+			summarize_error(summary, Bus::LIN, reinterpret_cast<LinReceiveError*>(ohb));
+			break;
+
+		case ObjectType::LIN_RCV_ERROR2:
+			summarize_error(summary, Bus::LIN, reinterpret_cast<LinReceiveError2*>(ohb));
+			break;
+
+		case ObjectType::LIN_SLV_TIMEOUT:
+			summarize_error(summary, Bus::LIN, reinterpret_cast<LinSlaveTimeout*>(ohb));
+			break;
+
+		case ObjectType::LIN_SND_ERROR:
+			summarize_error(summary, Bus::LIN, reinterpret_cast<LinSendError*>(ohb));
+			break;
+
+		case ObjectType::LIN_SND_ERROR2:
+			summarize_error(summary, Bus::LIN, reinterpret_cast<LinSendError2*>(ohb));
+			break;
+
+		case ObjectType::LIN_SYN_ERROR:
+			summarize_error(summary, Bus::LIN, reinterpret_cast<LinSyncError*>(ohb));
+			break;
+
+		case ObjectType::LIN_SYN_ERROR2:
+			summarize_error(summary, Bus::LIN, reinterpret_cast<LinSyncError2*>(ohb));
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	void Converter::configure(AppText* obj, FrameSink& sink) {
+		size_t known = channels.mappings.size();
+		configure_channels(&channels, obj);
+		for (size_t i = known; i < channels.mappings.size(); i++) {
+			sink.add_mapping(channels.mappings[i]);
+		}
+	}
+
+}
@@ -0,0 +1,173 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+#ifndef _APP_CONVERTER_H
+#define _APP_CONVERTER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+
+#include <Vector/BLF.h>
+
+#include "blf_reader.hpp"
+#include "channels.hpp"
+#include "checkpoint.hpp"
+#include "decimation.hpp"
+#include "sink.hpp"
+#include "summary.hpp"
+
+namespace blf_converter {
+
+	class EncodingPool;
+
+	/// Time of the file header in ns since the epoch, e.g. the measurement start
+	std::uint64_t systemtime_ns(const Vector::BLF::SYSTEMTIME& time);
+
+	/// Settings used by the encoders of all object types
+	struct encode_options {
+		/// Added to object timestamps, the measurement start in ns since the epoch
+		std::uint64_t date_offset_ns = 0;
+		/// Bytes kept of each frame, 0 to keep all
+		std::uint32_t snaplen = 0;
+		/// Snap length per LINKTYPE_*, overrides snaplen
+		std::map<std::uint16_t, std::uint32_t> link_snaplen;
+
+		std::uint32_t captured_length(std::uint16_t link_type, std::uint32_t length) const {
+			std::uint32_t limit = snaplen;
+			if (!link_snaplen.empty()) {
+				auto it = link_snaplen.find(link_type);
+				if (it != link_snaplen.end()) {
+					limit = it->second;
+				}
+			}
+			return limit != 0 && length > limit ? limit : length;
+		}
+	};
+
+	/// Timestamps of the objects starting in one container, see Converter::index()
+	struct container_index_entry {
+		/// Position of the first object, see BlfReader::tell()
+		std::streamoff offset;
+		std::uint64_t skip;
+		/// Latest absolute timestamp in ns of the objects of this container
+		std::uint64_t max_ns;
+		/// Earliest absolute timestamp in ns of the objects of this container and all later ones
+		std::uint64_t min_ns;
+	};
+
+	/// Converts the objects of a BLF file into frames, handed to a FrameSink
+	class Converter {
+	public:
+		bool open(const std::string& path);
+		/// Converts all remaining objects of the opened file, false on read errors or a truncated last container
+		bool run(FrameSink& sink);
+		/// Like run(), but keeps waiting for appended data until the writer completed the file or stop is set
+		void follow(FrameSink& sink, const std::atomic<bool>& stop, std::chrono::milliseconds interval = std::chrono::milliseconds(100));
+		void close();
+		/// File header of the opened file
+		const Vector::BLF::FileStatistics& statistics() const;
+		/// Objects read so far, over all opened files
+		std::uint64_t objects_read() const;
+
+		/// Skips corrupt containers and objects instead of stopping, see BlfReader::recover
+		void recover(bool enabled);
+		const std::vector<skipped_range>& skipped() const;
+
+		/// Drops messages before they are encoded: keeps every nth per channel and id,
+		/// and at most max_rate_hz per second if not 0. Error frames always pass.
+		void decimate(std::uint32_t every, double max_rate_hz);
+
+		/// Truncates frames to length bytes, for one LINKTYPE_* or all link types if link_type is not set
+		void snaplen(std::uint32_t length, std::optional<std::uint16_t> link_type = std::nullopt);
+
+		/// Calls callback with the absolute time in ns of every object of one of types, after the
+		/// frames of the objects before it reached the sink and before the object is converted.
+		/// Called on the writer thread of the encoding pool with more than 1 thread.
+		void on_trigger(std::set<Vector::BLF::ObjectType> types, std::function<void(std::uint64_t)> callback);
+
+		/// Encodes frames on threads worker threads if more than 1, the output order stays the same
+		void threads(unsigned threads);
+
+		/// Accounts the read buffers in budget, nullptr for no limit
+		void memory_budget(MemoryBudget* budget);
+		/// Backs the inflated containers with huge pages, see BlfReader::huge_pages
+		void huge_pages(bool enabled);
+
+		/// Calls callback between two objects, at most once per interval
+		void on_progress(std::chrono::milliseconds interval, std::function<void()> callback);
+
+		/// Fills the input position of a checkpoint
+		void position(checkpoint& cp) const;
+		const channel_state& channel_mappings() const;
+		/// Reads all AppText metadata of the file up front and forwards the complete mappings to the sink.
+		/// Later AppText objects are ignored, so mappings never change during the conversion.
+		bool prescan(FrameSink& sink);
+
+		/// Reads all remaining objects and records their timestamps per container, nothing is converted
+		bool index(std::vector<container_index_entry>& entries);
+		/// Continues at an index entry, the mappings read so far are forwarded to the sink.
+		/// The mappings are complete if the file was prescanned.
+		void seek(const container_index_entry& entry, FrameSink& sink);
+		/// run() returns once the next object starts in the container at offset or later, -1 for no limit
+		void stop_at(std::streamoff offset);
+
+		/// Continues at a checkpoint, the restored mappings are forwarded to the sink
+		void resume(const checkpoint& cp, channel_state& state, FrameSink& sink);
+
+		/// Converts a single object, objects without a frame representation are ignored.
+		/// Can be called from several threads at once, except for AppText objects.
+		void convert(Vector::BLF::ObjectHeaderBase* ohb, FrameSink& sink);
+		/// Same as above, frequent object types are read in place without a Vector::BLF object
+		void convert(const ObjectRef& object, FrameSink& sink);
+		/// Converts consecutive objects, CAN messages are encoded several at once.
+		/// Objects that fail are reported and skipped, false if there were any.
+		bool convert(const ObjectRef* objects, std::size_t count, FrameSink& sink);
+
+		/// Makes run() also count every object read in summary, nullptr to stop
+		void collect_summary(Summary* summary);
+		/// Counts all remaining objects of the opened file, no frames are built
+		bool summarize(Summary& summary);
+		void summarize(const ObjectRef& object, Summary& summary);
+		void summarize(Vector::BLF::ObjectHeaderBase* ohb, Summary& summary);
+
+	private:
+		template<class Handler>
+		bool read_objects(Handler handler);
+		std::unique_ptr<EncodingPool> encoding_pool(FrameSink& sink);
+		bool run_parallel(EncodingPool& pool);
+		bool keep(const ObjectRef& object);
+		template<class View>
+		bool keep(Bus bus, View* view, std::uint32_t channel, std::uint32_t id);
+		void configure(Vector::BLF::AppText* obj, FrameSink& sink);
+		/// True if object is a trigger, with its absolute time in ns
+		bool trigger_time(const ObjectRef& object, std::uint64_t& ns);
+
+		BlfReader reader;
+		encode_options options;
+		channel_state channels;
+		bool metadata_frozen = false;
+		unsigned worker_threads = 1;
+		std::streamoff stop_offset = -1;
+		/// Set during follow(), a truncated last container is then waited for instead of reported
+		bool following = false;
+		std::uint64_t read_count = 0;
+		Summary* run_summary = nullptr;
+		std::set<Vector::BLF::ObjectType> trigger_types;
+		std::function<void(std::uint64_t)> trigger_callback;
+		Decimator decimator;
+
+		std::chrono::milliseconds progress_interval { 0 };
+		std::function<void()> progress_callback;
+	};
+
+}
+
+#endif
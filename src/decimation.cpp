@@ -0,0 +1,38 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+
+#include "decimation.hpp"
+
+#define NANOS_PER_SEC 1000000000
+
+namespace blf_converter {
+
+	void Decimator::every(std::uint32_t every) {
+		n = every > 0 ? every : 1;
+	}
+
+	void Decimator::max_rate(double hz) {
+		min_interval_ns = hz > 0 ? (std::uint64_t)(NANOS_PER_SEC / hz) : 0;
+	}
+
+	bool Decimator::enabled() const {
+		return n > 1 || min_interval_ns > 0;
+	}
+
+	bool Decimator::keep(Bus bus, std::uint32_t channel, std::uint32_t id, std::uint64_t timestamp_ns) {
+		std::uint64_t key = ((std::uint64_t)channel << 34) | ((std::uint64_t)bus << 32) | id;
+		id_state& state = ids[key];
+		bool first = state.count == 0;
+		if (state.count++ % n != 0) {
+			return false;
+		}
+		if (!first && timestamp_ns >= state.last_ns && timestamp_ns - state.last_ns < min_interval_ns) {
+			return false;
+		}
+		state.last_ns = timestamp_ns;
+		return true;
+	}
+
+}
@@ -0,0 +1,42 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+#ifndef _APP_DECIMATION_H
+#define _APP_DECIMATION_H
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "summary.hpp"
+
+namespace blf_converter {
+
+	/// Thins out cyclic messages per bus, channel and id
+	class Decimator {
+	public:
+		/// Keeps every nth message, 1 keeps all
+		void every(std::uint32_t n);
+		/// Keeps at most hz messages per second, 0 for no limit
+		void max_rate(double hz);
+		bool enabled() const;
+
+		/// False if the message is to be dropped. A timestamp before the last kept one of the id
+		/// (e.g. the next segment of a logger) is kept and restarts its rate limit.
+		bool keep(Bus bus, std::uint32_t channel, std::uint32_t id, std::uint64_t timestamp_ns);
+
+	private:
+		struct id_state {
+			std::uint64_t count = 0;
+			std::uint64_t last_ns = 0;
+		};
+
+		std::uint32_t n = 1;
+		std::uint64_t min_interval_ns = 0;
+		/// Key is channel << 34 | bus << 32 | id, with the extended id bit of CAN ids
+		std::unordered_map<std::uint64_t, id_state> ids;
+	};
+
+}
+
+#endif
@@ -0,0 +1,65 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+
+#include <string_view>
+
+#include "dedup_sink.hpp"
+
+#define NANOS_PER_SEC 1000000000
+
+namespace blf_converter {
+
+	void DedupSink::next_segment() {
+		segment++;
+	}
+
+	std::uint64_t DedupSink::dropped() const {
+		return dropped_frames;
+	}
+
+	void DedupSink::write_frame(const Frame& frame) {
+		frame_key key;
+		key.ns = (std::uint64_t)frame.timestamp.tv_sec * NANOS_PER_SEC + frame.timestamp.tv_nsec;
+		key.channel_id = frame.channel_id;
+		key.link_type = frame.link_type;
+		key.length = frame.length;
+		key.payload.assign((const char*)frame.data, frame.length);
+		key.payload_hash = std::hash<std::string_view>()(key.payload);
+
+		/* timestamps of one segment mostly increase, the oldest frames are at the front */
+		while (!order.empty() && order.front()->ns + window_ns < key.ns) {
+			/* the key belongs to the erased entry, so it is looked up first */
+			seen.erase(seen.find(*order.front()));
+			order.pop_front();
+		}
+
+		auto inserted = seen.emplace(std::move(key), segment);
+		if (!inserted.second) {
+			if (inserted.first->second != segment) {
+				dropped_frames++;
+				sink->discard_frame(frame, Discard::Dropped, 1);
+				return;
+			}
+			// Identical frames within one segment are kept
+		}
+		else {
+			order.push_back(&inserted.first->first);
+		}
+		sink->write_frame(frame);
+	}
+
+	void DedupSink::discard_frame(const Frame& frame, Discard reason, std::uint64_t count) {
+		sink->discard_frame(frame, reason, count);
+	}
+
+	void DedupSink::add_mapping(const pcapng_exporter::channel_mapping& mapping) {
+		sink->add_mapping(mapping);
+	}
+
+	void DedupSink::flush() {
+		sink->flush();
+	}
+
+}
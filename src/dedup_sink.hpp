@@ -0,0 +1,74 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+#ifndef _APP_DEDUP_SINK_H
+#define _APP_DEDUP_SINK_H
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "sink.hpp"
+
+namespace blf_converter {
+
+	/// Drops frames of a segment that were already written by a previous segment,
+	/// as produced by loggers whose consecutive files overlap.
+	/// Only frames up to window before the latest one are remembered.
+	class DedupSink : public FrameSink {
+	public:
+		DedupSink(std::unique_ptr<FrameSink> sink, std::uint64_t window_ns)
+			: sink(std::move(sink)), window_ns(window_ns) {}
+
+		/// Frames written from now on belong to the next segment
+		void next_segment();
+		/// Frames dropped so far
+		std::uint64_t dropped() const;
+
+		void write_frame(const Frame& frame) override;
+		void discard_frame(const Frame& frame, Discard reason, std::uint64_t count) override;
+		void add_mapping(const pcapng_exporter::channel_mapping& mapping) override;
+		void flush() override;
+
+	private:
+		struct frame_key {
+			std::uint64_t ns;
+			std::uint32_t channel_id;
+			std::uint16_t link_type;
+			std::uint32_t length;
+			std::size_t payload_hash;
+			/// Compared before a frame is dropped, equal hashes do not mean equal frames
+			std::string payload;
+
+			bool operator==(const frame_key& other) const {
+				return ns == other.ns && channel_id == other.channel_id && link_type == other.link_type
+					&& length == other.length && payload_hash == other.payload_hash && payload == other.payload;
+			}
+		};
+
+		struct frame_key_hash {
+			std::size_t operator()(const frame_key& key) const {
+				std::size_t hash = key.payload_hash;
+				hash ^= std::hash<std::uint64_t>()(key.ns) + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+				hash ^= std::hash<std::uint64_t>()(((std::uint64_t)key.channel_id << 16) | key.link_type) + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+				return hash;
+			}
+		};
+
+		std::unique_ptr<FrameSink> sink;
+		std::uint64_t window_ns;
+		std::uint32_t segment = 0;
+		std::uint64_t dropped_frames = 0;
+		/// Segment that last wrote each remembered frame
+		std::unordered_map<frame_key, std::uint32_t, frame_key_hash> seen;
+		/// Remembered frames in the order written, to forget them once out of the window.
+		/// Points to the keys in seen, which stay in place when it grows.
+		std::deque<const frame_key*> order;
+	};
+
+}
+
+#endif
@@ -0,0 +1,200 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+#include "encoding_pool.hpp"
+#include "placement.hpp"
+
+/// Objects are handed to the workers in batches of this size
+#define BATCH_BYTES   (256 << 10)
+#define BATCH_OBJECTS 1024
+
+namespace blf_converter {
+
+	EncodingPool::EncodingPool(unsigned threads, encoder encode, FrameSink& sink, MemoryBudget* budget)
+		: encode(std::move(encode)), sink(sink), budget(budget), max_pending(2 * (std::size_t)threads + 2) {
+		current = std::make_unique<batch>();
+		current->bytes.reserve(BATCH_BYTES);
+		for (unsigned i = 0; i < threads; i++) {
+			workers.emplace_back(&EncodingPool::work, this);
+		}
+		writer = std::thread(&EncodingPool::write, this);
+	}
+
+	EncodingPool::~EncodingPool() {
+		wait();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		changed.notify_all();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+		writer.join();
+	}
+
+	void EncodingPool::add(const ObjectRef& object) {
+		if (current->bytes.size() + object.size > BATCH_BYTES || current->objects.size() == BATCH_OBJECTS) {
+			submit();
+		}
+		// The object memory is only valid until the next object is read.
+		// bytes does not grow beyond its reserved size, except for a single large object.
+		std::size_t offset = current->bytes.size();
+		current->bytes.insert(current->bytes.end(), object.data, object.data + object.size);
+		ObjectRef copy = object;
+		copy.data = current->bytes.data() + offset;
+		current->objects.push_back(copy);
+	}
+
+	void EncodingPool::write_frame(const Frame& frame) {
+		// Must follow the frames of the objects added so far
+		if (!current->objects.empty()) {
+			submit();
+		}
+		current->output.write_frame(frame);
+	}
+
+	void EncodingPool::discard_frame(const Frame& frame, Discard reason, std::uint64_t count) {
+		if (!current->objects.empty()) {
+			submit();
+		}
+		current->output.discard_frame(frame, reason, count);
+	}
+
+	void EncodingPool::add_mapping(const pcapng_exporter::channel_mapping& mapping) {
+		if (!current->objects.empty()) {
+			submit();
+		}
+		current->output.add_mapping(mapping);
+	}
+
+	void EncodingPool::call(std::function<void()> callback) {
+		current->then = std::move(callback);
+		submit();
+	}
+
+	void EncodingPool::wait() {
+		if (!current->objects.empty() || !current->output.empty()) {
+			submit();
+		}
+		std::unique_lock<std::mutex> lock(mutex);
+		changed.wait(lock, [&]() { return written == submitted; });
+	}
+
+	void EncodingPool::flush() {
+		wait();
+		sink.flush();
+	}
+
+	bool EncodingPool::failed() const {
+		return errors;
+	}
+
+	void EncodingPool::submit() {
+		std::unique_ptr<batch> next = std::make_unique<batch>();
+		next->bytes.reserve(BATCH_BYTES);
+		std::size_t charge = current->bytes.capacity() + current->objects.capacity() * sizeof(ObjectRef) + current->output.memory();
+
+		std::unique_lock<std::mutex> lock(mutex);
+		// Backpressure: wait for the writer while too many batches are pending or the budget is used up
+		changed.wait(lock, [&]() {
+			if (submitted - written >= max_pending) {
+				return false;
+			}
+			if (budget == nullptr) {
+				return true;
+			}
+			if (submitted == written) {
+				// Nothing pending that could free memory, proceed even if the budget is exceeded
+				budget->update(0, charge);
+				return true;
+			}
+			return budget->try_acquire(charge);
+		});
+		current->charged = budget != nullptr ? charge : 0;
+		current->sequence = submitted++;
+		todo.push_back(std::move(current));
+		current = std::move(next);
+		lock.unlock();
+		changed.notify_all();
+	}
+
+	void EncodingPool::work() {
+		pin_thread(Stage::Encoder);
+		while (true) {
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [&]() { return !todo.empty() || stopping; });
+			if (todo.empty()) {
+				return;
+			}
+			std::unique_ptr<batch> next = std::move(todo.front());
+			todo.pop_front();
+			lock.unlock();
+
+			try {
+				if (!encode(next->objects.data(), next->objects.size(), next->output)) {
+					errors = true;
+				}
+			}
+			catch (std::exception& e) {
+				// Also std::bad_alloc and others, an escaping exception would terminate the process
+				std::cerr << "Exception: " << e.what() << std::endl;
+				errors = true;
+			}
+			// The copied objects are no longer needed, the encoded frames are charged until they are written
+			std::vector<std::uint8_t>().swap(next->bytes);
+			std::vector<ObjectRef>().swap(next->objects);
+			if (budget != nullptr) {
+				std::size_t charge = next->output.memory();
+				budget->update(next->charged, charge);
+				next->charged = charge;
+			}
+
+			lock.lock();
+			done.emplace(next->sequence, std::move(next));
+			lock.unlock();
+			changed.notify_all();
+		}
+	}
+
+	void EncodingPool::write() {
+		pin_thread(Stage::Writer);
+		while (true) {
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [&]() { return done.count(written) != 0 || (stopping && todo.empty() && done.empty()); });
+			auto it = done.find(written);
+			if (it == done.end()) {
+				return;
+			}
+			std::unique_ptr<batch> next = std::move(it->second);
+			done.erase(it);
+			lock.unlock();
+
+			try {
+				next->output.replay(sink);
+				if (next->then) {
+					next->then();
+				}
+			}
+			catch (std::exception& e) {
+				std::cerr << "Exception: " << e.what() << std::endl;
+			}
+			if (budget != nullptr) {
+				budget->release(next->charged);
+			}
+			next.reset();
+
+			lock.lock();
+			written++;
+			lock.unlock();
+			changed.notify_all();
+		}
+	}
+
+}
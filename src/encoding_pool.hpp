@@ -0,0 +1,88 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+#ifndef _APP_ENCODING_POOL_H
+#define _APP_ENCODING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "blf_reader.hpp"
+#include "frame_buffer.hpp"
+#include "memory_budget.hpp"
+#include "sink.hpp"
+
+namespace blf_converter {
+
+	/// Encodes batches of objects on worker threads. A single writer thread hands the
+	/// resulting frames to the sink in the order the objects were added.
+	/// Frames and mappings written to the pool directly are ordered after all objects added before.
+	class EncodingPool : public FrameSink {
+	public:
+		/// Converts a batch of objects, false if some of them failed
+		using encoder = std::function<bool(const ObjectRef* objects, std::size_t count, FrameSink& output)>;
+
+		EncodingPool(unsigned threads, encoder encode, FrameSink& sink, MemoryBudget* budget = nullptr);
+		~EncodingPool();
+
+		/// Copies the object, waits while too many batches are pending
+		void add(const ObjectRef& object);
+		void write_frame(const Frame& frame) override;
+		void discard_frame(const Frame& frame, Discard reason, std::uint64_t count) override;
+		void add_mapping(const pcapng_exporter::channel_mapping& mapping) override;
+		/// Calls callback on the writer thread, after the frames of the objects added before
+		void call(std::function<void()> callback);
+		/// Waits until everything added so far has been written to the sink
+		void wait();
+		/// Flushes the sink after wait()
+		void flush() override;
+
+		/// True if an object could not be encoded
+		bool failed() const;
+
+	private:
+		struct batch {
+			std::uint64_t sequence;
+			std::vector<std::uint8_t> bytes;
+			std::vector<ObjectRef> objects;
+			FrameBuffer output;
+			std::size_t charged = 0;
+			/// Called by the writer after the frames of the batch
+			std::function<void()> then;
+		};
+
+		void submit();
+		void work();
+		void write();
+
+		encoder encode;
+		FrameSink& sink;
+		MemoryBudget* budget;
+		std::size_t max_pending;
+
+		std::unique_ptr<batch> current;
+		std::uint64_t submitted = 0;
+		std::uint64_t written = 0;
+		std::atomic<bool> errors { false };
+
+		std::mutex mutex;
+		std::condition_variable changed;
+		std::deque<std::unique_ptr<batch>> todo;
+		std::map<std::uint64_t, std::unique_ptr<batch>> done;
+		bool stopping = false;
+		std::vector<std::thread> workers;
+		std::thread writer;
+	};
+
+}
+
+#endif
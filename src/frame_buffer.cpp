@@ -0,0 +1,104 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+
+#include "frame_buffer.hpp"
+
+/// Frame bytes assumed by reserve, between CAN and Ethernet frames
+#define TYPICAL_FRAME_LENGTH 64
+
+namespace blf_converter {
+
+	void FrameBuffer::write_frame(const Frame& frame) {
+		pending_frame entry;
+		entry.frame = frame;
+		entry.offset = bytes.size();
+		if (frame.lin != nullptr) {
+			entry.lin = *frame.lin;
+		}
+		bytes.insert(bytes.end(), frame.data, frame.data + frame.length);
+		frames.push_back(entry);
+	}
+
+	void FrameBuffer::discard_frame(const Frame& frame, Discard reason, std::uint64_t count) {
+		std::uint64_t key = (std::uint64_t)frame.channel_id << 17 | (std::uint64_t)frame.link_type << 1 | (reason == Discard::Dropped ? 1 : 0);
+		auto it = counting.find(key);
+		if (it != counting.end()) {
+			discards[it->second].count += count;
+			return;
+		}
+		pending_discards entry;
+		entry.mappings = mappings.size();
+		entry.frame = frame;
+		entry.frame.data = nullptr;
+		entry.frame.lin = nullptr;
+		entry.reason = reason;
+		entry.count = count;
+		counting.emplace(key, discards.size());
+		discards.push_back(entry);
+	}
+
+	void FrameBuffer::add_mapping(const pcapng_exporter::channel_mapping& mapping) {
+		mappings.emplace_back(frames.size(), mapping);
+		counting.clear();
+	}
+
+	void FrameBuffer::replay(FrameSink& sink) {
+		auto mapping = mappings.begin();
+		auto discard = discards.begin();
+		// The discards counted before a mapping are passed on before it, after the frames written before it
+		auto replay_discards = [&]() {
+			std::size_t before = mapping - mappings.begin();
+			for (; discard != discards.end() && discard->mappings == before; ++discard) {
+				sink.discard_frame(discard->frame, discard->reason, discard->count);
+			}
+		};
+		for (std::size_t i = 0; i < frames.size(); i++) {
+			for (; mapping != mappings.end() && mapping->first == i; ++mapping) {
+				replay_discards();
+				sink.add_mapping(mapping->second);
+			}
+			// Pointers are set here, the vectors may have moved since the frame was added
+			Frame frame = frames[i].frame;
+			frame.data = bytes.data() + frames[i].offset;
+			if (frame.lin != nullptr) {
+				frame.lin = &frames[i].lin;
+			}
+			sink.write_frame(frame);
+		}
+		for (; mapping != mappings.end(); ++mapping) {
+			replay_discards();
+			sink.add_mapping(mapping->second);
+		}
+		replay_discards();
+	}
+
+	void FrameBuffer::clear() {
+		frames.clear();
+		bytes.clear();
+		mappings.clear();
+		discards.clear();
+		counting.clear();
+	}
+
+	bool FrameBuffer::empty() const {
+		return frames.empty() && mappings.empty() && discards.empty();
+	}
+
+	std::size_t FrameBuffer::memory() const {
+		return frames.capacity() * sizeof(pending_frame) + bytes.capacity()
+			+ discards.capacity() * sizeof(pending_discards) + mappings.capacity() * sizeof(mappings[0]);
+	}
+
+	void FrameBuffer::reserve(std::size_t size) {
+		std::size_t count = size / (sizeof(pending_frame) + TYPICAL_FRAME_LENGTH);
+		frames.reserve(count);
+		bytes.reserve(size - count * sizeof(pending_frame));
+	}
+
+	bool FrameBuffer::fits(const Frame& frame) const {
+		return frames.size() < frames.capacity() && bytes.size() + frame.length <= bytes.capacity();
+	}
+
+}
@@ -0,0 +1,63 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+#ifndef _APP_FRAME_BUFFER_H
+#define _APP_FRAME_BUFFER_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "sink.hpp"
+
+namespace blf_converter {
+
+	/// Sink that keeps copies of frames and mappings, to be written to another sink later in the same order
+	class FrameBuffer : public FrameSink {
+	public:
+		void write_frame(const Frame& frame) override;
+		/// Adds count to the discards of the channel, link type and reason since the last mapping.
+		/// Only the header of the first frame is kept, the timestamps of the others are lost.
+		void discard_frame(const Frame& frame, Discard reason, std::uint64_t count) override;
+		void add_mapping(const pcapng_exporter::channel_mapping& mapping) override;
+
+		/// Writes everything to sink, the buffer stays unchanged
+		void replay(FrameSink& sink);
+		void clear();
+		bool empty() const;
+		/// Heap bytes held, the frame entries included
+		std::size_t memory() const;
+		/// Reserves memory() for size bytes, shared by frame data and entries
+		void reserve(std::size_t size);
+		/// True if frame fits into the reserved memory
+		bool fits(const Frame& frame) const;
+
+	private:
+		struct pending_frame {
+			Frame frame;
+			std::size_t offset;
+			lin_frame lin;
+		};
+
+		struct pending_discards {
+			/// Number of mappings added before
+			std::size_t mappings;
+			Frame frame;
+			Discard reason;
+			std::uint64_t count;
+		};
+
+		std::vector<pending_frame> frames;
+		std::vector<std::uint8_t> bytes;
+		/// Mappings with the number of frames written before them
+		std::vector<std::pair<std::size_t, pcapng_exporter::channel_mapping>> mappings;
+		std::vector<pending_discards> discards;
+		/// Index in discards by channel_id << 17 | link_type << 1 | reason, cleared when a mapping is added
+		std::unordered_map<std::uint64_t, std::size_t> counting;
+	};
+
+}
+
+#endif
@@ -0,0 +1,58 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+
+#include <pcapng_exporter/linktype.h>
+
+#include "frame_filter.hpp"
+
+#define NANOS_PER_SEC 1000000000
+
+namespace blf_converter {
+
+	bool frame_filter::matches(const Frame& frame) const {
+		std::uint64_t ns = (std::uint64_t)frame.timestamp.tv_sec * NANOS_PER_SEC + frame.timestamp.tv_nsec;
+		if (ns < start_ns || ns > end_ns) {
+			return false;
+		}
+		if (!link_types.empty() && link_types.count(frame.link_type) == 0) {
+			return false;
+		}
+		return channels.empty() || channels.count(frame.channel_id) != 0;
+	}
+
+	bool parse_link_type(const std::string& name, std::uint16_t& link_type) {
+		if (name == "can") link_type = LINKTYPE_CAN;
+		else if (name == "lin") link_type = LINKTYPE_LIN;
+		else if (name == "flexray") link_type = LINKTYPE_FLEXRAY;
+		else if (name == "ethernet") link_type = LINKTYPE_ETHERNET;
+		else return false;
+		return true;
+	}
+
+	void FilterSink::write_frame(const Frame& frame) {
+		if (filter.matches(frame)) {
+			sink.write_frame(frame);
+		}
+		else {
+			sink.discard_frame(frame, Discard::Filtered, 1);
+		}
+	}
+
+	void FilterSink::discard_frame(const Frame& frame, Discard reason, std::uint64_t count) {
+		// Frames of other link types and channels are not counted for this output
+		if (filter.matches(frame)) {
+			sink.discard_frame(frame, reason, count);
+		}
+	}
+
+	void FilterSink::add_mapping(const pcapng_exporter::channel_mapping& mapping) {
+		sink.add_mapping(mapping);
+	}
+
+	void FilterSink::flush() {
+		sink.flush();
+	}
+
+}
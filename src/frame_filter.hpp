@@ -0,0 +1,57 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+#ifndef _APP_FRAME_FILTER_H
+#define _APP_FRAME_FILTER_H
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "sink.hpp"
+
+namespace blf_converter {
+
+	/// Selects frames by time, link type and interface
+	struct frame_filter {
+		/// Absolute time window in ns since the epoch, both ends included
+		std::uint64_t start_ns = 0;
+		std::uint64_t end_ns = std::numeric_limits<std::uint64_t>::max();
+		/// LINKTYPE_* values, empty for all
+		std::set<std::uint16_t> link_types;
+		/// Frame::channel_id values, empty for all
+		std::set<std::uint32_t> channels;
+
+		bool matches(const Frame& frame) const;
+	};
+
+	/// LINKTYPE_* for one of can, lin, flexray, ethernet
+	bool parse_link_type(const std::string& name, std::uint16_t& link_type);
+
+	/// Forwards the frames matching a filter, and all mappings. Other frames are discarded as filtered.
+	class FilterSink : public FrameSink {
+	public:
+		FilterSink(frame_filter filter, FrameSink& sink)
+			: filter(std::move(filter)), sink(sink) {}
+		/// Same as above, the sink is owned
+		FilterSink(frame_filter filter, std::unique_ptr<FrameSink> owned)
+			: filter(std::move(filter)), sink(*owned), owned(std::move(owned)) {}
+
+		void write_frame(const Frame& frame) override;
+		void discard_frame(const Frame& frame, Discard reason, std::uint64_t count) override;
+		void add_mapping(const pcapng_exporter::channel_mapping& mapping) override;
+		void flush() override;
+
+	private:
+		frame_filter filter;
+		FrameSink& sink;
+		std::unique_ptr<FrameSink> owned;
+	};
+
+}
+
+#endif
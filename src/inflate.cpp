@@ -0,0 +1,137 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+
+#include <zlib.h>
+#ifdef BLF_HAVE_ZLIB_NG
+#include <zlib-ng.h>
+#endif
+#ifdef BLF_HAVE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+
+#include "inflate.hpp"
+
+#ifndef BLF_DEFAULT_INFLATE
+#define BLF_DEFAULT_INFLATE "zlib"
+#endif
+
+namespace blf_converter {
+
+	enum class inflate_kind : int {
+		zlib,
+		zlib_ng,
+		libdeflate
+	};
+
+	bool find_backend(const std::string& name, inflate_kind& kind) {
+		if (name == "zlib") {
+			kind = inflate_kind::zlib;
+			return true;
+		}
+#ifdef BLF_HAVE_ZLIB_NG
+		if (name == "zlib-ng") {
+			kind = inflate_kind::zlib_ng;
+			return true;
+		}
+#endif
+#ifdef BLF_HAVE_LIBDEFLATE
+		if (name == "libdeflate") {
+			kind = inflate_kind::libdeflate;
+			return true;
+		}
+#endif
+		return false;
+	}
+
+	inflate_kind initial_backend() {
+		inflate_kind kind = inflate_kind::zlib;
+		const char* name = std::getenv("BLF_INFLATE");
+		if (name == nullptr || !find_backend(name, kind)) {
+			find_backend(BLF_DEFAULT_INFLATE, kind);
+		}
+		return kind;
+	}
+
+	std::atomic<inflate_kind> current_backend(initial_backend());
+
+	std::vector<std::string> inflate_backends() {
+		std::vector<std::string> names = { "zlib" };
+#ifdef BLF_HAVE_ZLIB_NG
+		names.push_back("zlib-ng");
+#endif
+#ifdef BLF_HAVE_LIBDEFLATE
+		names.push_back("libdeflate");
+#endif
+		return names;
+	}
+
+	std::string inflate_backend() {
+		switch (current_backend.load()) {
+		case inflate_kind::zlib_ng: return "zlib-ng";
+		case inflate_kind::libdeflate: return "libdeflate";
+		default: return "zlib";
+		}
+	}
+
+	bool set_inflate_backend(const std::string& name) {
+		inflate_kind kind;
+		if (!find_backend(name, kind)) {
+			return false;
+		}
+		current_backend = kind;
+		return true;
+	}
+
+#ifdef BLF_HAVE_LIBDEFLATE
+	struct decompressor_deleter {
+		void operator()(libdeflate_decompressor* d) const {
+			libdeflate_free_decompressor(d);
+		}
+	};
+#endif
+
+	bool inflate_container(const std::uint8_t* src, std::size_t src_size, std::uint8_t* dst, std::size_t dst_size, std::size_t& written) {
+		switch (current_backend.load()) {
+#ifdef BLF_HAVE_ZLIB_NG
+		case inflate_kind::zlib_ng: {
+			size_t length = dst_size;
+			if (zng_uncompress(dst, &length, src, src_size) != Z_OK) {
+				return false;
+			}
+			written = length;
+			return true;
+		}
+#endif
+#ifdef BLF_HAVE_LIBDEFLATE
+		case inflate_kind::libdeflate: {
+			// A decompressor is not thread safe, each reading thread keeps its own
+			thread_local std::unique_ptr<libdeflate_decompressor, decompressor_deleter> decompressor(libdeflate_alloc_decompressor());
+			if (!decompressor) {
+				return false;
+			}
+			size_t length;
+			if (libdeflate_zlib_decompress(decompressor.get(), src, src_size, dst, dst_size, &length) != LIBDEFLATE_SUCCESS) {
+				return false;
+			}
+			written = length;
+			return true;
+		}
+#endif
+		default: {
+			uLongf length = (uLongf)dst_size;
+			if (uncompress(dst, &length, src, (uLong)src_size) != Z_OK) {
+				return false;
+			}
+			written = length;
+			return true;
+		}
+		}
+	}
+
+}
@@ -0,0 +1,29 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+#ifndef _APP_INFLATE_H
+#define _APP_INFLATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace blf_converter {
+
+	/// Names of the inflate backends built in: zlib, and zlib-ng or libdeflate if enabled with BLF_INFLATE
+	std::vector<std::string> inflate_backends();
+	/// Backend used by inflate_container(), the BLF_INFLATE build option unless overridden
+	/// by the BLF_INFLATE environment variable or set_inflate_backend()
+	std::string inflate_backend();
+	/// Selects a backend for all threads, false if it is not built in
+	bool set_inflate_backend(const std::string& name);
+
+	/// Inflates a complete zlib stream, e.g. the data of a LogContainer, into dst.
+	/// written is set to the inflated size, false if the data is invalid or does not fit.
+	bool inflate_container(const std::uint8_t* src, std::size_t src_size, std::uint8_t* dst, std::size_t dst_size, std::size_t& written);
+
+}
+
+#endif
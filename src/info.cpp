@@ -0,0 +1,280 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+
+#include <pcapng_exporter/linktype.h>
+#include <args.hxx>
+
+#include "blf_reader.hpp"
+#include "channels.hpp"
+#include "converter.hpp"
+#include "info.hpp"
+#include "summary.hpp"
+#include "views.hpp"
+
+#define NANOS_PER_SEC 1000000000
+
+using Vector::BLF::ObjectType;
+
+namespace blf_converter {
+
+	/// Sizes of the LogContainers, from their headers only
+	struct container_walk {
+		std::uint64_t containers = 0;
+		std::uint64_t compressed_bytes = 0;
+		std::uint64_t uncompressed_bytes = 0;
+		/// False if the last container is cut off or a header is invalid
+		bool complete = true;
+	};
+
+	/* Follows the object sizes of the top level objects, the container data is never read */
+	container_walk walk_containers(const std::string& path, std::uint32_t offset) {
+		container_walk walk;
+		std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+		file.seekg(0, std::ios_base::end);
+		std::streamoff size = file.tellg();
+		std::streamoff position = offset;
+		std::array<std::uint8_t, LogContainerHeaderSize> header;
+		while (position < size) {
+			file.seekg(position, std::ios_base::beg);
+			file.read((char*)header.data(), header.size());
+			if (file.gcount() < (std::streamsize)ObjectHeaderBaseSize || read_le<std::uint32_t>(header.data()) != ObjectSignature) {
+				walk.complete = false;
+				break;
+			}
+			std::uint32_t objectSize = read_le<std::uint32_t>(header.data() + 8);
+			if (objectSize < ObjectHeaderBaseSize || position + objectSize > size) {
+				walk.complete = false;
+				break;
+			}
+			if (read_le<std::uint32_t>(header.data() + 12) == (std::uint32_t)ObjectType::LOG_CONTAINER && objectSize >= LogContainerHeaderSize) {
+				walk.containers++;
+				walk.compressed_bytes += objectSize - LogContainerHeaderSize;
+				walk.uncompressed_bytes += read_le<std::uint32_t>(header.data() + 24);
+			}
+			position += objectSize + objectSize % 4;
+		}
+		return walk;
+	}
+
+	/* Bus and channel of message objects, read in place */
+	std::optional<std::pair<Bus, std::uint32_t>> message_channel(const ObjectRef& object) {
+		switch (object.type) {
+		case ObjectType::CAN_MESSAGE:
+		case ObjectType::CAN_MESSAGE2:
+		case ObjectType::CAN_FD_MESSAGE:
+			return std::make_pair(Bus::CAN, (std::uint32_t)MessageIdView(object, 0, 4, 2).channel);
+		case ObjectType::CAN_FD_MESSAGE_64:
+			return std::make_pair(Bus::CAN, (std::uint32_t)CanFdMessage64View(object).channel);
+		case ObjectType::ETHERNET_FRAME_EX:
+		case ObjectType::ETHERNET_FRAME_FORWARDED: {
+			EthernetFrameExView view(object);
+			return std::make_pair(Bus::Ethernet, 100000u * view.hardwareChannel + view.channel);
+		}
+		case ObjectType::LIN_MESSAGE:
+			return std::make_pair(Bus::LIN, (std::uint32_t)MessageIdView(object, 0, 2, 1).channel);
+		case ObjectType::LIN_MESSAGE2:
+			return std::make_pair(Bus::LIN, (std::uint32_t)MessageIdView(object, 12, 37, 1).channel);
+		case ObjectType::FLEXRAY_DATA:
+		case ObjectType::FLEXRAY_SYNC:
+		case ObjectType::FLEXRAY_MESSAGE:
+		case ObjectType::FR_RCVMESSAGE:
+		case ObjectType::FR_RCVMESSAGE_EX:
+			return std::make_pair(Bus::FlexRay, (std::uint32_t)MessageIdView(object, 0, 4, 2).channel);
+		default:
+			return std::nullopt;
+		}
+	}
+
+	std::optional<Bus> link_bus(std::optional<std::uint16_t> link_type) {
+		if (link_type == LINKTYPE_CAN) return Bus::CAN;
+		if (link_type == LINKTYPE_LIN) return Bus::LIN;
+		if (link_type == LINKTYPE_FLEXRAY) return Bus::FlexRay;
+		if (link_type == LINKTYPE_ETHERNET) return Bus::Ethernet;
+		return std::nullopt;
+	}
+
+	void write_json_string(std::ostream& os, const std::string& text) {
+		os << '"';
+		for (char c : text) {
+			if (c == '"' || c == '\\') {
+				os << '\\' << c;
+			}
+			else if ((unsigned char)c < 0x20) {
+				os << ' ';
+			}
+			else {
+				os << c;
+			}
+		}
+		os << '"';
+	}
+
+	int info_main(int argc, char* argv[]) {
+		args::ArgumentParser parser("Prints what a BLF file contains as JSON, from its header, container headers and channel metadata.");
+		parser.Prog("blf_converter info");
+		parser.helpParams.showTerminator = false;
+		parser.helpParams.proglineShowFlags = true;
+
+		args::HelpFlag help(parser, "help", "", { 'h', "help" }, args::Options::HiddenFromUsage);
+		args::Flag objectsarg(parser, "objects", "Also inflate all containers to count objects per type and list the channels used", { "objects" });
+		args::Positional<std::string> inarg(parser, "infile", "Input File", args::Options::Required);
+
+		try
+		{
+			parser.ParseCLI(argc, argv);
+		}
+		catch (args::Help)
+		{
+			std::cout << parser;
+			return 0;
+		}
+		catch (args::Error e)
+		{
+			std::cerr << e.what() << std::endl;
+			std::cerr << parser;
+			return 1;
+		}
+
+		std::string path = args::get(inarg);
+		BlfReader reader;
+		if (!reader.open(path)) {
+			std::cerr << "Unable to open: " << path << std::endl;
+			return 1;
+		}
+		const Vector::BLF::FileStatistics& stats = reader.fileStatistics;
+		container_walk walk = walk_containers(path, stats.statisticsSize);
+
+		/* channel metadata is written before the traffic, reading stops at the first other object
+		   unless all objects are to be counted */
+		channel_state channels;
+		std::map<std::uint32_t, std::uint64_t> object_types;
+		std::set<std::pair<Bus, std::uint32_t>> used_channels;
+		std::uint64_t first_ns = UINT64_MAX;
+		std::uint64_t last_ns = 0;
+		bool readable = true;
+		try {
+			ObjectRef object;
+			while (reader.next(object)) {
+				if (object.type == ObjectType::APP_TEXT) {
+					Vector::BLF::ObjectHeaderBase* ohb = reader.materialize(object);
+					if (ohb != nullptr) {
+						configure_channels(&channels, reinterpret_cast<Vector::BLF::AppText*>(ohb));
+						delete ohb;
+					}
+				}
+				else if (!objectsarg) {
+					break;
+				}
+				if (!objectsarg) {
+					continue;
+				}
+				object_types[(std::uint32_t)object.type]++;
+				ObjectView view(object, 0);
+				std::uint64_t resolution = view.objectFlags == 1 ? 100000 : view.objectFlags == 2 ? NANOS_PER_SEC : 0;
+				if (resolution != 0) {
+					std::uint64_t ns = (NANOS_PER_SEC / resolution) * view.objectTimeStamp;
+					first_ns = std::min(first_ns, ns);
+					last_ns = std::max(last_ns, ns);
+				}
+				auto channel = message_channel(object);
+				if (channel) {
+					used_channels.insert(*channel);
+				}
+			}
+		}
+		catch (std::runtime_error& e) {
+			std::cerr << "Exception: " << e.what() << std::endl;
+			readable = false;
+		}
+		reader.close();
+
+		std::uint64_t start_ns = systemtime_ns(stats.measurementStartTime);
+		// Unfinished files have no last object time
+		bool has_end = stats.lastObjectTime.year != 0;
+		std::uint64_t end_ns = has_end ? systemtime_ns(stats.lastObjectTime) : start_ns;
+		if (objectsarg && first_ns <= last_ns) {
+			end_ns = start_ns + last_ns;
+			has_end = true;
+		}
+
+		std::set<Bus> buses;
+		for (const auto& mapping : channels.mappings) {
+			auto bus = link_bus(mapping.when.chl_link);
+			if (bus) {
+				buses.insert(*bus);
+			}
+		}
+		for (const auto& channel : used_channels) {
+			buses.insert(channel.first);
+		}
+
+		std::ostream& os = std::cout;
+		os << "{\n";
+		os << "  \"file\": ";
+		write_json_string(os, path);
+		os << ",\n";
+		os << "  \"file_size\": " << stats.fileSize << ",\n";
+		os << "  \"uncompressed_size\": " << stats.uncompressedFileSize << ",\n";
+		os << "  \"application\": { \"id\": " << (int)stats.applicationId << ", \"version\": \""
+			<< (int)stats.applicationMajor << "." << (int)stats.applicationMinor << "." << stats.applicationBuild << "\" },\n";
+		os << "  \"compression_level\": " << (int)stats.compressionLevel << ",\n";
+		os << "  \"measurement_start_ns\": " << start_ns << ",\n";
+		os << "  \"end_ns\": " << (has_end ? std::to_string(end_ns) : "null") << ",\n";
+		os << "  \"duration_s\": " << (has_end ? std::to_string((double)(end_ns - start_ns) / NANOS_PER_SEC) : "null") << ",\n";
+		os << "  \"object_count\": " << stats.objectCount << ",\n";
+		os << "  \"containers\": " << walk.containers << ",\n";
+		os << "  \"compressed_bytes\": " << walk.compressed_bytes << ",\n";
+		os << "  \"inflated_bytes\": " << walk.uncompressed_bytes << ",\n";
+		os << "  \"complete\": " << (walk.complete && readable ? "true" : "false") << ",\n";
+		os << "  \"buses\": [";
+		for (auto it = buses.begin(); it != buses.end(); ++it) {
+			os << (it == buses.begin() ? "" : ", ") << '"' << bus_name(*it) << '"';
+		}
+		os << "],\n";
+		os << "  \"channels\": [";
+		bool first = true;
+		for (const auto& mapping : channels.mappings) {
+			os << (first ? "\n" : ",\n");
+			first = false;
+			auto bus = link_bus(mapping.when.chl_link);
+			os << "    { \"bus\": " << (bus ? std::string("\"") + bus_name(*bus) + "\"" : "null");
+			os << ", \"channel\": " << (mapping.when.chl_id ? std::to_string(*mapping.when.chl_id) : "null");
+			os << ", \"name\": ";
+			write_json_string(os, mapping.change.inf_name.value_or(""));
+			os << " }";
+		}
+		os << (first ? "]" : "\n  ]");
+		if (objectsarg) {
+			os << ",\n  \"used_channels\": [";
+			first = true;
+			for (const auto& channel : used_channels) {
+				os << (first ? "\n" : ",\n");
+				first = false;
+				os << "    { \"bus\": \"" << bus_name(channel.first) << "\", \"channel\": " << channel.second << " }";
+			}
+			os << (first ? "]" : "\n  ]");
+			os << ",\n  \"object_types\": {";
+			first = true;
+			for (const auto& type : object_types) {
+				os << (first ? "\n" : ",\n");
+				first = false;
+				os << "    \"" << type.first << "\": " << type.second;
+			}
+			os << (first ? "}" : "\n  }");
+		}
+		os << "\n}\n";
+		return walk.complete && readable ? 0 : 1;
+	}
+
+}
@@ -0,0 +1,15 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+#ifndef _APP_INFO_H
+#define _APP_INFO_H
+
+namespace blf_converter {
+
+	/// "info" command: prints file header, container and channel metadata as JSON
+	int info_main(int argc, char* argv[]);
+
+}
+
+#endif
@@ -0,0 +1,115 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "memory_budget.hpp"
+
+namespace blf_converter {
+
+	MemoryBudget::MemoryBudget(std::size_t limit) : max_bytes(limit) {
+	}
+
+	std::size_t MemoryBudget::limit() const {
+		return max_bytes;
+	}
+
+	std::size_t MemoryBudget::used() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return used_bytes;
+	}
+
+	std::size_t MemoryBudget::peak() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return peak_bytes;
+	}
+
+	bool MemoryBudget::exceeded() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return max_bytes != 0 && used_bytes > max_bytes;
+	}
+
+	void MemoryBudget::add(std::size_t bytes) {
+		used_bytes += bytes;
+		if (used_bytes > peak_bytes) {
+			peak_bytes = used_bytes;
+		}
+	}
+
+	bool MemoryBudget::try_acquire(std::size_t bytes) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (max_bytes != 0 && used_bytes + bytes > max_bytes) {
+			return false;
+		}
+		add(bytes);
+		return true;
+	}
+
+	void MemoryBudget::release(std::size_t bytes) {
+		std::lock_guard<std::mutex> lock(mutex);
+		used_bytes -= std::min(bytes, used_bytes);
+	}
+
+	void MemoryBudget::update(std::size_t old_bytes, std::size_t new_bytes) {
+		if (new_bytes == old_bytes) {
+			return;
+		}
+		if (new_bytes < old_bytes) {
+			release(old_bytes - new_bytes);
+			return;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		add(new_bytes - old_bytes);
+	}
+
+	std::size_t peak_rss() {
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+			return 0;
+		}
+		return counters.PeakWorkingSetSize;
+#else
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0) {
+			return 0;
+		}
+#ifdef __APPLE__
+		// Bytes on macOS, kilobytes elsewhere
+		return usage.ru_maxrss;
+#else
+		return (std::size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+	}
+
+	std::size_t parse_size(const std::string& text) {
+		std::size_t end = 0;
+		unsigned long long value;
+		try {
+			value = std::stoull(text, &end);
+		}
+		catch (std::exception&) {
+			return 0;
+		}
+		std::string unit = text.substr(end);
+		if (unit.empty() || unit == "B") return value;
+		if (unit == "K" || unit == "KB") return value << 10;
+		if (unit == "M" || unit == "MB") return value << 20;
+		if (unit == "G" || unit == "GB") return value << 30;
+		return 0;
+	}
+
+}
@@ -0,0 +1,49 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+#ifndef _APP_MEMORY_BUDGET_H
+#define _APP_MEMORY_BUDGET_H
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+
+namespace blf_converter {
+
+	/// Shared limit for the buffers of a conversion: read buffers, inflated containers,
+	/// pending frames and output buffers. A limit of 0 means unlimited.
+	class MemoryBudget {
+	public:
+		explicit MemoryBudget(std::size_t limit = 0);
+
+		std::size_t limit() const;
+		std::size_t used() const;
+		/// Highest value of used() so far
+		std::size_t peak() const;
+		bool exceeded() const;
+
+		/// Reserves bytes only if they fit, callers wait for other parts to release memory
+		bool try_acquire(std::size_t bytes);
+		void release(std::size_t bytes);
+		/// Changes a reservation without waiting, for buffers that must grow to make progress
+		void update(std::size_t old_bytes, std::size_t new_bytes);
+
+	private:
+		void add(std::size_t bytes);
+
+		std::size_t max_bytes;
+		std::size_t used_bytes = 0;
+		std::size_t peak_bytes = 0;
+		mutable std::mutex mutex;
+	};
+
+	/// Peak resident set size of the process in bytes, 0 if unknown
+	std::size_t peak_rss();
+
+	/// Parses sizes like "512M" or "2G", returns 0 if invalid
+	std::size_t parse_size(const std::string& text);
+
+}
+
+#endif
@@ -0,0 +1,210 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+
+#include <pcapng_exporter/pcapng_exporter.hpp>
+#include <zlib.h>
+
+#include "writer_thread_sink.hpp"
+#include "columnar_sink.hpp"
+#include "outputs.hpp"
+#include "pcapng_sink.hpp"
+
+namespace blf_converter {
+
+	/* Splits text at every separator */
+	std::vector<std::string> split(const std::string& text, char separator) {
+		std::vector<std::string> parts;
+		std::size_t begin = 0;
+		while (true) {
+			std::size_t end = text.find(separator, begin);
+			parts.push_back(text.substr(begin, end - begin));
+			if (end == std::string::npos) {
+				return parts;
+			}
+			begin = end + 1;
+		}
+	}
+
+	bool ends_with(const std::string& text, const std::string& suffix) {
+		return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
+
+	bool parse_output_spec(const std::string& text, output_spec& spec, std::string& error) {
+		std::vector<std::string> parts = split(text, ',');
+		spec.path = parts[0];
+		if (spec.path.empty()) {
+			error = "Missing output path in " + text;
+			return false;
+		}
+		spec.format = ends_with(spec.path, ".json") ? "summary" : ends_with(spec.path, ".gz") ? "pcapng.gz" : "pcapng";
+
+		for (std::size_t i = 1; i < parts.size(); i++) {
+			std::size_t equals = parts[i].find('=');
+			std::string key = parts[i].substr(0, equals);
+			std::string value = equals == std::string::npos ? "" : parts[i].substr(equals + 1);
+			if (key == "format") {
+				spec.format = value;
+			}
+			else if (key == "channel-map") {
+				spec.channel_map = value;
+			}
+			else if (key == "types") {
+				for (const auto& name : split(value, '+')) {
+					std::uint16_t link_type;
+					if (!parse_link_type(name, link_type)) {
+						error = "Unknown link type: " + name;
+						return false;
+					}
+					spec.filter.link_types.insert(link_type);
+				}
+				spec.filtered = true;
+			}
+			else if (key == "channels") {
+				for (const auto& channel : split(value, '+')) {
+					try {
+						spec.filter.channels.insert((std::uint32_t)std::stoul(channel));
+					}
+					catch (std::exception&) {
+						error = "Invalid channel: " + channel;
+						return false;
+					}
+				}
+				spec.filtered = true;
+			}
+			else {
+				error = "Unknown output option: " + key;
+				return false;
+			}
+		}
+
+		if (spec.format != "pcapng" && spec.format != "pcapng.gz" && spec.format != "columnar" && spec.format != "summary") {
+			error = "Unknown format: " + spec.format;
+			return false;
+		}
+		if (spec.format == "summary" && spec.filtered) {
+			error = "Summary outputs can not be filtered";
+			return false;
+		}
+		return true;
+	}
+
+	std::unique_ptr<FrameSink> open_output(const output_spec& spec, const std::string& channel_map, MemoryBudget* budget, std::uint64_t preallocate) {
+		std::unique_ptr<FrameSink> sink;
+		if (spec.format == "columnar") {
+			auto columnar = std::make_unique<ColumnarSink>(spec.path, budget);
+			if (!columnar->is_open()) {
+				std::cerr << "Unable to create columnar files for " << spec.path << std::endl;
+				return nullptr;
+			}
+			sink = std::make_unique<WriterThreadSink>(std::move(columnar), budget);
+		}
+		else if (spec.format == "pcapng" || spec.format == "pcapng.gz") {
+			bool compressed = spec.format == "pcapng.gz";
+			std::string path = compressed ? spec.path + ".tmp" : spec.path;
+			auto pcapng = std::make_unique<PcapngSink>(path, spec.channel_map.empty() ? channel_map : spec.channel_map);
+			auto writer = std::make_unique<WriterThreadSink>(std::move(pcapng), budget);
+			if (preallocate > 0) {
+				writer->preallocate(path, preallocate);
+			}
+			sink = std::move(writer);
+			if (compressed) {
+				sink = std::make_unique<GzipSink>(std::move(sink), path, spec.path);
+			}
+		}
+		else {
+			std::cerr << "Unknown format: " << spec.format << std::endl;
+			return nullptr;
+		}
+		if (spec.filtered) {
+			sink = std::make_unique<FilterSink>(spec.filter, std::move(sink));
+		}
+		return sink;
+	}
+
+	bool gzip_file(const std::string& src, const std::string& dst) {
+		FILE* in = fopen(src.c_str(), "rb");
+		if (in == nullptr) {
+			return false;
+		}
+		gzFile out = gzopen(dst.c_str(), "wb");
+		if (out == nullptr) {
+			fclose(in);
+			return false;
+		}
+		std::vector<char> buffer(1 << 20);
+		bool ok = true;
+		std::size_t length;
+		while (ok && (length = fread(buffer.data(), 1, buffer.size(), in)) > 0) {
+			ok = gzwrite(out, buffer.data(), (unsigned)length) == (int)length;
+		}
+		ok = ok && !ferror(in);
+		fclose(in);
+		return gzclose(out) == Z_OK && ok;
+	}
+
+	GzipSink::~GzipSink() {
+		sink->flush();
+		sink.reset();
+		if (!gzip_file(temp_path, path)) {
+			std::cerr << "Unable to compress " << temp_path << " to " << path << std::endl;
+			return;
+		}
+		std::error_code ec;
+		std::filesystem::remove(temp_path, ec);
+	}
+
+	void GzipSink::write_frame(const Frame& frame) {
+		sink->write_frame(frame);
+	}
+
+	void GzipSink::discard_frame(const Frame& frame, Discard reason, std::uint64_t count) {
+		sink->discard_frame(frame, reason, count);
+	}
+
+	void GzipSink::add_mapping(const pcapng_exporter::channel_mapping& mapping) {
+		sink->add_mapping(mapping);
+	}
+
+	void GzipSink::flush() {
+		sink->flush();
+	}
+
+	void FanoutSink::add(std::unique_ptr<FrameSink> sink) {
+		sinks.push_back(std::move(sink));
+	}
+
+	bool FanoutSink::empty() const {
+		return sinks.empty();
+	}
+
+	void FanoutSink::write_frame(const Frame& frame) {
+		for (auto& sink : sinks) {
+			sink->write_frame(frame);
+		}
+	}
+
+	void FanoutSink::discard_frame(const Frame& frame, Discard reason, std::uint64_t count) {
+		for (auto& sink : sinks) {
+			sink->discard_frame(frame, reason, count);
+		}
+	}
+
+	void FanoutSink::add_mapping(const pcapng_exporter::channel_mapping& mapping) {
+		for (auto& sink : sinks) {
+			sink->add_mapping(mapping);
+		}
+	}
+
+	void FanoutSink::flush() {
+		for (auto& sink : sinks) {
+			sink->flush();
+		}
+	}
+
+}
@@ -0,0 +1,76 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+#ifndef _APP_OUTPUTS_H
+#define _APP_OUTPUTS_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "frame_filter.hpp"
+#include "memory_budget.hpp"
+#include "sink.hpp"
+
+namespace blf_converter {
+
+	/// One product of a conversion, see parse_output_spec()
+	struct output_spec {
+		std::string path;
+		/// pcapng, pcapng.gz, columnar or summary
+		std::string format;
+		frame_filter filter;
+		bool filtered = false;
+		/// Channel map file of this output, the default one if empty
+		std::string channel_map;
+	};
+
+	/// Parses "path[,format=F][,types=can+ethernet][,channels=1+2][,channel-map=file]".
+	/// The format defaults to summary for .json, pcapng.gz for .gz and pcapng otherwise.
+	bool parse_output_spec(const std::string& text, output_spec& spec, std::string& error);
+
+	/// Creates the frame sink of an output with its own writer thread, nullptr for summaries or on errors.
+	/// preallocate is the expected size of uncompressed pcapng outputs, 0 if unknown.
+	std::unique_ptr<FrameSink> open_output(const output_spec& spec, const std::string& channel_map, MemoryBudget* budget, std::uint64_t preallocate);
+
+	/// Compresses src to a new gzip file dst
+	bool gzip_file(const std::string& src, const std::string& dst);
+
+	/// Writes to a temporary file that is compressed to path once the sink is destroyed
+	class GzipSink : public FrameSink {
+	public:
+		/// sink writes to temp_path
+		GzipSink(std::unique_ptr<FrameSink> sink, std::string temp_path, std::string path)
+			: sink(std::move(sink)), temp_path(std::move(temp_path)), path(std::move(path)) {}
+		~GzipSink();
+
+		void write_frame(const Frame& frame) override;
+		void discard_frame(const Frame& frame, Discard reason, std::uint64_t count) override;
+		void add_mapping(const pcapng_exporter::channel_mapping& mapping) override;
+		void flush() override;
+
+	private:
+		std::unique_ptr<FrameSink> sink;
+		std::string temp_path;
+		std::string path;
+	};
+
+	/// Hands every frame and mapping to several sinks
+	class FanoutSink : public FrameSink {
+	public:
+		void add(std::unique_ptr<FrameSink> sink);
+		bool empty() const;
+
+		void write_frame(const Frame& frame) override;
+		void discard_frame(const Frame& frame, Discard reason, std::uint64_t count) override;
+		void add_mapping(const pcapng_exporter::channel_mapping& mapping) override;
+		void flush() override;
+
+	private:
+		std::vector<std::unique_ptr<FrameSink>> sinks;
+	};
+
+}
+
+#endif
@@ -0,0 +1,283 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include <pcapng_exporter/linktype.h>
+
+#include "pcapng_sink.hpp"
+
+#define NANOS_PER_SEC 1000000000
+
+/// pcapng block types
+#define BLOCK_SECTION_HEADER        0x0A0D0D0A
+#define BLOCK_INTERFACE_DESCRIPTION 0x00000001
+#define BLOCK_INTERFACE_STATISTICS  0x00000005
+#define BLOCK_ENHANCED_PACKET       0x00000006
+#define BYTE_ORDER_MAGIC            0x1A2B3C4D
+
+/// pcapng options
+#define OPT_ENDOFOPT     0
+#define IF_NAME          2
+#define IF_DESCRIPTION   3
+#define IF_TSRESOL       9
+#define EPB_FLAGS        2
+#define ISB_STARTTIME    2
+#define ISB_ENDTIME      3
+#define ISB_IFRECV       4
+#define ISB_FILTERACCEPT 6
+#define ISB_USRDELIV     8
+
+/// epb_flags direction
+#define EPB_INBOUND  1
+#define EPB_OUTBOUND 2
+
+namespace blf_converter {
+
+	/* true for CAN error frames, FlexRay frames with error flags and LIN frames with errors */
+	bool is_error_frame(const Frame& frame) {
+		switch (frame.link_type) {
+		case LINKTYPE_CAN:
+			// CAN_ERR_FLAG of the big endian SocketCAN id
+			return frame.length >= 4 && (frame.data[0] & 0x20) != 0;
+		case LINKTYPE_FLEXRAY:
+			// Error flags after the measurement header
+			return frame.length >= 2 && frame.data[1] != 0;
+		case LINKTYPE_LIN:
+			// Error byte of the LINKTYPE_LIN header
+			return frame.length >= 8 && frame.data[7] != 0;
+		default:
+			return false;
+		}
+	}
+
+	void put(std::vector<std::uint8_t>& block, const void* value, std::size_t length) {
+		block.insert(block.end(), (const std::uint8_t*)value, (const std::uint8_t*)value + length);
+	}
+
+	void put32(std::vector<std::uint8_t>& block, std::uint32_t value) {
+		put(block, &value, 4);
+	}
+
+	/* timestamps are written in ns, high word first */
+	void put_timestamp(std::vector<std::uint8_t>& block, std::uint64_t ns) {
+		put32(block, (std::uint32_t)(ns >> 32));
+		put32(block, (std::uint32_t)ns);
+	}
+
+	void put_option(std::vector<std::uint8_t>& block, std::uint16_t code, const void* value, std::uint16_t length) {
+		put(block, &code, 2);
+		put(block, &length, 2);
+		put(block, value, length);
+		block.resize((block.size() + 3) & ~(std::size_t)3);
+	}
+
+	PcapngSink::PcapngSink(std::string path, const std::string& mapping_file)
+		: path(std::move(path)) {
+		if (!mapping_file.empty()) {
+			// Nothing is written through this exporter, it only parses the mapping file
+			mappings = pcapng_exporter::PcapngExporter(this->path, mapping_file).mappings;
+		}
+	}
+
+	PcapngSink::~PcapngSink() {
+		// An input without frames still gives a valid, empty section
+		if (file == nullptr && !open()) {
+			return;
+		}
+		write_statistics();
+		if (fclose(file) != 0 || failed) {
+			std::cerr << "Unable to write " << path << std::endl;
+		}
+		if (report != nullptr) {
+			*report = interfaces;
+		}
+	}
+
+	void PcapngSink::write_frame(const Frame& frame) {
+		if (file == nullptr && !open()) {
+			return;
+		}
+
+		std::uint64_t key = (std::uint64_t)frame.channel_id << 16 | frame.link_type;
+		auto it = channels.find(key);
+		channel_target target;
+		if (it != channels.end()) {
+			target = it->second;
+		}
+		else {
+			const auto* mapping = find_mapping(frame.channel_id, frame.link_type);
+			std::string name = mapping != nullptr && mapping->change.inf_name
+				? *mapping->change.inf_name : std::to_string(frame.channel_id);
+			target.interface_id = find_interface(frame.link_type, name);
+			target.flags = 0;
+			if (mapping != nullptr && mapping->change.pkt_dir) {
+				target.flags = *mapping->change.pkt_dir == pcapng_exporter::frame_direction::Rx ? EPB_INBOUND : EPB_OUTBOUND;
+			}
+			channels[key] = target;
+			auto counts = pending.find(key);
+			if (counts != pending.end()) {
+				interfaces[target.interface_id].filtered += counts->second.filtered;
+				interfaces[target.interface_id].dropped += counts->second.dropped;
+				pending.erase(counts);
+			}
+		}
+
+		interface_statistics& stats = interfaces[target.interface_id];
+		std::uint64_t ns = (std::uint64_t)frame.timestamp.tv_sec * NANOS_PER_SEC + frame.timestamp.tv_nsec;
+		if (stats.packets == 0 || ns < stats.first_ns) {
+			stats.first_ns = ns;
+		}
+		stats.last_ns = std::max(stats.last_ns, ns);
+		stats.packets++;
+		stats.bytes += frame.length;
+		if (is_error_frame(frame)) {
+			stats.errors++;
+		}
+
+		block.clear();
+		put32(block, target.interface_id);
+		put_timestamp(block, ns);
+		put32(block, frame.length);
+		put32(block, std::max(frame.original_length, frame.length));
+		put(block, frame.data, frame.length);
+		block.resize((block.size() + 3) & ~(std::size_t)3);
+		if (target.flags != 0) {
+			put_option(block, EPB_FLAGS, &target.flags, 4);
+			put_option(block, OPT_ENDOFOPT, nullptr, 0);
+		}
+		write_block(BLOCK_ENHANCED_PACKET, block);
+	}
+
+	void PcapngSink::discard_frame(const Frame& frame, Discard reason, std::uint64_t count) {
+		std::uint64_t key = (std::uint64_t)frame.channel_id << 16 | frame.link_type;
+		auto it = channels.find(key);
+		if (it == channels.end()) {
+			discards& counts = pending[key];
+			(reason == Discard::Filtered ? counts.filtered : counts.dropped) += count;
+			return;
+		}
+		interface_statistics& stats = interfaces[it->second.interface_id];
+		(reason == Discard::Filtered ? stats.filtered : stats.dropped) += count;
+	}
+
+	void PcapngSink::add_mapping(const pcapng_exporter::channel_mapping& mapping) {
+		mappings.push_back(mapping);
+		// Later frames of a channel may go to another interface
+		channels.clear();
+	}
+
+	void PcapngSink::flush() {
+		if (file != nullptr) {
+			fflush(file);
+		}
+	}
+
+	const std::vector<interface_statistics>& PcapngSink::statistics() const {
+		return interfaces;
+	}
+
+	void PcapngSink::report_to(std::vector<interface_statistics>* out) {
+		report = out;
+	}
+
+	bool PcapngSink::open() {
+		file = fopen(path.c_str(), "wb");
+		if (file == nullptr) {
+			if (!failed) {
+				std::cerr << "Unable to create " << path << std::endl;
+			}
+			failed = true;
+			return false;
+		}
+		block.clear();
+		put32(block, BYTE_ORDER_MAGIC);
+		std::uint16_t version[2] = { 1, 0 };
+		put(block, version, 4);
+		// Section length not specified
+		put32(block, 0xFFFFFFFF);
+		put32(block, 0xFFFFFFFF);
+		write_block(BLOCK_SECTION_HEADER, block);
+		return true;
+	}
+
+	std::uint32_t PcapngSink::find_interface(std::uint16_t link_type, const std::string& name) {
+		for (std::size_t id = 0; id < interfaces.size(); id++) {
+			if (interfaces[id].link_type == link_type && interfaces[id].name == name) {
+				return (std::uint32_t)id;
+			}
+		}
+		interface_statistics stats;
+		stats.link_type = link_type;
+		stats.name = name;
+		interfaces.push_back(stats);
+
+		block.clear();
+		std::uint16_t link[2] = { link_type, 0 };
+		put(block, link, 4);
+		// No snap length
+		put32(block, 0);
+		std::uint8_t resolution = 9;
+		put_option(block, IF_TSRESOL, &resolution, 1);
+		// Names are written with their terminating zero
+		put_option(block, IF_NAME, name.c_str(), (std::uint16_t)(name.size() + 1));
+		put_option(block, IF_DESCRIPTION, name.c_str(), (std::uint16_t)(name.size() + 1));
+		put_option(block, OPT_ENDOFOPT, nullptr, 0);
+		write_block(BLOCK_INTERFACE_DESCRIPTION, block);
+		return (std::uint32_t)(interfaces.size() - 1);
+	}
+
+	const pcapng_exporter::channel_mapping* PcapngSink::find_mapping(std::uint32_t channel_id, std::uint16_t link_type) const {
+		std::string name = std::to_string(channel_id);
+		for (const auto& mapping : mappings) {
+			if ((mapping.when.chl_id && *mapping.when.chl_id != channel_id)
+				|| (mapping.when.chl_link && *mapping.when.chl_link != link_type)
+				|| (mapping.when.inf_name && *mapping.when.inf_name != name)) {
+				continue;
+			}
+			return &mapping;
+		}
+		return nullptr;
+	}
+
+	void PcapngSink::write_block(std::uint32_t type, const std::vector<std::uint8_t>& body) {
+		std::uint32_t length = (std::uint32_t)body.size() + 12;
+		std::uint32_t header[2] = { type, length };
+		// Written in host byte order, announced by the section header
+		bool ok = fwrite(header, 4, 2, file) == 2
+			&& fwrite(body.data(), 1, body.size(), file) == body.size()
+			&& fwrite(&length, 4, 1, file) == 1;
+		failed = failed || !ok;
+	}
+
+	void PcapngSink::write_statistics() {
+		// Statistics follow the packets, so they cover the whole interface
+		for (std::size_t id = 0; id < interfaces.size(); id++) {
+			const interface_statistics& stats = interfaces[id];
+			// Frames reaching the sink, passing the filters, and written. Duplicates dropped by
+			// DedupSink passed the filters, they are the difference of the last two.
+			std::uint64_t received = stats.packets + stats.filtered + stats.dropped;
+			std::uint64_t accepted = stats.packets + stats.dropped;
+
+			block.clear();
+			put32(block, (std::uint32_t)id);
+			put_timestamp(block, stats.last_ns);
+			std::vector<std::uint8_t> time;
+			put_timestamp(time, stats.first_ns);
+			put_option(block, ISB_STARTTIME, time.data(), 8);
+			time.clear();
+			put_timestamp(time, stats.last_ns);
+			put_option(block, ISB_ENDTIME, time.data(), 8);
+			put_option(block, ISB_IFRECV, &received, 8);
+			put_option(block, ISB_FILTERACCEPT, &accepted, 8);
+			put_option(block, ISB_USRDELIV, &stats.packets, 8);
+			put_option(block, OPT_ENDOFOPT, nullptr, 0);
+			write_block(BLOCK_INTERFACE_STATISTICS, block);
+		}
+	}
+
+}
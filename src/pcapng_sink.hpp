@@ -0,0 +1,97 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+#ifndef _APP_PCAPNG_SINK_H
+#define _APP_PCAPNG_SINK_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <pcapng_exporter/pcapng_exporter.hpp>
+
+#include "sink.hpp"
+
+namespace blf_converter {
+
+	/// Counters of one interface of the pcapng output
+	struct interface_statistics {
+		std::uint16_t link_type;
+		/// Interface name after the channel mappings
+		std::string name;
+		std::uint64_t packets = 0;
+		/// Captured bytes of the packets
+		std::uint64_t bytes = 0;
+		/// Absolute times of the first and last packet in ns
+		std::uint64_t first_ns = 0;
+		std::uint64_t last_ns = 0;
+		std::uint64_t filtered = 0;
+		std::uint64_t dropped = 0;
+		/// CAN error frames, FlexRay frames with error flags and LIN frames with errors
+		std::uint64_t errors = 0;
+	};
+
+	/// Writes frames to a pcapng file, in the layout of PcapngExporter. Interfaces are
+	/// named by the channel mappings, an Interface Statistics Block per interface is
+	/// written when the sink is destroyed. The blocks are written here as PcapngExporter
+	/// neither reports the interface ids it assigns nor writes statistics blocks; the
+	/// mapping tests compare the output with its references byte for byte.
+	class PcapngSink : public FrameSink {
+	public:
+		/// mapping_file is read by PcapngExporter, empty for none
+		PcapngSink(std::string path, const std::string& mapping_file);
+		PcapngSink(std::string path, std::vector<pcapng_exporter::channel_mapping> mappings)
+			: path(std::move(path)), mappings(std::move(mappings)) {}
+		~PcapngSink();
+
+		/// The file is created by the first frame, or on destruction if there was none
+		void write_frame(const Frame& frame) override;
+		void discard_frame(const Frame& frame, Discard reason, std::uint64_t count) override;
+		void add_mapping(const pcapng_exporter::channel_mapping& mapping) override;
+		void flush() override;
+
+		/// Interfaces in the order of their ids in the output
+		const std::vector<interface_statistics>& statistics() const;
+		/// Copies the statistics to out when the sink is destroyed
+		void report_to(std::vector<interface_statistics>* out);
+
+	private:
+		/// Creates the file and writes the section header, false if it can not be created
+		bool open();
+		/// Id of the interface with a link type and name, written if new
+		std::uint32_t find_interface(std::uint16_t link_type, const std::string& name);
+		/// First mapping matching a channel, nullptr if none
+		const pcapng_exporter::channel_mapping* find_mapping(std::uint32_t channel_id, std::uint16_t link_type) const;
+		void write_block(std::uint32_t type, const std::vector<std::uint8_t>& body);
+		void write_statistics();
+
+		struct discards {
+			std::uint64_t filtered = 0;
+			std::uint64_t dropped = 0;
+		};
+
+		/// Interface id and epb_flags of the frames of a channel
+		struct channel_target {
+			std::uint32_t interface_id;
+			std::uint32_t flags;
+		};
+
+		std::string path;
+		std::vector<pcapng_exporter::channel_mapping> mappings;
+		FILE* file = nullptr;
+		bool failed = false;
+		std::vector<interface_statistics> interfaces;
+		/// channel_id << 16 | link_type, cleared when the mappings change
+		std::unordered_map<std::uint64_t, channel_target> channels;
+		/// Discards of channels without an interface, counted once the channel is written
+		std::unordered_map<std::uint64_t, discards> pending;
+		std::vector<interface_statistics>* report = nullptr;
+		std::vector<std::uint8_t> block;
+	};
+
+}
+
+#endif
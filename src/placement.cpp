@@ -0,0 +1,151 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+
+#include <cstdint>
+#include <mutex>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+#include "placement.hpp"
+
+namespace blf_converter {
+
+	struct stage_placement {
+		std::vector<unsigned> cpus;
+		unsigned threads = 0;
+		unsigned failed = 0;
+	};
+
+	std::mutex placement_mutex;
+	stage_placement placements[3];
+
+	const char* stage_name(Stage stage) {
+		switch (stage) {
+		case Stage::Reader: return "reader";
+		case Stage::Encoder: return "encoder";
+		default: return "writer";
+		}
+	}
+
+	bool parse_stage(const std::string& name, Stage& stage) {
+		for (Stage s : { Stage::Reader, Stage::Encoder, Stage::Writer }) {
+			if (name == stage_name(s)) {
+				stage = s;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool parse_cpu_list(const std::string& text, std::vector<unsigned>& cpus) {
+		std::size_t begin = 0;
+		while (begin <= text.size()) {
+			std::size_t end = text.find(',', begin);
+			if (end == std::string::npos) {
+				end = text.size();
+			}
+			std::string range = text.substr(begin, end - begin);
+			std::size_t dash = range.find('-');
+			try {
+				unsigned first = std::stoul(range.substr(0, dash));
+				unsigned last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+				if (last < first || last >= 4096) {
+					return false;
+				}
+				for (unsigned cpu = first; cpu <= last; cpu++) {
+					cpus.push_back(cpu);
+				}
+			}
+			catch (std::exception&) {
+				return false;
+			}
+			begin = end + 1;
+		}
+		return !cpus.empty();
+	}
+
+	void set_stage_cpus(Stage stage, std::vector<unsigned> cpus) {
+		std::lock_guard<std::mutex> lock(placement_mutex);
+		placements[(int)stage].cpus = std::move(cpus);
+	}
+
+	/* false if the thread could not be pinned */
+	bool set_affinity(const std::vector<unsigned>& cpus) {
+#if defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (unsigned cpu : cpus) {
+			if (cpu < CPU_SETSIZE) {
+				CPU_SET(cpu, &set);
+			}
+		}
+		return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+		DWORD_PTR mask = 0;
+		for (unsigned cpu : cpus) {
+			// Only the first processor group can be addressed with a mask
+			if (cpu < sizeof(mask) * 8) {
+				mask |= (DWORD_PTR)1 << cpu;
+			}
+		}
+		return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+		return false;
+#endif
+	}
+
+	void pin_thread(Stage stage) {
+		std::vector<unsigned> cpus;
+		{
+			std::lock_guard<std::mutex> lock(placement_mutex);
+			stage_placement& placement = placements[(int)stage];
+			placement.threads++;
+			cpus = placement.cpus;
+		}
+		if (cpus.empty() || set_affinity(cpus)) {
+			return;
+		}
+		std::lock_guard<std::mutex> lock(placement_mutex);
+		placements[(int)stage].failed++;
+	}
+
+	void write_placement(std::ostream& os) {
+		std::lock_guard<std::mutex> lock(placement_mutex);
+		for (Stage stage : { Stage::Reader, Stage::Encoder, Stage::Writer }) {
+			const stage_placement& placement = placements[(int)stage];
+			os << "Stage " << stage_name(stage) << ": " << placement.threads << " threads, cpus ";
+			if (placement.cpus.empty()) {
+				os << "any";
+			}
+			for (std::size_t i = 0; i < placement.cpus.size(); i++) {
+				os << (i > 0 ? "," : "") << placement.cpus[i];
+			}
+			if (placement.failed > 0) {
+				os << ", " << placement.failed << " not pinned";
+			}
+			os << "\n";
+		}
+	}
+
+	void advise_huge_pages(void* data, std::size_t size) {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+		const std::uintptr_t huge_page = 2 << 20;
+		std::uintptr_t begin = ((std::uintptr_t)data + huge_page - 1) & ~(huge_page - 1);
+		std::uintptr_t end = ((std::uintptr_t)data + size) & ~(huge_page - 1);
+		if (begin < end) {
+			madvise((void*)begin, end - begin, MADV_HUGEPAGE);
+		}
+#endif
+	}
+
+}
@@ -0,0 +1,44 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+#ifndef _APP_PLACEMENT_H
+#define _APP_PLACEMENT_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace blf_converter {
+
+	/// Threads of the conversion pipeline
+	enum class Stage {
+		/// Reads and inflates the containers, the converting thread
+		Reader,
+		/// EncodingPool workers
+		Encoder,
+		/// Writer threads of WriterThreadSink and EncodingPool
+		Writer
+	};
+
+	/// Parses "reader", "encoder" or "writer"
+	bool parse_stage(const std::string& name, Stage& stage);
+	/// Parses a CPU list like "0-3,8"
+	bool parse_cpu_list(const std::string& text, std::vector<unsigned>& cpus);
+
+	/// CPUs for the threads of a stage, empty to leave their placement to the OS.
+	/// Buffers are allocated and first written by their pinned threads, so with the
+	/// default first touch policy their memory is on the local NUMA node.
+	void set_stage_cpus(Stage stage, std::vector<unsigned> cpus);
+	/// Pins the calling thread to the CPUs of stage, if set. Linux and Windows only.
+	void pin_thread(Stage stage);
+	/// Threads started per stage, their CPUs and pinning failures
+	void write_placement(std::ostream& os);
+
+	/// Asks for transparent huge pages for the whole pages in [data, data + size), Linux only
+	void advise_huge_pages(void* data, std::size_t size);
+
+}
+
+#endif
@@ -0,0 +1,758 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <condition_variable>
+#include <csignal>
+#include <deque>
+#include <functional>
+#include <list>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <pcapng_exporter/pcapng_exporter.hpp>
+#include <args.hxx>
+
+#include "converter.hpp"
+#include "frame_buffer.hpp"
+#include "frame_filter.hpp"
+#include "pcapng_sink.hpp"
+#include "serve.hpp"
+
+namespace fs = std::filesystem;
+
+namespace blf_converter {
+
+	std::atomic<bool> serve_stopped(false);
+
+	void on_serve_signal(int) {
+		serve_stopped = true;
+	}
+
+	bool is_blf(const fs::path& path) {
+		std::string extension = path.extension().string();
+		return extension == ".blf" || extension == ".BLF";
+	}
+
+	/// Parsed channel map file, parsed again only when the file changes
+	class mapping_cache {
+	public:
+		explicit mapping_cache(std::string path) : path(std::move(path)) {}
+
+		std::vector<pcapng_exporter::channel_mapping> get(const fs::path& scratch) {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (path.empty()) {
+				return {};
+			}
+			std::error_code ec;
+			fs::file_time_type time = fs::last_write_time(path, ec);
+			if (!loaded || time != loaded_time) {
+				// The exporter only creates its output once a packet is written
+				mappings = pcapng_exporter::PcapngExporter(scratch.string(), path).mappings;
+				loaded_time = time;
+				loaded = true;
+			}
+			return mappings;
+		}
+
+	private:
+		std::string path;
+		std::mutex mutex;
+		bool loaded = false;
+		fs::file_time_type loaded_time;
+		std::vector<pcapng_exporter::channel_mapping> mappings;
+	};
+
+	/// Converts infile to outfile, written under a temporary name and renamed when complete
+	bool convert_file(const fs::path& infile, const fs::path& outfile, mapping_cache& mappings) {
+		fs::path temp = outfile.parent_path() / ("." + outfile.filename().string() + ".tmp");
+
+		Converter converter;
+		if (!converter.open(infile.string())) {
+			std::cerr << "Unable to open: " << infile.string() << std::endl;
+			return false;
+		}
+		bool complete;
+		{
+			PcapngSink sink(temp.string(), mappings.get(temp));
+			complete = converter.run(sink);
+			sink.flush();
+		}
+		converter.close();
+
+		std::error_code ec;
+		if (!complete) {
+			fs::remove(temp, ec);
+			return false;
+		}
+		fs::rename(temp, outfile, ec);
+		if (ec) {
+			std::cerr << "Unable to rename " << temp.string() << ": " << ec.message() << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	/// Fixed number of threads running queued tasks
+	class task_pool {
+	public:
+		explicit task_pool(unsigned threads) {
+			for (unsigned i = 0; i < threads; i++) {
+				workers.emplace_back(&task_pool::work, this);
+			}
+		}
+
+		~task_pool() {
+			stop();
+		}
+
+		/// Waits for the running tasks and drops the queued ones, which releases what they captured
+		void stop() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			changed.notify_all();
+			for (auto& worker : workers) {
+				worker.join();
+			}
+			workers.clear();
+			todo.clear();
+		}
+
+		void add(std::function<void()> task) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				todo.push_back(std::move(task));
+			}
+			changed.notify_one();
+		}
+
+	private:
+		void work() {
+			while (true) {
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [&]() { return !todo.empty() || stopping; });
+				if (stopping) {
+					return;
+				}
+				std::function<void()> task = std::move(todo.front());
+				todo.pop_front();
+				lock.unlock();
+				task();
+			}
+		}
+
+		std::mutex mutex;
+		std::condition_variable changed;
+		std::deque<std::function<void()>> todo;
+		bool stopping = false;
+		std::vector<std::thread> workers;
+	};
+
+	/// Converts files on a task_pool, each file is queued once at a time. A file written
+	/// again while it is converted is converted once more afterwards.
+	class conversion_queue {
+	public:
+		conversion_queue(task_pool& pool, fs::path output, mapping_cache& mappings)
+			: pool(pool), output(std::move(output)), mappings(mappings) {}
+
+		void add(const fs::path& infile) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (running.count(infile) != 0) {
+					// The running conversion may have read the file before this write
+					dirty.insert(infile);
+					return;
+				}
+				if (!queued.insert(infile).second) {
+					return;
+				}
+			}
+			pool.add([this, infile]() {
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					queued.erase(infile);
+					running.insert(infile);
+				}
+				fs::path outfile = output / fs::path(infile.filename()).replace_extension(".pcapng");
+				auto start = std::chrono::steady_clock::now();
+				bool ok = convert_file(infile, outfile, mappings);
+				auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+				std::cout << (ok ? "Converted " : "Failed ") << infile.string() << " (" << ms << " ms)" << std::endl;
+
+				bool again;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					running.erase(infile);
+					again = dirty.erase(infile) != 0;
+				}
+				if (again) {
+					add(infile);
+				}
+			});
+		}
+
+	private:
+		task_pool& pool;
+		fs::path output;
+		mapping_cache& mappings;
+		std::mutex mutex;
+		/// Files waiting for a worker
+		std::set<fs::path> queued;
+		std::set<fs::path> running;
+		/// Running files written again since their conversion started
+		std::set<fs::path> dirty;
+	};
+
+#ifdef __linux__
+	/* Waits for files closed after writing or moved into dir, until stopped */
+	bool watch(const fs::path& dir, conversion_queue& queue) {
+		int fd = inotify_init1(IN_CLOEXEC);
+		if (fd < 0 || inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+			std::cerr << "Unable to watch " << dir.string() << std::endl;
+			return false;
+		}
+		alignas(struct inotify_event) char buffer[4096];
+		while (!serve_stopped) {
+			struct pollfd pfd = { fd, POLLIN, 0 };
+			if (poll(&pfd, 1, 500) <= 0) {
+				continue;
+			}
+			ssize_t length = read(fd, buffer, sizeof(buffer));
+			for (char* p = buffer; length > 0 && p < buffer + length; ) {
+				struct inotify_event* event = (struct inotify_event*)p;
+				if (event->len > 0) {
+					fs::path path = dir / event->name;
+					if (is_blf(path)) {
+						queue.add(path);
+					}
+				}
+				p += sizeof(struct inotify_event) + event->len;
+			}
+		}
+		close(fd);
+		return true;
+	}
+#else
+	/* Polls dir, a file is complete once its size did not change for one interval */
+	bool watch(const fs::path& dir, conversion_queue& queue) {
+		std::map<fs::path, std::uintmax_t> sizes;
+		std::set<fs::path> done;
+		while (!serve_stopped) {
+			std::this_thread::sleep_for(std::chrono::seconds(1));
+			std::error_code ec;
+			for (const auto& entry : fs::directory_iterator(dir, ec)) {
+				if (!entry.is_regular_file() || !is_blf(entry.path()) || done.count(entry.path())) {
+					continue;
+				}
+				std::uintmax_t size = entry.file_size(ec);
+				auto it = sizes.find(entry.path());
+				if (it != sizes.end() && it->second == size) {
+					queue.add(entry.path());
+					done.insert(entry.path());
+				}
+				sizes[entry.path()] = size;
+			}
+		}
+		return true;
+	}
+#endif
+
+#ifndef _WIN32
+	/// Parameters of one request on the socket
+	struct conversion_request {
+		std::string file;
+		std::string channel_map;
+		frame_filter filter;
+	};
+
+	/// Reads the flat JSON objects of the request protocol
+	class json_reader {
+	public:
+		explicit json_reader(const std::string& text) : p(text.c_str()), end(text.c_str() + text.size()) {}
+
+		bool consume(char c) {
+			skip_space();
+			if (p < end && *p == c) {
+				p++;
+				return true;
+			}
+			return false;
+		}
+
+		bool done() {
+			skip_space();
+			return p == end;
+		}
+
+		bool string(std::string& value) {
+			if (!consume('"')) {
+				return false;
+			}
+			value.clear();
+			while (p < end && *p != '"') {
+				char c = *p++;
+				if (c == '\\') {
+					if (p == end) {
+						return false;
+					}
+					c = *p++;
+					if (c == 'n') c = '\n';
+					else if (c == 't') c = '\t';
+					else if (c != '"' && c != '\\' && c != '/') return false;
+				}
+				value.push_back(c);
+			}
+			return consume('"');
+		}
+
+		bool number(std::uint64_t& value) {
+			skip_space();
+			char* last;
+			errno = 0;
+			value = std::strtoull(p, &last, 10);
+			if (last == p || errno != 0 || *p == '-') {
+				return false;
+			}
+			p = last;
+			return true;
+		}
+
+		template<class Item>
+		bool array(Item item) {
+			if (!consume('[')) {
+				return false;
+			}
+			if (consume(']')) {
+				return true;
+			}
+			do {
+				if (!item()) {
+					return false;
+				}
+			} while (consume(','));
+			return consume(']');
+		}
+
+	private:
+		void skip_space() {
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+				p++;
+			}
+		}
+
+		const char* p;
+		const char* end;
+	};
+
+	/* Parses {"file": ..., "start": ns, "end": ns, "types": [...], "channels": [...], "channel_map": ...} */
+	bool parse_request(const std::string& text, conversion_request& request, std::string& error) {
+		json_reader json(text);
+		if (!json.consume('{')) {
+			error = "Expected a JSON object";
+			return false;
+		}
+		if (!json.consume('}')) {
+			do {
+				std::string key;
+				if (!json.string(key) || !json.consume(':')) {
+					error = "Invalid JSON";
+					return false;
+				}
+				bool valid;
+				if (key == "file") {
+					valid = json.string(request.file);
+				}
+				else if (key == "channel_map") {
+					valid = json.string(request.channel_map);
+				}
+				else if (key == "start") {
+					valid = json.number(request.filter.start_ns);
+				}
+				else if (key == "end") {
+					valid = json.number(request.filter.end_ns);
+				}
+				else if (key == "types") {
+					valid = json.array([&]() {
+						std::string name;
+						std::uint16_t link_type;
+						if (!json.string(name) || !parse_link_type(name, link_type)) {
+							return false;
+						}
+						request.filter.link_types.insert(link_type);
+						return true;
+					});
+				}
+				else if (key == "channels") {
+					valid = json.array([&]() {
+						std::uint64_t channel;
+						if (!json.number(channel) || channel > UINT32_MAX) {
+							return false;
+						}
+						request.filter.channels.insert((std::uint32_t)channel);
+						return true;
+					});
+				}
+				else {
+					error = "Unknown key: " + key;
+					return false;
+				}
+				if (!valid) {
+					error = "Invalid value for " + key;
+					return false;
+				}
+			} while (json.consume(','));
+			if (!json.consume('}')) {
+				error = "Invalid JSON";
+				return false;
+			}
+		}
+		if (!json.done()) {
+			error = "Invalid JSON";
+			return false;
+		}
+		if (request.file.empty()) {
+			error = "Missing file";
+			return false;
+		}
+		return true;
+	}
+
+	/// A BLF file kept open between requests, with its metadata and container index
+	struct indexed_file {
+		/// Held for a whole request: the converter reads from one position at a time, so
+		/// requests on the same file are served one after the other, other files in parallel
+		std::mutex mutex;
+		Converter converter;
+		std::vector<container_index_entry> index;
+		fs::file_time_type time;
+		std::uintmax_t size = 0;
+	};
+
+	/// Least recently used files stay open, a file is opened again when it changed
+	class file_cache {
+	public:
+		explicit file_cache(std::size_t capacity) : capacity(std::max<std::size_t>(capacity, 1)) {}
+
+		std::shared_ptr<indexed_file> get(const std::string& path) {
+			std::error_code ec;
+			fs::file_time_type time = fs::last_write_time(path, ec);
+			std::uintmax_t size = fs::file_size(path, ec);
+			if (ec) {
+				return nullptr;
+			}
+
+			std::unique_lock<std::mutex> lock(mutex);
+			for (auto it = files.begin(); it != files.end(); ++it) {
+				if (it->first == path) {
+					std::shared_ptr<indexed_file> file = it->second;
+					files.erase(it);
+					if (file->time == time && file->size == size) {
+						files.emplace_front(path, file);
+						return file;
+					}
+					break;
+				}
+			}
+			lock.unlock();
+
+			/* indexing reads the whole file, other requests continue meanwhile */
+			auto file = std::make_shared<indexed_file>();
+			if (!file->converter.open(path)) {
+				return nullptr;
+			}
+			FrameBuffer ignored;
+			if (!file->converter.prescan(ignored) || !file->converter.index(file->index)) {
+				return nullptr;
+			}
+			file->time = time;
+			file->size = size;
+
+			lock.lock();
+			files.emplace_front(path, file);
+			if (files.size() > capacity) {
+				// Requests still holding the file keep it open until they complete
+				files.pop_back();
+			}
+			return file;
+		}
+
+	private:
+		std::size_t capacity;
+		std::mutex mutex;
+		std::list<std::pair<std::string, std::shared_ptr<indexed_file>>> files;
+	};
+
+	/// Shared by all connections of the socket server
+	struct server_state {
+		file_cache files;
+		std::mutex mutex;
+		std::map<std::string, std::unique_ptr<mapping_cache>> mappings;
+
+		mapping_cache& mappings_for(const std::string& path) {
+			std::lock_guard<std::mutex> lock(mutex);
+			auto& cache = mappings[path];
+			if (!cache) {
+				cache = std::make_unique<mapping_cache>(path);
+			}
+			return *cache;
+		}
+	};
+
+	bool write_all(int fd, const char* data, std::size_t size) {
+		while (size > 0) {
+			ssize_t written = write(fd, data, size);
+			if (written < 0 && errno == EINTR) {
+				continue;
+			}
+			if (written <= 0) {
+				return false;
+			}
+			data += written;
+			size -= written;
+		}
+		return true;
+	}
+
+	void send_error(int client, const std::string& error) {
+		std::string response = "{\"error\": \"";
+		for (char c : error) {
+			if (c == '"' || c == '\\') {
+				response.push_back('\\');
+			}
+			response.push_back(c);
+		}
+		response += "\"}\n";
+		write_all(client, response.data(), response.size());
+	}
+
+	/* Converts the requested part of the file into the pipe, a relay thread copies it to the client.
+	   The file stays locked until the conversion ends, a slow client delays later requests on it. */
+	void stream_pcapng(int client, indexed_file& file, const conversion_request& request, mapping_cache& mappings) {
+		int pipe_fds[2];
+		if (pipe(pipe_fds) != 0) {
+			send_error(client, "Unable to create a pipe");
+			return;
+		}
+		std::thread relay([&]() {
+			char buffer[65536];
+			bool connected = true;
+			ssize_t length;
+			while ((length = read(pipe_fds[0], buffer, sizeof(buffer))) != 0) {
+				if (length < 0) {
+					if (errno == EINTR) {
+						continue;
+					}
+					break;
+				}
+				// Keep draining after a disconnect, so the writer is never blocked
+				connected = connected && write_all(client, buffer, length);
+			}
+			close(pipe_fds[0]);
+		});
+
+		std::string output = "/dev/fd/" + std::to_string(pipe_fds[1]);
+		{
+			PcapngSink pcapng(output, mappings.get(output));
+			FilterSink sink(request.filter, pcapng);
+
+			/* containers before the first one with objects in the window are skipped,
+			   reading ends at the first container with only later objects after it */
+			const auto& index = file.index;
+			auto begin = std::find_if(index.begin(), index.end(), [&](const container_index_entry& entry) {
+				return entry.max_ns >= request.filter.start_ns;
+			});
+			auto end = std::find_if(begin, index.end(), [&](const container_index_entry& entry) {
+				return entry.min_ns > request.filter.end_ns;
+			});
+			if (begin != end) {
+				std::lock_guard<std::mutex> lock(file.mutex);
+				file.converter.seek(*begin, sink);
+				file.converter.stop_at(end != index.end() ? end->offset : -1);
+				file.converter.run(sink);
+				file.converter.stop_at(-1);
+			}
+			sink.flush();
+		}
+		close(pipe_fds[1]);
+		relay.join();
+	}
+
+	void handle_client(int client, server_state& state) {
+		/* one request per connection, anything after its newline is ignored */
+		std::string line;
+		char buffer[4096];
+		std::size_t end;
+		while ((end = line.find('\n')) == std::string::npos && line.size() < 65536) {
+			ssize_t length = read(client, buffer, sizeof(buffer));
+			if (length <= 0) {
+				break;
+			}
+			line.append(buffer, length);
+		}
+		if (end != std::string::npos) {
+			line.resize(end);
+		}
+
+		conversion_request request;
+		std::string error;
+		if (!parse_request(line, request, error)) {
+			send_error(client, error);
+			return;
+		}
+		std::shared_ptr<indexed_file> file = state.files.get(request.file);
+		if (!file) {
+			send_error(client, "Unable to open: " + request.file);
+			return;
+		}
+		stream_pcapng(client, *file, request, state.mappings_for(request.channel_map));
+	}
+
+	/* Accepts connections until stopped, each handled on the pool */
+	bool listen_socket(const std::string& path, task_pool& pool, server_state& state) {
+		struct sockaddr_un addr {};
+		addr.sun_family = AF_UNIX;
+		if (path.size() >= sizeof(addr.sun_path)) {
+			std::cerr << "Socket path too long: " << path << std::endl;
+			return false;
+		}
+		strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		unlink(path.c_str());
+		if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+			std::cerr << "Unable to listen on " << path << std::endl;
+			return false;
+		}
+		while (!serve_stopped) {
+			struct pollfd pfd = { fd, POLLIN, 0 };
+			if (poll(&pfd, 1, 500) <= 0) {
+				continue;
+			}
+			int client = accept(fd, nullptr, nullptr);
+			if (client < 0) {
+				continue;
+			}
+			// Closed after the request, or when the pool drops it unhandled on shutdown
+			std::shared_ptr<int> connection(new int(client), [](int* fd) {
+				close(*fd);
+				delete fd;
+			});
+			pool.add([connection, &state]() {
+				handle_client(*connection, state);
+			});
+		}
+		close(fd);
+		unlink(path.c_str());
+		return true;
+	}
+#endif
+
+	int serve_main(int argc, char* argv[]) {
+		args::ArgumentParser parser("Converts BLF files written to a directory, or parts of BLF files requested on a socket, until interrupted.",
+			"Socket requests are a JSON object on one line: {\"file\": path, \"start\": ns, \"end\": ns, \"types\": [\"can\", \"lin\", \"flexray\", \"ethernet\"], "
+			"\"channels\": [interface ids], \"channel_map\": path}, all but file optional, times in ns since the epoch. "
+			"The response is a pcapng stream, or a JSON object with an error. "
+			"Requests on the same file are answered one at a time, requests on different files in parallel.");
+		parser.Prog("blf_converter serve");
+		parser.helpParams.showTerminator = false;
+		parser.helpParams.proglineShowFlags = true;
+
+		args::HelpFlag help(parser, "help", "", { 'h', "help" }, args::Options::HiddenFromUsage);
+		args::ValueFlag<std::string> watcharg(parser, "dir", "Directory to watch for BLF files", { "watch" });
+		args::ValueFlag<std::string> socketarg(parser, "path", "Unix domain socket to accept conversion requests on", { "socket" });
+		args::ValueFlag<std::string> outputarg(parser, "dir", "Directory for the pcapng files, the watched directory by default", { "output" });
+		args::ValueFlag<std::string> maparg(parser, "map-file", "Configuration file for channel mapping, reloaded when changed", { "channel-map" });
+		args::ValueFlag<unsigned> jobsarg(parser, "jobs", "Files converted at the same time", { "jobs" }, std::max(1u, std::thread::hardware_concurrency()));
+		args::ValueFlag<unsigned> cachearg(parser, "files", "BLF files kept open and indexed between socket requests", { "cache" }, 8);
+		args::Flag existingarg(parser, "existing", "Also convert BLF files already in the directory without a pcapng file", { "existing" });
+
+		try
+		{
+			parser.ParseCLI(argc, argv);
+		}
+		catch (args::Help)
+		{
+			std::cout << parser;
+			return 0;
+		}
+		catch (args::Error e)
+		{
+			std::cerr << e.what() << std::endl;
+			std::cerr << parser;
+			return 1;
+		}
+		if (!watcharg == !socketarg) {
+			std::cerr << "Exactly one of --watch and --socket is required" << std::endl;
+			std::cerr << parser;
+			return 1;
+		}
+
+		std::signal(SIGINT, on_serve_signal);
+		std::signal(SIGTERM, on_serve_signal);
+		task_pool pool(std::max(1u, args::get(jobsarg)));
+
+		if (socketarg) {
+#ifndef _WIN32
+			// Clients disconnecting must not end the server
+			std::signal(SIGPIPE, SIG_IGN);
+			server_state state { file_cache(args::get(cachearg)) };
+			bool ok = listen_socket(args::get(socketarg), pool, state);
+			// The tasks use state
+			pool.stop();
+			return ok ? 0 : 1;
+#else
+			std::cerr << "--socket is not supported on this platform" << std::endl;
+			return 1;
+#endif
+		}
+
+		fs::path dir = args::get(watcharg);
+		fs::path output = outputarg ? fs::path(args::get(outputarg)) : dir;
+		if (!fs::is_directory(dir) || !fs::is_directory(output)) {
+			std::cerr << "Not a directory: " << (fs::is_directory(dir) ? output : dir).string() << std::endl;
+			return 1;
+		}
+
+		mapping_cache mappings(maparg.Get());
+		conversion_queue queue(pool, output, mappings);
+		if (existingarg) {
+			std::error_code ec;
+			for (const auto& entry : fs::directory_iterator(dir, ec)) {
+				fs::path outfile = output / fs::path(entry.path().filename()).replace_extension(".pcapng");
+				if (entry.is_regular_file() && is_blf(entry.path()) && !fs::exists(outfile)) {
+					queue.add(entry.path());
+				}
+			}
+		}
+		bool ok = watch(dir, queue);
+		// The tasks use queue
+		pool.stop();
+		return ok ? 0 : 1;
+	}
+
+}
@@ -0,0 +1,15 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+#ifndef _APP_SERVE_H
+#define _APP_SERVE_H
+
+namespace blf_converter {
+
+	/// "serve" command: converts BLF files as they appear in a watched directory
+	int serve_main(int argc, char* argv[]);
+
+}
+
+#endif
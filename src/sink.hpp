@@ -0,0 +1,76 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+#ifndef _APP_SINK_H
+#define _APP_SINK_H
+
+#include <cstdint>
+#include <ctime>
+#include <functional>
+
+#include <pcapng_exporter/lin.h>
+#include <pcapng_exporter/pcapng_exporter.hpp>
+
+namespace blf_converter {
+
+	/// A converted frame, as handed to a FrameSink
+	struct Frame {
+		/// LINKTYPE_* of the frame bytes
+		std::uint16_t link_type;
+		/// Interface id, 100000 * hardware channel + BLF channel
+		std::uint32_t channel_id;
+		/// Direction (1 = in, 2 = out), 0 if unknown
+		std::uint32_t flags;
+		/// Absolute timestamp
+		struct timespec timestamp;
+		/// Resolution of the source object timestamp, in ticks per second
+		std::uint64_t timestamp_resolution;
+		/// Frame bytes, only valid for the duration of the write_frame call
+		const std::uint8_t* data;
+		/// Bytes in data, less than original_length if the frame was truncated
+		std::uint32_t length;
+		/// Length of the frame on the bus, 0 if equal to length
+		std::uint32_t original_length;
+		/// Decoded LIN frame, only set for LINKTYPE_LIN
+		const lin_frame* lin;
+	};
+
+	/// Why a frame was not written
+	enum class Discard {
+		/// Left out by a filter or trigger window
+		Filtered,
+		/// Duplicate of a frame already written
+		Dropped
+	};
+
+	/// Receives the frames produced by a Converter
+	class FrameSink {
+	public:
+		virtual ~FrameSink() = default;
+		virtual void write_frame(const Frame& frame) = 0;
+		/// Called instead of write_frame for count frames of the channel of frame left out before
+		/// the output, for its interface statistics. data and lin may be nullptr.
+		virtual void discard_frame(const Frame& frame, Discard reason, std::uint64_t count) {}
+		/// Called for every channel mapping found in the BLF metadata
+		virtual void add_mapping(const pcapng_exporter::channel_mapping& mapping) {}
+		/// Pushes buffered frames to their destination
+		virtual void flush() {}
+	};
+
+	/// Forwards every frame to a user callback
+	class CallbackSink : public FrameSink {
+	public:
+		explicit CallbackSink(std::function<void(const Frame&)> callback)
+			: callback(std::move(callback)) {}
+
+		void write_frame(const Frame& frame) override {
+			callback(frame);
+		}
+	private:
+		std::function<void(const Frame&)> callback;
+	};
+
+}
+
+#endif
@@ -0,0 +1,132 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+
+#include <algorithm>
+#include <vector>
+
+#include "summary.hpp"
+
+#define NANOS_PER_SEC 1000000000
+
+namespace blf_converter {
+
+	const char* bus_name(Bus bus) {
+		switch (bus) {
+		case Bus::CAN: return "CAN";
+		case Bus::LIN: return "LIN";
+		case Bus::FlexRay: return "FlexRay";
+		case Bus::Ethernet: return "Ethernet";
+		}
+		return "";
+	}
+
+	channel_stats& Summary::channel(Bus bus, std::uint32_t channel, std::uint64_t timestamp_ns) {
+		// Consecutive objects are very often on the same channel
+		std::pair<Bus, std::uint32_t> key(bus, channel);
+		if (last_channel == nullptr || key != last_key) {
+			last_key = key;
+			last_channel = &channels[key];
+		}
+		last_channel->first_ns = std::min(last_channel->first_ns, timestamp_ns);
+		last_channel->last_ns = std::max(last_channel->last_ns, timestamp_ns);
+		return *last_channel;
+	}
+
+	void Summary::add_message(Bus bus, std::uint32_t channel_id, std::uint32_t id, std::uint64_t timestamp_ns) {
+		channel_stats& stats = channel(bus, channel_id, timestamp_ns);
+		stats.messages++;
+		id_stats& ids = stats.ids[id];
+		if (ids.count == 0) {
+			ids.first_ns = timestamp_ns;
+			ids.last_ns = timestamp_ns;
+		}
+		else {
+			std::uint64_t interval = timestamp_ns >= ids.previous_ns ? timestamp_ns - ids.previous_ns : ids.previous_ns - timestamp_ns;
+			ids.min_interval_ns = std::min(ids.min_interval_ns, interval);
+			ids.max_interval_ns = std::max(ids.max_interval_ns, interval);
+			ids.first_ns = std::min(ids.first_ns, timestamp_ns);
+			ids.last_ns = std::max(ids.last_ns, timestamp_ns);
+		}
+		ids.previous_ns = timestamp_ns;
+		ids.count++;
+	}
+
+	void Summary::add_error(Bus bus, std::uint32_t channel_id, std::uint64_t timestamp_ns) {
+		channel(bus, channel_id, timestamp_ns).errors++;
+	}
+
+	void Summary::add_object() {
+		objects++;
+	}
+
+	double seconds(std::uint64_t ns) {
+		return (double)ns / NANOS_PER_SEC;
+	}
+
+	void Summary::write_json(std::ostream& os) const {
+		std::uint64_t first_ns = UINT64_MAX;
+		std::uint64_t last_ns = 0;
+		std::uint64_t messages = 0;
+		std::uint64_t errors = 0;
+		for (const auto& channel : channels) {
+			first_ns = std::min(first_ns, channel.second.first_ns);
+			last_ns = std::max(last_ns, channel.second.last_ns);
+			messages += channel.second.messages;
+			errors += channel.second.errors;
+		}
+		if (channels.empty()) {
+			first_ns = 0;
+		}
+
+		os << "{\n";
+		os << "  \"measurement_start_ns\": " << measurement_start_ns << ",\n";
+		os << "  \"first_ns\": " << first_ns << ",\n";
+		os << "  \"last_ns\": " << last_ns << ",\n";
+		os << "  \"duration_s\": " << seconds(last_ns - first_ns) << ",\n";
+		os << "  \"objects\": " << objects << ",\n";
+		os << "  \"messages\": " << messages << ",\n";
+		os << "  \"errors\": " << errors << ",\n";
+		os << "  \"channels\": [";
+		bool first_channel = true;
+		for (const auto& channel : channels) {
+			const channel_stats& stats = channel.second;
+			os << (first_channel ? "\n" : ",\n");
+			first_channel = false;
+			os << "    {\n";
+			os << "      \"bus\": \"" << bus_name(channel.first.first) << "\",\n";
+			os << "      \"channel\": " << channel.first.second << ",\n";
+			os << "      \"messages\": " << stats.messages << ",\n";
+			os << "      \"errors\": " << stats.errors << ",\n";
+			os << "      \"first_ns\": " << stats.first_ns << ",\n";
+			os << "      \"last_ns\": " << stats.last_ns << ",\n";
+			os << "      \"ids\": [";
+
+			// Sorted output, the map is unordered for speed
+			std::vector<std::pair<std::uint32_t, id_stats>> ids(stats.ids.begin(), stats.ids.end());
+			std::sort(ids.begin(), ids.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+			bool first_id = true;
+			for (const auto& id : ids) {
+				const id_stats& s = id.second;
+				double span = seconds(s.last_ns - s.first_ns);
+				os << (first_id ? "\n" : ",\n");
+				first_id = false;
+				os << "        { \"id\": " << (id.first & ~(std::uint32_t)CAN_ID_EXTENDED);
+				if (channel.first.first == Bus::CAN) {
+					os << ", \"extended\": " << ((id.first & CAN_ID_EXTENDED) != 0 ? "true" : "false");
+				}
+				os << ", \"count\": " << s.count
+					<< ", \"rate_hz\": " << (s.count > 1 && span > 0 ? (s.count - 1) / span : 0)
+					<< ", \"min_interval_ns\": " << (s.count > 1 ? s.min_interval_ns : 0)
+					<< ", \"max_interval_ns\": " << s.max_interval_ns
+					<< " }";
+			}
+			os << (first_id ? "]\n" : "\n      ]\n");
+			os << "    }";
+		}
+		os << (first_channel ? "]\n" : "\n  ]\n");
+		os << "}\n";
+	}
+
+}
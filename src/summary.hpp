@@ -0,0 +1,74 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+#ifndef _APP_SUMMARY_H
+#define _APP_SUMMARY_H
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+
+/// Bit of CAN ids for extended (29 bit) frames, as in BLF and SocketCAN
+#define CAN_ID_EXTENDED 0x80000000
+
+namespace blf_converter {
+
+	enum class Bus : std::uint8_t {
+		CAN,
+		LIN,
+		FlexRay,
+		Ethernet
+	};
+
+	/// Name of the bus in JSON output
+	const char* bus_name(Bus bus);
+
+	struct id_stats {
+		std::uint64_t count = 0;
+		/// Earliest and latest timestamp, also when timestamps decrease
+		std::uint64_t first_ns = 0;
+		std::uint64_t last_ns = 0;
+		/// Timestamp of the previous message, for the intervals
+		std::uint64_t previous_ns = 0;
+		std::uint64_t min_interval_ns = UINT64_MAX;
+		std::uint64_t max_interval_ns = 0;
+	};
+
+	struct channel_stats {
+		std::uint64_t messages = 0;
+		std::uint64_t errors = 0;
+		std::uint64_t first_ns = UINT64_MAX;
+		std::uint64_t last_ns = 0;
+		std::unordered_map<std::uint32_t, id_stats> ids;
+	};
+
+	/// Per channel and per id statistics of a trace, without building any frame
+	class Summary {
+	public:
+		/// Absolute time of the measurement start, timestamps are relative to it
+		std::uint64_t measurement_start_ns = 0;
+
+		/// Counts one message, timestamp relative to the measurement start. CAN ids keep
+		/// CAN_ID_EXTENDED, so standard and extended frames with the same id count apart.
+		void add_message(Bus bus, std::uint32_t channel, std::uint32_t id, std::uint64_t timestamp_ns);
+		void add_error(Bus bus, std::uint32_t channel, std::uint64_t timestamp_ns);
+		/// Counts any object read from the file
+		void add_object();
+
+		void write_json(std::ostream& os) const;
+
+	private:
+		channel_stats& channel(Bus bus, std::uint32_t channel, std::uint64_t timestamp_ns);
+
+		std::uint64_t objects = 0;
+		std::map<std::pair<Bus, std::uint32_t>, channel_stats> channels;
+		std::pair<Bus, std::uint32_t> last_key { Bus::CAN, UINT32_MAX };
+		channel_stats* last_channel = nullptr;
+	};
+
+}
+
+#endif
@@ -0,0 +1,162 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+
+#include "trigger_sink.hpp"
+
+#define NANOS_PER_SEC 1000000000
+
+using Vector::BLF::ObjectType;
+
+namespace blf_converter {
+
+	bool parse_trigger_types(const std::string& text, std::set<ObjectType>& types) {
+		static const std::map<std::string, ObjectType> names = {
+			{ "CanErrorFrame", ObjectType::CAN_ERROR },
+			{ "CanErrorFrameExt", ObjectType::CAN_ERROR_EXT },
+			{ "CanFdErrorFrame64", ObjectType::CAN_FD_ERROR_64 },
+			{ "FlexRayVFrError", ObjectType::FR_ERROR },
+			{ "LinCrcError", ObjectType::LIN_CRC_ERROR },
+			{ "LinCrcError2", ObjectType::LIN_CRC_ERROR2 },
+			{ "LinReceiveError", ObjectType::LIN_RCV_ERROR },
+			{ "LinReceiveError2", ObjectType::LIN_RCV_ERROR2 },
+			{ "LinSendError", ObjectType::LIN_SND_ERROR },
+			{ "LinSendError2", ObjectType::LIN_SND_ERROR2 },
+			{ "LinSyncError", ObjectType::LIN_SYN_ERROR },
+			{ "LinSyncError2", ObjectType::LIN_SYN_ERROR2 },
+		};
+		std::stringstream ss(text);
+		std::string name;
+		while (std::getline(ss, name, ',')) {
+			auto it = names.find(name);
+			if (it == names.end()) {
+				return false;
+			}
+			types.insert(it->second);
+		}
+		return !types.empty();
+	}
+
+	bool parse_duration(const std::string& text, std::uint64_t& ns) {
+		std::size_t end;
+		double value;
+		try {
+			value = std::stod(text, &end);
+		}
+		catch (std::exception&) {
+			return false;
+		}
+		std::string unit = text.substr(end);
+		double scale;
+		if (unit == "ns") scale = 1;
+		else if (unit == "us") scale = 1e3;
+		else if (unit == "ms" || unit.empty()) scale = 1e6;
+		else if (unit == "s") scale = NANOS_PER_SEC;
+		else return false;
+		if (value < 0) {
+			return false;
+		}
+		ns = (std::uint64_t)(value * scale);
+		return true;
+	}
+
+	TriggerSink::~TriggerSink() {
+		// Frames still held were not followed by a trigger
+		for (std::size_t i = first; i < held.size(); i++) {
+			discard(held[i]);
+		}
+	}
+
+	void TriggerSink::trigger(std::uint64_t ns) {
+		std::lock_guard<std::mutex> lock(mutex);
+		std::uint64_t start = ns > pre_ns ? ns - pre_ns : 0;
+		for (std::size_t i = first; i < held.size(); i++) {
+			if (held[i].ns < start) {
+				discard(held[i]);
+				continue;
+			}
+			Frame frame = held[i].frame;
+			frame.data = bytes.data() + held[i].offset;
+			if (frame.lin != nullptr) {
+				frame.lin = &held[i].lin;
+			}
+			sink->write_frame(frame);
+		}
+		held.clear();
+		bytes.clear();
+		first = 0;
+		if (triggered && start <= open_until) {
+			// Overlapping windows are merged
+			open_until = std::max(open_until, ns + post_ns);
+		}
+		else {
+			open_from = start;
+			open_until = ns + post_ns;
+		}
+		triggered = true;
+	}
+
+	void TriggerSink::write_frame(const Frame& frame) {
+		std::uint64_t ns = (std::uint64_t)frame.timestamp.tv_sec * NANOS_PER_SEC + frame.timestamp.tv_nsec;
+		std::lock_guard<std::mutex> lock(mutex);
+		if (triggered && ns >= open_from && ns <= open_until) {
+			sink->write_frame(frame);
+			return;
+		}
+		expire(ns);
+		held_frame entry;
+		entry.frame = frame;
+		entry.ns = ns;
+		entry.offset = bytes.size();
+		if (frame.lin != nullptr) {
+			entry.lin = *frame.lin;
+		}
+		bytes.insert(bytes.end(), frame.data, frame.data + frame.length);
+		held.push_back(entry);
+	}
+
+	void TriggerSink::discard(const held_frame& entry) {
+		Frame frame = entry.frame;
+		frame.data = nullptr;
+		frame.lin = nullptr;
+		sink->discard_frame(frame, Discard::Filtered, 1);
+	}
+
+	void TriggerSink::expire(std::uint64_t ns) {
+		while (first < held.size() && held[first].ns + pre_ns < ns) {
+			discard(held[first]);
+			first++;
+		}
+		/* compact once most of the storage is expired, the cost is spread over the expired frames */
+		if (first >= 1024 && first * 2 >= held.size()) {
+			std::size_t offset = first < held.size() ? held[first].offset : bytes.size();
+			held.erase(held.begin(), held.begin() + first);
+			bytes.erase(bytes.begin(), bytes.begin() + offset);
+			for (auto& entry : held) {
+				entry.offset -= offset;
+			}
+			first = 0;
+		}
+	}
+
+	void TriggerSink::discard_frame(const Frame& frame, Discard reason, std::uint64_t count) {
+		std::lock_guard<std::mutex> lock(mutex);
+		sink->discard_frame(frame, reason, count);
+	}
+
+	void TriggerSink::add_mapping(const pcapng_exporter::channel_mapping& mapping) {
+		std::lock_guard<std::mutex> lock(mutex);
+		sink->add_mapping(mapping);
+	}
+
+	void TriggerSink::flush() {
+		std::lock_guard<std::mutex> lock(mutex);
+		sink->flush();
+	}
+
+}
@@ -0,0 +1,74 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+#ifndef _APP_TRIGGER_SINK_H
+#define _APP_TRIGGER_SINK_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <Vector/BLF.h>
+
+#include "sink.hpp"
+
+namespace blf_converter {
+
+	/// Parses a comma separated list of BLF object names, e.g. CanErrorFrame,LinCrcError
+	bool parse_trigger_types(const std::string& text, std::set<Vector::BLF::ObjectType>& types);
+	/// Parses a duration like 500ms, 2s, 100us or 10ns, plain numbers are ms
+	bool parse_duration(const std::string& text, std::uint64_t& ns);
+
+	/// Only passes the frames within pre before and post after a trigger.
+	/// Frames are held back for pre, overlapping windows are merged.
+	/// Frames outside of all windows are discarded as filtered.
+	class TriggerSink : public FrameSink {
+	public:
+		TriggerSink(std::unique_ptr<FrameSink> sink, std::uint64_t pre_ns, std::uint64_t post_ns)
+			: sink(std::move(sink)), pre_ns(pre_ns), post_ns(post_ns) {}
+		~TriggerSink();
+
+		/// Opens a window around the absolute time ns, held back frames in it are written
+		void trigger(std::uint64_t ns);
+
+		void write_frame(const Frame& frame) override;
+		void discard_frame(const Frame& frame, Discard reason, std::uint64_t count) override;
+		/// Mappings are always passed on
+		void add_mapping(const pcapng_exporter::channel_mapping& mapping) override;
+		void flush() override;
+
+	private:
+		struct held_frame {
+			Frame frame;
+			std::uint64_t ns;
+			std::size_t offset;
+			lin_frame lin;
+		};
+
+		/// Drops the held frames older than pre before ns
+		void expire(std::uint64_t ns);
+		void discard(const held_frame& entry);
+
+		std::unique_ptr<FrameSink> sink;
+		std::uint64_t pre_ns;
+		std::uint64_t post_ns;
+		/// Frames in the current window are passed on directly
+		std::uint64_t open_from = 0;
+		std::uint64_t open_until = 0;
+		bool triggered = false;
+
+		/// Held frames start at first, the ones before are expired
+		std::vector<held_frame> held;
+		std::vector<std::uint8_t> bytes;
+		std::size_t first = 0;
+		/// Triggers are reported by the reading thread, frames can come from an encoding thread
+		std::mutex mutex;
+	};
+
+}
+
+#endif
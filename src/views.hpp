@@ -0,0 +1,153 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+#ifndef _APP_VIEWS_H
+#define _APP_VIEWS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#include <Vector/BLF.h>
+
+#include "blf_reader.hpp"
+
+namespace blf_converter {
+
+	/// Non owning byte range, usable like the std::vector members of Vector::BLF objects
+	struct byte_view {
+		const std::uint8_t* ptr = nullptr;
+		std::size_t length = 0;
+
+		const std::uint8_t* data() const { return ptr; }
+		std::size_t size() const { return length; }
+		const std::uint8_t* begin() const { return ptr; }
+		const std::uint8_t* end() const { return ptr + length; }
+	};
+
+	/// Object header fields, read in place. Views are only valid as long as their ObjectRef.
+	struct ObjectView {
+		Vector::BLF::ObjectType objectType;
+		Vector::BLF::DWORD objectSize;
+		Vector::BLF::DWORD objectFlags;
+		Vector::BLF::ULONGLONG objectTimeStamp;
+
+		explicit ObjectView(const ObjectRef& object, std::uint32_t minBodySize) {
+			Vector::BLF::WORD headerSize = read_le<Vector::BLF::WORD>(object.data + 4);
+			if (headerSize < 32 || object.size < headerSize + minBodySize) {
+				throw std::runtime_error("Object too small");
+			}
+			objectType = object.type;
+			objectSize = object.size;
+			// Same offsets for ObjectHeader and ObjectHeader2
+			objectFlags = read_le<Vector::BLF::DWORD>(object.data + 16);
+			objectTimeStamp = read_le<Vector::BLF::ULONGLONG>(object.data + 24);
+			body = object.data + headerSize;
+			bodySize = object.size - headerSize;
+		}
+
+	protected:
+		const std::uint8_t* body;
+		std::uint32_t bodySize;
+	};
+
+	/// CAN_MESSAGE = 1, CAN_MESSAGE2 = 86
+	struct CanMessageView : ObjectView {
+		Vector::BLF::WORD channel;
+		Vector::BLF::BYTE flags;
+		Vector::BLF::BYTE dlc;
+		Vector::BLF::DWORD id;
+		byte_view data;
+
+		explicit CanMessageView(const ObjectRef& object) : ObjectView(object, 16) {
+			channel = read_le<Vector::BLF::WORD>(body);
+			flags = body[2];
+			dlc = body[3];
+			id = read_le<Vector::BLF::DWORD>(body + 4);
+			data.ptr = body + 8;
+			// CanMessage2 has 8 more bytes of trailing fields
+			data.length = object.type == Vector::BLF::ObjectType::CAN_MESSAGE2
+				? std::min<std::uint32_t>(bodySize - 16, 8) : 8;
+		}
+	};
+
+	/// CAN_FD_MESSAGE = 100
+	struct CanFdMessageView : ObjectView {
+		Vector::BLF::WORD channel;
+		Vector::BLF::BYTE flags;
+		Vector::BLF::BYTE dlc;
+		Vector::BLF::DWORD id;
+		Vector::BLF::BYTE canFdFlags;
+		Vector::BLF::BYTE validDataBytes;
+		byte_view data;
+
+		explicit CanFdMessageView(const ObjectRef& object) : ObjectView(object, 84) {
+			channel = read_le<Vector::BLF::WORD>(body);
+			flags = body[2];
+			dlc = body[3];
+			id = read_le<Vector::BLF::DWORD>(body + 4);
+			canFdFlags = body[13];
+			validDataBytes = body[14];
+			data.ptr = body + 20;
+			data.length = 64;
+		}
+	};
+
+	/// CAN_FD_MESSAGE_64 = 101
+	struct CanFdMessage64View : ObjectView {
+		Vector::BLF::BYTE channel;
+		Vector::BLF::BYTE dlc;
+		Vector::BLF::BYTE validDataBytes;
+		Vector::BLF::DWORD id;
+		Vector::BLF::DWORD flags;
+		Vector::BLF::DWORD crc;
+		byte_view data;
+
+		explicit CanFdMessage64View(const ObjectRef& object) : ObjectView(object, 40) {
+			channel = body[0];
+			dlc = body[1];
+			validDataBytes = body[2];
+			id = read_le<Vector::BLF::DWORD>(body + 4);
+			flags = read_le<Vector::BLF::DWORD>(body + 12);
+			crc = read_le<Vector::BLF::DWORD>(body + 36);
+			data.ptr = body + 40;
+			data.length = std::min<std::uint32_t>({ validDataBytes, 64, bodySize - 40 });
+		}
+	};
+
+	/// ETHERNET_FRAME_EX = 120, ETHERNET_FRAME_FORWARDED = 121
+	struct EthernetFrameExView : ObjectView {
+		Vector::BLF::WORD flags;
+		Vector::BLF::WORD channel;
+		Vector::BLF::WORD hardwareChannel;
+		Vector::BLF::DWORD frameChecksum;
+		Vector::BLF::WORD dir;
+		byte_view frameData;
+
+		explicit EthernetFrameExView(const ObjectRef& object) : ObjectView(object, 32) {
+			flags = read_le<Vector::BLF::WORD>(body + 2);
+			channel = read_le<Vector::BLF::WORD>(body + 4);
+			hardwareChannel = read_le<Vector::BLF::WORD>(body + 6);
+			frameChecksum = read_le<Vector::BLF::DWORD>(body + 16);
+			dir = read_le<Vector::BLF::WORD>(body + 20);
+			frameData.ptr = body + 32;
+			frameData.length = std::min<std::uint32_t>(read_le<Vector::BLF::WORD>(body + 22), bodySize - 32);
+		}
+	};
+
+	/// Channel and message id of objects that are otherwise materialized, e.g. LIN and FlexRay messages
+	struct MessageIdView : ObjectView {
+		Vector::BLF::WORD channel;
+		Vector::BLF::WORD id;
+
+		MessageIdView(const ObjectRef& object, std::uint32_t channelOffset, std::uint32_t idOffset, std::uint32_t idSize)
+			: ObjectView(object, idOffset + idSize) {
+			channel = read_le<Vector::BLF::WORD>(body + channelOffset);
+			id = idSize == 1 ? body[idOffset] : read_le<Vector::BLF::WORD>(body + idOffset);
+		}
+	};
+
+}
+
+#endif
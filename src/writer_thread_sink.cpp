@@ -0,0 +1,152 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+
+#include <iostream>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "writer_thread_sink.hpp"
+#include "placement.hpp"
+
+namespace blf_converter {
+
+	WriterThreadSink::WriterThreadSink(std::unique_ptr<FrameSink> sink, MemoryBudget* budget, std::size_t buffer_size)
+		: sink(std::move(sink)), budget(budget), buffer_size(buffer_size) {
+		if (budget != nullptr) {
+			while (this->buffer_size > (64 << 10) && !budget->try_acquire(2 * this->buffer_size)) {
+				this->buffer_size /= 2;
+			}
+			if (this->buffer_size <= (64 << 10)) {
+				budget->update(0, 2 * this->buffer_size);
+			}
+		}
+		filling.reserve(this->buffer_size);
+		writing.reserve(this->buffer_size);
+		writer = std::thread(&WriterThreadSink::run, this);
+	}
+
+	WriterThreadSink::~WriterThreadSink() {
+		flush();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		changed.notify_all();
+		writer.join();
+		// Closes the output
+		sink.reset();
+		if (!preallocate_path.empty()) {
+			release_preallocation(preallocate_path);
+		}
+		if (budget != nullptr) {
+			budget->release(2 * buffer_size);
+		}
+	}
+
+	void WriterThreadSink::preallocate(const std::string& path, std::uint64_t size) {
+		std::lock_guard<std::mutex> lock(mutex);
+		preallocate_path = path;
+		preallocate_size = size;
+	}
+
+	void WriterThreadSink::write_frame(const Frame& frame) {
+		// The buffers stay within their reservation, except for a single large frame
+		if (!filling.fits(frame) && !filling.empty()) {
+			submit();
+		}
+		filling.write_frame(frame);
+	}
+
+	void WriterThreadSink::discard_frame(const Frame& frame, Discard reason, std::uint64_t count) {
+		filling.discard_frame(frame, reason, count);
+	}
+
+	void WriterThreadSink::add_mapping(const pcapng_exporter::channel_mapping& mapping) {
+		filling.add_mapping(mapping);
+	}
+
+	void WriterThreadSink::flush() {
+		wait_idle();
+		sink->flush();
+	}
+
+	void WriterThreadSink::submit() {
+		std::unique_lock<std::mutex> lock(mutex);
+		// Only waits if the writer is still busy with the previous buffer
+		changed.wait(lock, [&]() { return !pending; });
+		std::swap(filling, writing);
+		pending = true;
+		lock.unlock();
+		changed.notify_all();
+	}
+
+	void WriterThreadSink::wait_idle() {
+		if (!filling.empty()) {
+			submit();
+		}
+		std::unique_lock<std::mutex> lock(mutex);
+		changed.wait(lock, [&]() { return !pending; });
+	}
+
+	void WriterThreadSink::run() {
+		pin_thread(Stage::Writer);
+		bool preallocated = false;
+		while (true) {
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [&]() { return pending || stopping; });
+			if (!pending) {
+				return;
+			}
+			lock.unlock();
+
+			try {
+				writing.replay(*sink);
+			}
+			catch (std::exception& e) {
+				std::cerr << "Exception: " << e.what() << std::endl;
+			}
+			writing.clear();
+
+			lock.lock();
+			// The output file exists once frames have been written
+			if (!preallocated && !preallocate_path.empty()) {
+				preallocate_file(preallocate_path, preallocate_size);
+				preallocated = true;
+			}
+			pending = false;
+			lock.unlock();
+			changed.notify_all();
+		}
+	}
+
+	bool preallocate_file(const std::string& path, std::uint64_t size) {
+#ifdef __linux__
+		int fd = open(path.c_str(), O_WRONLY);
+		if (fd < 0) {
+			return false;
+		}
+		bool ok = fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, (off_t)size) == 0;
+		close(fd);
+		return ok;
+#else
+		return false;
+#endif
+	}
+
+	bool release_preallocation(const std::string& path) {
+#ifdef __linux__
+		// Truncating to the current size frees the blocks reserved beyond it
+		struct stat st;
+		return stat(path.c_str(), &st) == 0 && truncate(path.c_str(), st.st_size) == 0;
+#else
+		return false;
+#endif
+	}
+
+}
@@ -0,0 +1,68 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+#ifndef _APP_WRITER_THREAD_SINK_H
+#define _APP_WRITER_THREAD_SINK_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame_buffer.hpp"
+#include "memory_budget.hpp"
+#include "sink.hpp"
+
+namespace blf_converter {
+
+	/// Copies frames into a buffer that a writer thread hands to another sink, so the
+	/// converting thread only waits for output when both buffers are in use
+	class WriterThreadSink : public FrameSink {
+	public:
+		/// buffer_size is the size of each of the two buffers, reduced to fit the budget
+		explicit WriterThreadSink(std::unique_ptr<FrameSink> sink, MemoryBudget* budget = nullptr, std::size_t buffer_size = 8 << 20);
+		~WriterThreadSink();
+
+		/// Reserves size bytes for path once the writer has created it, Linux only
+		void preallocate(const std::string& path, std::uint64_t size);
+
+		void write_frame(const Frame& frame) override;
+		void discard_frame(const Frame& frame, Discard reason, std::uint64_t count) override;
+		/// Mappings apply to all later frames
+		void add_mapping(const pcapng_exporter::channel_mapping& mapping) override;
+		/// Waits until all frames have been written to the wrapped sink and flushes it
+		void flush() override;
+
+	private:
+		void submit();
+		void wait_idle();
+		void run();
+
+		std::unique_ptr<FrameSink> sink;
+		MemoryBudget* budget;
+		std::size_t buffer_size;
+
+		FrameBuffer filling;
+		FrameBuffer writing;
+		bool pending = false;
+		bool stopping = false;
+		std::mutex mutex;
+		std::condition_variable changed;
+		std::thread writer;
+
+		std::string preallocate_path;
+		std::uint64_t preallocate_size = 0;
+	};
+
+	/// Reserves disk space for size bytes without changing the file size, false if not supported
+	bool preallocate_file(const std::string& path, std::uint64_t size);
+	/// Gives back the space reserved beyond the end of a closed file
+	bool release_preallocation(const std::string& path);
+
+}
+
+#endif
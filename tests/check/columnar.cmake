@@ -0,0 +1,104 @@
+# Converts INPUT to columnar files and compares every CAN and LIN row with the packets of the
+# pcapng REFERENCE of the same input. Direction bits are not compared, the reference has none.
+#
+# Variables: CONVERTER, INPUT, OUTPUT (prefix of the columnar files), REFERENCE, and optionally MAX_MEMORY
+
+include("${CMAKE_CURRENT_LIST_DIR}/pcapng.cmake")
+
+set(options "")
+if(MAX_MEMORY)
+    list(APPEND options "--max-memory" "${MAX_MEMORY}")
+endif()
+execute_process(
+    COMMAND "${CONVERTER}" "--format" "columnar" ${options} "${INPUT}" "${OUTPUT}"
+    RESULT_VARIABLE result
+    ERROR_VARIABLE errors
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Conversion of ${INPUT} failed:\n${errors}")
+endif()
+
+foreach(bus can lin)
+    foreach(column timestamp channel id flags payload offsets)
+        if(NOT EXISTS "${OUTPUT}.${bus}.${column}")
+            message(FATAL_ERROR "Missing column ${OUTPUT}.${bus}.${column}")
+        endif()
+        file(READ "${OUTPUT}.${bus}.${column}" ${bus}_${column} HEX)
+    endforeach()
+    set(${bus}_row 0)
+endforeach()
+
+pcapng_read("${REFERENCE}" reference)
+set(packet 0)
+foreach(data IN LISTS reference_data)
+    list(GET reference_packet_interfaces ${packet} interface)
+    list(GET reference_link_types ${interface} link_type)
+    list(GET reference_names ${interface} channel)
+    list(GET reference_timestamps ${packet} timestamp)
+    list(GET reference_captured ${packet} captured)
+    math(EXPR packet "${packet} + 1")
+
+    if(link_type EQUAL 227 AND captured GREATER_EQUAL 8)
+        # SocketCAN: id with EFF/RTR/ERR flags, length, FD flags, then the payload
+        set(bus can)
+        pcapng_uint_be("${data}" 0 4 socketcan_id)
+        math(EXPR id "${socketcan_id} & 536870911")
+        pcapng_uint("${data}" 10 1 fd_flags)
+        math(EXPR flags "(${socketcan_id} >> 31) | ((${socketcan_id} >> 30) & 1) << 1 | ((${socketcan_id} >> 29) & 1) << 2 | (${fd_flags} & 3) << 3")
+        pcapng_uint("${data}" 8 1 length)
+        math(EXPR available "${captured} - 8")
+        if(length GREATER available)
+            set(length ${available})
+        endif()
+    elseif(link_type EQUAL 212 AND captured GREATER_EQUAL 8)
+        # LINKTYPE_LIN: payload length and message type, pid, checksum, errors, then the payload
+        set(bus lin)
+        pcapng_uint("${data}" 8 1 length)
+        math(EXPR length "${length} >> 4")
+        pcapng_uint("${data}" 10 1 id)
+        pcapng_uint("${data}" 14 1 errors)
+        math(EXPR flags "${errors} << 16")
+    else()
+        continue()
+    endif()
+    math(EXPR digits "${length} * 2")
+    string(SUBSTRING "${data}" 16 ${digits} payload)
+
+    set(row ${${bus}_row})
+    math(EXPR ${bus}_row "${row} + 1")
+    string(LENGTH "${${bus}_timestamp}" size)
+    math(EXPR at "${row} * 16")
+    if(NOT at LESS size)
+        message(FATAL_ERROR "${bus}: row ${row} is missing")
+    endif()
+    pcapng_uint("${${bus}_timestamp}" ${at} 4 low)
+    math(EXPR at "${at} + 8")
+    pcapng_uint("${${bus}_timestamp}" ${at} 4 high)
+    math(EXPR row_timestamp "${high} * 4294967296 + ${low}")
+    math(EXPR at "${row} * 8")
+    pcapng_uint("${${bus}_channel}" ${at} 4 row_channel)
+    pcapng_uint("${${bus}_id}" ${at} 4 row_id)
+    pcapng_uint("${${bus}_flags}" ${at} 4 row_flags)
+    math(EXPR row_flags "${row_flags} & 4294966527")
+    math(EXPR at "${row} * 16")
+    pcapng_uint("${${bus}_offsets}" ${at} 4 begin)
+    math(EXPR at "${at} + 16")
+    pcapng_uint("${${bus}_offsets}" ${at} 4 end)
+    math(EXPR begin_digit "${begin} * 2")
+    math(EXPR row_digits "(${end} - ${begin}) * 2")
+    string(SUBSTRING "${${bus}_payload}" ${begin_digit} ${row_digits} row_payload)
+
+    set(expected "${timestamp} ${channel} ${id} ${flags} ${payload}")
+    set(actual "${row_timestamp} ${row_channel} ${row_id} ${row_flags} ${row_payload}")
+    if(NOT actual STREQUAL expected)
+        message(FATAL_ERROR "${bus} row ${row}: timestamp channel id flags payload are ${actual}, expected ${expected}")
+    endif()
+endforeach()
+
+foreach(bus can lin)
+    string(LENGTH "${${bus}_timestamp}" size)
+    math(EXPR rows "${size} / 16")
+    if(NOT rows EQUAL ${bus}_row)
+        message(FATAL_ERROR "${bus}: ${rows} rows, expected ${${bus}_row}")
+    endif()
+endforeach()
@@ -0,0 +1,37 @@
+# Converts INPUT and compares the output with REFERENCE. Interface Statistics Blocks are
+# not part of the references, they must count the packets written to each interface.
+#
+# With INFLATE, the backend reported by --stats must be the one requested.
+#
+# Variables: CONVERTER, INPUT, OUTPUT, REFERENCE, and optionally CHANNEL_MAP, THREADS, INFLATE, PRESCAN
+
+include("${CMAKE_CURRENT_LIST_DIR}/pcapng.cmake")
+
+set(options "")
+if(CHANNEL_MAP)
+    list(APPEND options "--channel-map" "${CHANNEL_MAP}")
+endif()
+if(THREADS)
+    list(APPEND options "--threads" "${THREADS}")
+endif()
+if(INFLATE)
+    list(APPEND options "--inflate" "${INFLATE}" "--stats")
+endif()
+if(PRESCAN)
+    list(APPEND options "--prescan")
+endif()
+
+file(REMOVE "${OUTPUT}")
+execute_process(
+    COMMAND "${CONVERTER}" ${options} "${INPUT}" "${OUTPUT}"
+    RESULT_VARIABLE result
+    ERROR_VARIABLE errors
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Conversion of ${INPUT} failed:\n${errors}")
+endif()
+if(INFLATE AND NOT errors MATCHES "Inflate backend: ${INFLATE}\n")
+    message(FATAL_ERROR "The containers were not inflated with ${INFLATE}:\n${errors}")
+endif()
+
+pcapng_compare("${OUTPUT}" "${REFERENCE}")
@@ -0,0 +1,95 @@
+# Converts INPUT with --decimate and --max-rate-per-id, and compares the packets with the ones of
+# the pcapng REFERENCE that are expected to be kept: messages are thinned out per channel and id,
+# CAN error frames and LIN frames with errors always pass. Only CAN and LIN references are supported.
+#
+# Variables: CONVERTER, INPUT, OUTPUT, REFERENCE, and EVERY and/or MAX_RATE (Hz, integer)
+
+include("${CMAKE_CURRENT_LIST_DIR}/pcapng.cmake")
+
+if(NOT EVERY)
+    set(EVERY 1)
+endif()
+if(NOT MAX_RATE)
+    set(MAX_RATE 0)
+endif()
+file(REMOVE "${OUTPUT}")
+execute_process(
+    COMMAND "${CONVERTER}" "--decimate" "${EVERY}" "--max-rate-per-id" "${MAX_RATE}" "${INPUT}" "${OUTPUT}"
+    RESULT_VARIABLE result
+    ERROR_VARIABLE errors
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Conversion of ${INPUT} failed:\n${errors}")
+endif()
+
+set(min_interval_ns 0)
+if(MAX_RATE GREATER 0)
+    math(EXPR min_interval_ns "1000000000 / ${MAX_RATE}")
+endif()
+
+pcapng_read("${REFERENCE}" reference)
+set(expected "")
+set(packet 0)
+foreach(data IN LISTS reference_data)
+    list(GET reference_packet_interfaces ${packet} interface)
+    list(GET reference_timestamps ${packet} timestamp)
+    math(EXPR packet "${packet} + 1")
+    list(GET reference_link_types ${interface} link_type)
+    list(GET reference_names ${interface} channel)
+
+    if(link_type EQUAL 227)
+        string(SUBSTRING "${data}" 0 1 flags)
+        if(flags MATCHES "[2367abef]")
+            # Error frame
+            list(APPEND expected "${timestamp}:${data}")
+            continue()
+        endif()
+        # Id with the extended frame flag, without the remote frame flag
+        pcapng_uint_be("${data}" 0 4 id)
+        math(EXPR id "${id} & 2684354559")
+    elseif(link_type EQUAL 212)
+        string(SUBSTRING "${data}" 14 2 errors)
+        if(NOT errors STREQUAL "00")
+            list(APPEND expected "${timestamp}:${data}")
+            continue()
+        endif()
+        pcapng_uint("${data}" 10 1 id)
+        math(EXPR id "${id} & 63")
+    else()
+        message(FATAL_ERROR "Link type ${link_type} of ${REFERENCE} is not supported")
+    endif()
+
+    set(key "${link_type}_${channel}_${id}")
+    if(NOT DEFINED count_${key})
+        set(count_${key} 0)
+    endif()
+    set(count ${count_${key}})
+    math(EXPR count_${key} "${count} + 1")
+    math(EXPR phase "${count} % ${EVERY}")
+    if(NOT phase EQUAL 0)
+        continue()
+    endif()
+    if(count GREATER 0)
+        set(last ${last_${key}})
+        math(EXPR interval "${timestamp} - ${last}")
+        if(timestamp GREATER_EQUAL last AND interval LESS min_interval_ns)
+            continue()
+        endif()
+    endif()
+    set(last_${key} ${timestamp})
+    list(APPEND expected "${timestamp}:${data}")
+endforeach()
+
+pcapng_read("${OUTPUT}" output)
+set(actual "")
+set(packet 0)
+foreach(data IN LISTS output_data)
+    list(GET output_timestamps ${packet} timestamp)
+    math(EXPR packet "${packet} + 1")
+    list(APPEND actual "${timestamp}:${data}")
+endforeach()
+if(NOT actual STREQUAL expected)
+    list(LENGTH expected expected_packets)
+    message(FATAL_ERROR "${output_packets} packets kept, expected ${expected_packets}:\n${actual}\nexpected:\n${expected}")
+endif()
+pcapng_check_statistics(output)
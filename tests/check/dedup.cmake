@@ -0,0 +1,31 @@
+# Converts INPUT followed by INPUT again as a segment with --dedup DEDUP. The repeated frames
+# must be dropped: the output matches REFERENCE, the conversion of INPUT alone, and each
+# interface received every frame twice and accepted both copies before dropping one.
+#
+# Variables: CONVERTER, INPUT, CHANNEL_MAP, OUTPUT, REFERENCE, DEDUP
+
+include("${CMAKE_CURRENT_LIST_DIR}/pcapng.cmake")
+
+file(REMOVE "${OUTPUT}")
+execute_process(
+    COMMAND "${CONVERTER}" "--channel-map" "${CHANNEL_MAP}" "--segment" "${INPUT}" "--dedup" "${DEDUP}" "${INPUT}" "${OUTPUT}"
+    RESULT_VARIABLE result
+    ERROR_VARIABLE errors
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Conversion of ${INPUT} failed:\n${errors}")
+endif()
+
+pcapng_compare("${OUTPUT}" "${REFERENCE}")
+pcapng_read("${OUTPUT}" output)
+set(id 0)
+foreach(delivered IN LISTS output_delivered)
+    list(GET output_received ${id} received)
+    list(GET output_accepted ${id} accepted)
+    math(EXPR repeated "${delivered} * 2")
+    if(NOT received EQUAL repeated OR NOT accepted EQUAL repeated)
+        message(FATAL_ERROR "Interface ${id}: isb_ifrecv ${received}, isb_filteraccept ${accepted}, "
+            "expected twice the ${delivered} packets written")
+    endif()
+    math(EXPR id "${id} + 1")
+endforeach()
@@ -0,0 +1,103 @@
+# Runs info on INPUT with and without --objects, and compares the JSON with the file and with the
+# packets of the pcapng REFERENCE of the same input: the channels used are the ones of its messages,
+# the end time is its last packet. Only CAN and LIN references are supported.
+#
+# Variables: CONVERTER, INPUT, REFERENCE
+
+include("${CMAKE_CURRENT_LIST_DIR}/pcapng.cmake")
+
+foreach(mode header objects)
+    set(options "")
+    if(mode STREQUAL "objects")
+        set(options "--objects")
+    endif()
+    execute_process(
+        COMMAND "${CONVERTER}" "info" ${options} "${INPUT}"
+        RESULT_VARIABLE result
+        OUTPUT_VARIABLE ${mode}_json
+        ERROR_VARIABLE errors
+    )
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "info ${options} ${INPUT} failed:\n${errors}")
+    endif()
+    foreach(field file_size object_count containers measurement_start_ns)
+        if(NOT ${mode}_json MATCHES "\"${field}\": ([0-9]+)")
+            message(FATAL_ERROR "No ${field} in the output of info ${options}:\n${${mode}_json}")
+        endif()
+        set(${mode}_${field} ${CMAKE_MATCH_1})
+    endforeach()
+    if(NOT ${mode}_json MATCHES "\"complete\": true")
+        message(FATAL_ERROR "info ${options} did not read ${INPUT} completely:\n${${mode}_json}")
+    endif()
+endforeach()
+
+file(READ "${INPUT}" hex HEX)
+string(LENGTH "${hex}" digits)
+math(EXPR size "${digits} / 2")
+string(FIND "${header_json}" "\"file\": \"${INPUT}\"" at)
+if(at EQUAL -1 OR NOT header_file_size EQUAL size)
+    message(FATAL_ERROR "info does not describe ${INPUT} of ${size} bytes:\n${header_json}")
+endif()
+if(header_object_count EQUAL 0 OR header_containers EQUAL 0)
+    message(FATAL_ERROR "No objects or containers in ${INPUT}:\n${header_json}")
+endif()
+if(NOT objects_object_count EQUAL header_object_count OR NOT objects_measurement_start_ns EQUAL header_measurement_start_ns)
+    message(FATAL_ERROR "--objects changed the header fields:\n${objects_json}")
+endif()
+
+pcapng_read("${REFERENCE}" reference)
+set(end 0)
+foreach(timestamp IN LISTS reference_timestamps)
+    if(timestamp GREATER end)
+        set(end ${timestamp})
+    endif()
+endforeach()
+if(NOT objects_json MATCHES "\"end_ns\": ${end},")
+    message(FATAL_ERROR "The end time is not the one of the last packet, ${end} ns:\n${objects_json}")
+endif()
+
+# Channels are used by messages, error frames are not counted
+set(expected "")
+set(packet 0)
+foreach(data IN LISTS reference_data)
+    list(GET reference_packet_interfaces ${packet} interface)
+    math(EXPR packet "${packet} + 1")
+    list(GET reference_link_types ${interface} link_type)
+    list(GET reference_names ${interface} name)
+    string(SUBSTRING "${data}" 0 1 flags)
+    string(SUBSTRING "${data}" 14 2 lin_errors)
+    if(link_type EQUAL 227)
+        if(NOT flags MATCHES "[2367abef]")
+            list(APPEND expected "can:${name}")
+        endif()
+    elseif(link_type EQUAL 212)
+        if(lin_errors STREQUAL "00")
+            list(APPEND expected "lin:${name}")
+        endif()
+    else()
+        message(FATAL_ERROR "Link type ${link_type} of ${REFERENCE} is not supported")
+    endif()
+endforeach()
+set(channel_pattern "{ \"bus\": \"([a-z]+)\", \"channel\": ([0-9]+) }")
+string(REGEX MATCHALL "${channel_pattern}" channels "${objects_json}")
+set(actual "")
+foreach(channel IN LISTS channels)
+    string(REGEX MATCH "${channel_pattern}" channel "${channel}")
+    list(APPEND actual "${CMAKE_MATCH_1}:${CMAKE_MATCH_2}")
+endforeach()
+list(SORT expected)
+list(REMOVE_DUPLICATES expected)
+list(SORT actual)
+if(NOT actual STREQUAL expected)
+    message(FATAL_ERROR "Used channels ${actual}, the reference has messages on ${expected}")
+endif()
+
+string(REGEX MATCHALL "\n    \"[0-9]+\": [0-9]+" counts "${objects_json}")
+set(objects 0)
+foreach(count IN LISTS counts)
+    string(REGEX REPLACE ".*: " "" count "${count}")
+    math(EXPR objects "${objects} + ${count}")
+endforeach()
+if(objects LESS reference_packets)
+    message(FATAL_ERROR "${objects} objects counted by type, the reference has ${reference_packets} packets")
+endif()
@@ -0,0 +1,75 @@
+# Converts INPUT, which has only CAN frames, to several outputs in one pass: pcapng, CAN frames
+# as pcapng and pcapng.gz, Ethernet frames and a summary. The pcapng outputs with CAN frames must
+# match REFERENCE, the Ethernet one has no packets, the summary counts the packets of REFERENCE.
+# The gzip output is decompressed when gzip is found, its size is checked otherwise.
+#
+# Variables: CONVERTER, INPUT, CHANNEL_MAP, OUTPUT (prefix of the outputs), REFERENCE
+
+include("${CMAKE_CURRENT_LIST_DIR}/pcapng.cmake")
+
+file(REMOVE "${OUTPUT}.pcapng" "${OUTPUT}_can.pcapng" "${OUTPUT}_can.pcapng.gz" "${OUTPUT}_ethernet.pcapng" "${OUTPUT}.json")
+execute_process(
+    COMMAND "${CONVERTER}"
+        "--channel-map" "${CHANNEL_MAP}"
+        "--output" "${OUTPUT}_can.pcapng,types=can"
+        "--output" "${OUTPUT}_can.pcapng.gz,types=can"
+        "--output" "${OUTPUT}_ethernet.pcapng,types=ethernet"
+        "--output" "${OUTPUT}.json"
+        "${INPUT}" "${OUTPUT}.pcapng"
+    RESULT_VARIABLE result
+    ERROR_VARIABLE errors
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Conversion of ${INPUT} failed:\n${errors}")
+endif()
+
+pcapng_compare("${OUTPUT}.pcapng" "${REFERENCE}")
+pcapng_compare("${OUTPUT}_can.pcapng" "${REFERENCE}")
+
+file(READ "${OUTPUT}_can.pcapng.gz" gz HEX)
+if(NOT gz MATCHES "^1f8b08")
+    message(FATAL_ERROR "${OUTPUT}_can.pcapng.gz is not a gzip file")
+endif()
+find_program(GZIP gzip)
+if(GZIP)
+    execute_process(
+        COMMAND "${GZIP}" "-dc" "${OUTPUT}_can.pcapng.gz"
+        OUTPUT_FILE "${OUTPUT}_can_gz.pcapng"
+        RESULT_VARIABLE result
+    )
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "Unable to decompress ${OUTPUT}_can.pcapng.gz")
+    endif()
+    pcapng_compare("${OUTPUT}_can_gz.pcapng" "${REFERENCE}")
+else()
+    # The gzip trailer ends with the uncompressed size
+    string(LENGTH "${gz}" digits)
+    math(EXPR at "${digits} - 8")
+    pcapng_uint("${gz}" ${at} 4 size)
+    file(READ "${OUTPUT}_can.pcapng" can HEX)
+    string(LENGTH "${can}" digits)
+    math(EXPR expected "${digits} / 2")
+    if(NOT size EQUAL expected)
+        message(FATAL_ERROR "${OUTPUT}_can.pcapng.gz has ${size} bytes uncompressed, expected ${expected}")
+    endif()
+endif()
+
+pcapng_read("${OUTPUT}_ethernet.pcapng" ethernet)
+if(NOT ethernet_packets EQUAL 0)
+    message(FATAL_ERROR "${ethernet_packets} packets in ${OUTPUT}_ethernet.pcapng, the input has no Ethernet frames")
+endif()
+pcapng_check_statistics(ethernet)
+
+pcapng_read("${REFERENCE}" reference)
+file(READ "${OUTPUT}.json" json)
+foreach(field objects messages errors)
+    if(NOT json MATCHES "\"${field}\": ([0-9]+)")
+        message(FATAL_ERROR "No ${field} in ${OUTPUT}.json:\n${json}")
+    endif()
+    set(summary_${field} ${CMAKE_MATCH_1})
+endforeach()
+math(EXPR frames "${summary_messages} + ${summary_errors}")
+if(NOT frames EQUAL reference_packets OR summary_objects LESS frames)
+    message(FATAL_ERROR "${summary_objects} objects, ${summary_messages} messages and ${summary_errors} errors in ${OUTPUT}.json, "
+        "the reference has ${reference_packets} packets")
+endif()
@@ -0,0 +1,200 @@
+# Reads the pcapng files written by blf_converter in the check scripts.
+#
+# pcapng_read(<path> <prefix>) parses a little endian file and sets in the caller:
+#   <prefix>_blocks      hex of all blocks but the Interface Statistics Blocks, to compare with a reference
+#   <prefix>_interfaces  number of Interface Description Blocks
+#   <prefix>_link_types, <prefix>_names: link type and if_name of each interface
+#   <prefix>_packets     number of Enhanced Packet Blocks
+#   <prefix>_packet_interfaces, <prefix>_captured, <prefix>_original, <prefix>_timestamps (ns), <prefix>_data (hex):
+#                        one entry per packet
+#   <prefix>_statistics  number of Interface Statistics Blocks
+#   <prefix>_delivered, <prefix>_received, <prefix>_accepted: isb_usrdeliv, isb_ifrecv and isb_filteraccept
+#                        of each Interface Statistics Block
+#
+# pcapng_compare(<path> <reference>) fails unless the file has the blocks of the reference,
+# with statistics counting the packets written to each interface.
+
+# Little endian unsigned value of bytes at digit position of hex, as read by file(READ ... HEX)
+function(pcapng_uint hex position bytes out)
+    math(EXPR digits "${bytes} * 2")
+    string(SUBSTRING "${hex}" ${position} ${digits} le)
+    set(value 0)
+    math(EXPR byte "${digits} - 2")
+    while(byte GREATER_EQUAL 0)
+        foreach(nibble 0 1)
+            math(EXPR at "${byte} + ${nibble}")
+            string(SUBSTRING "${le}" ${at} 1 digit)
+            string(FIND "0123456789abcdef" "${digit}" digit)
+            math(EXPR value "${value} * 16 + ${digit}")
+        endforeach()
+        math(EXPR byte "${byte} - 2")
+    endwhile()
+    set(${out} ${value} PARENT_SCOPE)
+endfunction()
+
+# Big endian unsigned value, as in the SocketCAN id of CAN packets
+function(pcapng_uint_be hex position bytes out)
+    math(EXPR digits "${bytes} * 2")
+    string(SUBSTRING "${hex}" ${position} ${digits} be)
+    set(le "")
+    math(EXPR byte "${digits} - 2")
+    while(byte GREATER_EQUAL 0)
+        string(SUBSTRING "${be}" ${byte} 2 digit)
+        string(APPEND le "${digit}")
+        math(EXPR byte "${byte} - 2")
+    endwhile()
+    pcapng_uint("${le}" 0 ${bytes} value)
+    set(${out} ${value} PARENT_SCOPE)
+endfunction()
+
+function(pcapng_read path prefix)
+    if(NOT EXISTS "${path}")
+        message(FATAL_ERROR "Missing output ${path}")
+    endif()
+    file(READ "${path}" hex HEX)
+    string(LENGTH "${hex}" size)
+
+    set(blocks "")
+    set(interfaces 0)
+    set(link_types "")
+    set(names "")
+    set(packets 0)
+    set(statistics 0)
+    set(packet_interfaces "")
+    set(captured "")
+    set(original "")
+    set(timestamps "")
+    set(data "")
+    set(delivered "")
+    set(received "")
+    set(accepted "")
+    set(isb_counter_4 received)
+    set(isb_counter_6 accepted)
+    set(isb_counter_8 delivered)
+    set(position 0)
+    while(position LESS size)
+        pcapng_uint("${hex}" ${position} 4 type)
+        math(EXPR at "${position} + 8")
+        pcapng_uint("${hex}" ${at} 4 length)
+        if(length LESS 12)
+            message(FATAL_ERROR "Invalid block length ${length} in ${path}")
+        endif()
+        math(EXPR digits "${length} * 2")
+        math(EXPR body "${position} + 16")
+
+        if(type EQUAL 1)
+            math(EXPR interfaces "${interfaces} + 1")
+            pcapng_uint("${hex}" ${body} 2 link_type)
+            list(APPEND link_types ${link_type})
+            # Options follow the link type and the snap length
+            set(name "")
+            math(EXPR option "${body} + 16")
+            math(EXPR end "${position} + ${digits} - 8")
+            while(option LESS end)
+                pcapng_uint("${hex}" ${option} 2 code)
+                math(EXPR at "${option} + 4")
+                pcapng_uint("${hex}" ${at} 2 option_length)
+                math(EXPR value "${option} + 8")
+                if(code EQUAL 2)
+                    math(EXPR name_end "${value} + ${option_length} * 2")
+                    while(value LESS name_end)
+                        pcapng_uint("${hex}" ${value} 1 char)
+                        if(char GREATER 0)
+                            string(ASCII ${char} char)
+                            string(APPEND name "${char}")
+                        endif()
+                        math(EXPR value "${value} + 2")
+                    endwhile()
+                    break()
+                endif()
+                if(code EQUAL 0)
+                    break()
+                endif()
+                math(EXPR option "${value} + (${option_length} + 3) / 4 * 8")
+            endwhile()
+            list(APPEND names "${name}")
+        elseif(type EQUAL 6)
+            math(EXPR packets "${packets} + 1")
+            pcapng_uint("${hex}" ${body} 4 interface)
+            math(EXPR at "${body} + 8")
+            pcapng_uint("${hex}" ${at} 4 high)
+            math(EXPR at "${body} + 16")
+            pcapng_uint("${hex}" ${at} 4 low)
+            math(EXPR at "${body} + 24")
+            pcapng_uint("${hex}" ${at} 4 caplen)
+            math(EXPR at "${body} + 32")
+            pcapng_uint("${hex}" ${at} 4 origlen)
+            math(EXPR ns "${high} * 4294967296 + ${low}")
+            math(EXPR at "${body} + 40")
+            math(EXPR caplen_digits "${caplen} * 2")
+            string(SUBSTRING "${hex}" ${at} ${caplen_digits} payload)
+            list(APPEND packet_interfaces ${interface})
+            list(APPEND captured ${caplen})
+            list(APPEND original ${origlen})
+            list(APPEND timestamps ${ns})
+            list(APPEND data "${payload}")
+        elseif(type EQUAL 5)
+            math(EXPR statistics "${statistics} + 1")
+            # Options follow the interface id and the timestamp
+            math(EXPR option "${body} + 24")
+            math(EXPR end "${position} + ${digits} - 8")
+            while(option LESS end)
+                pcapng_uint("${hex}" ${option} 2 code)
+                math(EXPR at "${option} + 4")
+                pcapng_uint("${hex}" ${at} 2 option_length)
+                math(EXPR value "${option} + 8")
+                if(code EQUAL 4 OR code EQUAL 6 OR code EQUAL 8)
+                    pcapng_uint("${hex}" ${value} 4 low)
+                    math(EXPR at "${value} + 8")
+                    pcapng_uint("${hex}" ${at} 4 high)
+                    math(EXPR count "${high} * 4294967296 + ${low}")
+                    list(APPEND ${isb_counter_${code}} ${count})
+                endif()
+                if(code EQUAL 0)
+                    break()
+                endif()
+                math(EXPR option "${value} + (${option_length} + 3) / 4 * 8")
+            endwhile()
+        endif()
+
+        if(NOT type EQUAL 5)
+            string(SUBSTRING "${hex}" ${position} ${digits} block)
+            string(APPEND blocks "${block}")
+        endif()
+        math(EXPR position "${position} + ${digits}")
+    endwhile()
+
+    foreach(name blocks interfaces link_types names packets statistics packet_interfaces captured original timestamps data delivered received accepted)
+        set(${prefix}_${name} "${${name}}" PARENT_SCOPE)
+    endforeach()
+endfunction()
+
+# Fails unless every interface has a statistics block counting the packets written to it
+function(pcapng_check_statistics prefix)
+    if(NOT ${prefix}_statistics EQUAL ${prefix}_interfaces)
+        message(FATAL_ERROR "${${prefix}_statistics} statistics blocks for ${${prefix}_interfaces} interfaces")
+    endif()
+    set(id 0)
+    foreach(delivered IN LISTS ${prefix}_delivered)
+        set(count 0)
+        foreach(interface IN LISTS ${prefix}_packet_interfaces)
+            if(interface EQUAL id)
+                math(EXPR count "${count} + 1")
+            endif()
+        endforeach()
+        if(NOT delivered EQUAL count)
+            message(FATAL_ERROR "Interface ${id}: isb_usrdeliv ${delivered}, ${count} packets written")
+        endif()
+        math(EXPR id "${id} + 1")
+    endforeach()
+endfunction()
+
+function(pcapng_compare path reference)
+    pcapng_read("${path}" output)
+    pcapng_read("${reference}" reference)
+    if(NOT output_blocks STREQUAL reference_blocks)
+        message(FATAL_ERROR "${path} differs from ${reference}: ${output_packets} packets on ${output_interfaces} interfaces, "
+            "expected ${reference_packets} packets on ${reference_interfaces} interfaces")
+    endif()
+    pcapng_check_statistics(output)
+endfunction()
@@ -0,0 +1,48 @@
+# Converts INPUT with THREADS encoding threads, every stage pinned to CPU, and --huge-pages --stats.
+# The output must match REFERENCE, the statistics must report the conversion and the placement:
+# one reader, THREADS encoders and at least one writer, each on CPU. Pinning may be unsupported.
+#
+# Variables: CONVERTER, INPUT, CHANNEL_MAP, OUTPUT, REFERENCE, THREADS, CPU
+
+include("${CMAKE_CURRENT_LIST_DIR}/pcapng.cmake")
+
+file(REMOVE "${OUTPUT}")
+execute_process(
+    COMMAND "${CONVERTER}" "--channel-map" "${CHANNEL_MAP}"
+        "--cpus" "reader=${CPU}" "--cpus" "encoder=${CPU}" "--cpus" "writer=${CPU}"
+        "--threads" "${THREADS}" "--huge-pages" "--stats"
+        "${INPUT}" "${OUTPUT}"
+    RESULT_VARIABLE result
+    ERROR_VARIABLE stats
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Conversion of ${INPUT} failed:\n${stats}")
+endif()
+
+pcapng_compare("${OUTPUT}" "${REFERENCE}")
+pcapng_read("${REFERENCE}" reference)
+
+if(NOT stats MATCHES "Converted ([0-9]+) objects in ")
+    message(FATAL_ERROR "No object count in the statistics:\n${stats}")
+endif()
+if(CMAKE_MATCH_1 LESS reference_packets)
+    message(FATAL_ERROR "${CMAKE_MATCH_1} objects converted, the reference has ${reference_packets} packets")
+endif()
+if(NOT stats MATCHES "Peak memory: [0-9]+ MiB resident" OR NOT stats MATCHES "Inflate backend: [a-z-]+\n")
+    message(FATAL_ERROR "No memory use or inflate backend in the statistics:\n${stats}")
+endif()
+
+foreach(stage reader encoder writer)
+    if(NOT stats MATCHES "Stage ${stage}: ([0-9]+) threads, cpus ([^,\n]+)(, ([0-9]+) not pinned)?\n")
+        message(FATAL_ERROR "No placement of the ${stage} stage in the statistics:\n${stats}")
+    endif()
+    set(threads ${CMAKE_MATCH_1})
+    set(cpus ${CMAKE_MATCH_2})
+    set(expected 1)
+    if(stage STREQUAL "encoder")
+        set(expected ${THREADS})
+    endif()
+    if(NOT cpus STREQUAL CPU OR (stage STREQUAL "writer" AND threads LESS 1) OR (NOT stage STREQUAL "writer" AND NOT threads EQUAL expected))
+        message(FATAL_ERROR "The ${stage} stage has ${threads} threads on cpus ${cpus}, expected ${expected} on ${CPU}:\n${stats}")
+    endif()
+endforeach()
@@ -0,0 +1,185 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/// Seconds to wait for an output of the server, the test inputs convert in milliseconds
+#define SERVE_TIMEOUT_S 30
+/// Seconds before a watched file is moved in again, in case it was written before the watch started
+#define SERVE_RETRY_S 5
+
+/* Runs blf_converter serve for the serve tests, waits for its outputs and stops it like a user would, with SIGTERM */
+
+static pid_t server = -1;
+
+static bool start(const std::vector<std::string>& command) {
+	std::vector<char*> argv;
+	for (const auto& arg : command) {
+		argv.push_back(const_cast<char*>(arg.c_str()));
+	}
+	argv.push_back(nullptr);
+	server = fork();
+	if (server == 0) {
+		execv(argv[0], argv.data());
+		perror(argv[0]);
+		_exit(127);
+	}
+	return server > 0;
+}
+
+/* Exit status of the server after SIGTERM, 1 if it was killed or had already ended */
+static int stop() {
+	int status;
+	if (waitpid(server, &status, WNOHANG) == server) {
+		fprintf(stderr, "The server ended early\n");
+		return 1;
+	}
+	kill(server, SIGTERM);
+	if (waitpid(server, &status, 0) != server || !WIFEXITED(status)) {
+		fprintf(stderr, "The server did not exit after SIGTERM\n");
+		return 1;
+	}
+	if (WEXITSTATUS(status) != 0) {
+		fprintf(stderr, "The server exited with %d\n", WEXITSTATUS(status));
+	}
+	return WEXITSTATUS(status);
+}
+
+/* Polls done until it is true, false after the timeout or when the server ended */
+static bool wait_for(std::function<bool()> done, int seconds = SERVE_TIMEOUT_S) {
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+	while (!done()) {
+		int status;
+		if (std::chrono::steady_clock::now() > deadline || waitpid(server, &status, WNOHANG) == server) {
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	}
+	return true;
+}
+
+static bool exists(const std::string& path) {
+	return access(path.c_str(), F_OK) == 0;
+}
+
+static bool copy(const std::string& from, const std::string& to) {
+	std::ifstream in(from, std::ios::binary);
+	std::ofstream out(to, std::ios::binary);
+	out << in.rdbuf();
+	out.close();
+	return in.good() && out.good();
+}
+
+/* Converts a file already in dir with --existing, then one written to dir while the server runs */
+static int watch(const std::string& converter, const std::string& map, const std::string& input,
+	const std::string& dir, const std::string& output) {
+	if (!copy(input, dir + "/existing.blf")) {
+		fprintf(stderr, "Unable to copy %s\n", input.c_str());
+		return 1;
+	}
+	if (!start({ converter, "serve", "--watch", dir, "--output", output, "--channel-map", map, "--existing" })) {
+		return 1;
+	}
+	if (!wait_for([&]() { return exists(output + "/existing.pcapng"); })) {
+		fprintf(stderr, "No output for the existing file\n");
+		stop();
+		return 1;
+	}
+
+	bool converted = copy(input, dir + "/written.blf")
+		&& wait_for([&]() { return exists(output + "/written.pcapng"); }, SERVE_RETRY_S);
+	if (!converted) {
+		// Moving the file in again is noticed by the watch, whenever it started
+		converted = copy(input, dir + "/.written.tmp")
+			&& rename((dir + "/.written.tmp").c_str(), (dir + "/written.blf").c_str()) == 0
+			&& wait_for([&]() { return exists(output + "/written.pcapng"); });
+	}
+	if (!converted) {
+		fprintf(stderr, "No output for the written file\n");
+		stop();
+		return 1;
+	}
+	return stop();
+}
+
+/* Sends one request line and saves the response until the server closes the connection */
+static bool request(const std::string& path, const std::string& line, const std::string& outfile) {
+	struct sockaddr_un addr {};
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+	int fd = -1;
+	bool connected = wait_for([&]() {
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+			return true;
+		}
+		close(fd);
+		return false;
+	});
+	if (!connected) {
+		fprintf(stderr, "Unable to connect to %s\n", path.c_str());
+		return false;
+	}
+
+	std::string text = line + "\n";
+	bool ok = write(fd, text.data(), text.size()) == (ssize_t)text.size();
+	std::ofstream out(outfile, std::ios::binary);
+	char buffer[65536];
+	ssize_t length;
+	while (ok && (length = read(fd, buffer, sizeof(buffer))) != 0) {
+		if (length < 0 && errno == EINTR) {
+			continue;
+		}
+		ok = length > 0;
+		if (ok) {
+			out.write(buffer, length);
+		}
+	}
+	close(fd);
+	out.close();
+	return ok && out.good();
+}
+
+/* Sends each request to the socket server in turn */
+static int socket_requests(const std::string& converter, const std::string& path, char* pairs[], int count) {
+	if (!start({ converter, "serve", "--socket", path })) {
+		return 1;
+	}
+	for (int i = 0; i + 1 < count; i += 2) {
+		if (!request(path, pairs[i], pairs[i + 1])) {
+			stop();
+			return 1;
+		}
+	}
+	return stop();
+}
+
+int main(int argc, char* argv[]) {
+	std::string mode = argc > 1 ? argv[1] : "";
+	if (mode == "watch" && argc == 7) {
+		return watch(argv[2], argv[3], argv[4], argv[5], argv[6]);
+	}
+	if (mode == "socket" && argc >= 6 && argc % 2 == 0) {
+		return socket_requests(argv[2], argv[3], argv + 4, argc - 4);
+	}
+	fprintf(stderr, "Usage: %s watch converter map-file blf-file dir output-dir\n", argv[0]);
+	fprintf(stderr, "       %s socket converter socket (request outfile)...\n", argv[0]);
+	return 1;
+}
@@ -0,0 +1,61 @@
+# Runs blf_converter serve --socket through SERVE_CHECK and sends it three requests: the whole
+# INPUT, compared with REFERENCE, the packets from the last timestamp of REFERENCE on, and a
+# missing file, answered with an error.
+#
+# Variables: CONVERTER, SERVE_CHECK, INPUT, CHANNEL_MAP, OUTPUT (directory), REFERENCE
+
+include("${CMAKE_CURRENT_LIST_DIR}/pcapng.cmake")
+
+pcapng_read("${REFERENCE}" reference)
+set(start 0)
+foreach(timestamp IN LISTS reference_timestamps)
+    if(timestamp GREATER start)
+        set(start ${timestamp})
+    endif()
+endforeach()
+
+file(REMOVE_RECURSE "${OUTPUT}")
+file(MAKE_DIRECTORY "${OUTPUT}")
+set(file "\"file\": \"${INPUT}\", \"channel_map\": \"${CHANNEL_MAP}\"")
+execute_process(
+    COMMAND "${SERVE_CHECK}" "socket" "${CONVERTER}" "${OUTPUT}/serve.sock"
+        "{${file}}" "${OUTPUT}/all.pcapng"
+        "{${file}, \"start\": ${start}}" "${OUTPUT}/start.pcapng"
+        "{\"file\": \"${OUTPUT}/missing.blf\"}" "${OUTPUT}/missing.json"
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE errors
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Serving ${OUTPUT}/serve.sock failed:\n${output}${errors}")
+endif()
+
+pcapng_compare("${OUTPUT}/all.pcapng" "${REFERENCE}")
+
+# Interfaces are added as packets need them, only times and data are compared
+set(expected "")
+set(packet 0)
+foreach(data IN LISTS reference_data)
+    list(GET reference_timestamps ${packet} timestamp)
+    math(EXPR packet "${packet} + 1")
+    if(timestamp GREATER_EQUAL start)
+        list(APPEND expected "${timestamp}:${data}")
+    endif()
+endforeach()
+pcapng_read("${OUTPUT}/start.pcapng" window)
+set(actual "")
+set(packet 0)
+foreach(data IN LISTS window_data)
+    list(GET window_timestamps ${packet} timestamp)
+    math(EXPR packet "${packet} + 1")
+    list(APPEND actual "${timestamp}:${data}")
+endforeach()
+if(NOT actual STREQUAL expected)
+    message(FATAL_ERROR "Packets from ${start} ns are ${actual}, expected ${expected}")
+endif()
+pcapng_check_statistics(window)
+
+file(READ "${OUTPUT}/missing.json" response)
+if(NOT response MATCHES "^{\"error\": \"Unable to open: ")
+    message(FATAL_ERROR "Response for a missing file: ${response}")
+endif()
@@ -0,0 +1,26 @@
+# Runs blf_converter serve --watch through SERVE_CHECK on a file already in the watched directory
+# and on one written while the server runs, and compares both outputs with REFERENCE.
+#
+# Variables: CONVERTER, SERVE_CHECK, INPUT, CHANNEL_MAP, OUTPUT (directory), REFERENCE
+
+include("${CMAKE_CURRENT_LIST_DIR}/pcapng.cmake")
+
+file(REMOVE_RECURSE "${OUTPUT}")
+file(MAKE_DIRECTORY "${OUTPUT}/watch" "${OUTPUT}/pcapng")
+execute_process(
+    COMMAND "${SERVE_CHECK}" "watch" "${CONVERTER}" "${CHANNEL_MAP}" "${INPUT}" "${OUTPUT}/watch" "${OUTPUT}/pcapng"
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE errors
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Serving ${OUTPUT}/watch failed:\n${output}${errors}")
+endif()
+
+foreach(name existing written)
+    pcapng_compare("${OUTPUT}/pcapng/${name}.pcapng" "${REFERENCE}")
+endforeach()
+file(GLOB leftovers "${OUTPUT}/pcapng/.*.tmp")
+if(leftovers)
+    message(FATAL_ERROR "Temporary files left: ${leftovers}")
+endif()
@@ -0,0 +1,59 @@
+# Converts INPUT with --snaplen SNAPLEN and --snaplen LINK:LINK_SNAPLEN, and compares each packet
+# with the one of the pcapng REFERENCE: the captured data is its prefix, the original length is kept.
+#
+# Variables: CONVERTER, INPUT, OUTPUT, REFERENCE, SNAPLEN, LINK (can, lin, flexray, ethernet), LINK_SNAPLEN
+
+include("${CMAKE_CURRENT_LIST_DIR}/pcapng.cmake")
+
+file(REMOVE "${OUTPUT}")
+execute_process(
+    COMMAND "${CONVERTER}" "--snaplen" "${SNAPLEN}" "--snaplen" "${LINK}:${LINK_SNAPLEN}" "${INPUT}" "${OUTPUT}"
+    RESULT_VARIABLE result
+    ERROR_VARIABLE errors
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Conversion of ${INPUT} failed:\n${errors}")
+endif()
+
+set(link_type_can 227)
+set(link_type_lin 212)
+set(link_type_flexray 210)
+set(link_type_ethernet 1)
+set(link_type ${link_type_${LINK}})
+
+pcapng_read("${REFERENCE}" reference)
+pcapng_read("${OUTPUT}" output)
+if(NOT output_packets EQUAL reference_packets)
+    message(FATAL_ERROR "${output_packets} packets, the reference has ${reference_packets}")
+endif()
+set(packet 0)
+set(truncated 0)
+foreach(data IN LISTS reference_data)
+    foreach(field packet_interfaces timestamps captured original data)
+        list(GET reference_${field} ${packet} reference_${field}_value)
+        list(GET output_${field} ${packet} output_${field}_value)
+    endforeach()
+    list(GET reference_link_types ${reference_packet_interfaces_value} packet_link_type)
+    set(limit ${SNAPLEN})
+    if(packet_link_type EQUAL link_type)
+        set(limit ${LINK_SNAPLEN})
+    endif()
+    set(captured ${reference_captured_value})
+    if(captured GREATER limit)
+        set(captured ${limit})
+        math(EXPR truncated "${truncated} + 1")
+    endif()
+    math(EXPR digits "${captured} * 2")
+    string(SUBSTRING "${data}" 0 ${digits} prefix)
+
+    set(expected "${reference_packet_interfaces_value} ${reference_timestamps_value} ${captured} ${reference_original_value} ${prefix}")
+    set(actual "${output_packet_interfaces_value} ${output_timestamps_value} ${output_captured_value} ${output_original_value} ${output_data_value}")
+    if(NOT actual STREQUAL expected)
+        message(FATAL_ERROR "Packet ${packet}: interface timestamp captured original data are ${actual}, expected ${expected}")
+    endif()
+    math(EXPR packet "${packet} + 1")
+endforeach()
+if(truncated EQUAL 0)
+    message(FATAL_ERROR "No packet of ${REFERENCE} is longer than the snap length, the test checks nothing")
+endif()
+pcapng_check_statistics(output)
@@ -0,0 +1,123 @@
+# Runs --summary on INPUT and compares the statistics with the packets of the pcapng REFERENCE
+# of the same input. Counts and times are compared per channel when the reference has only CAN
+# and LIN interfaces, their objects are all messages or error frames. Ids are compared for CAN, with their extended flag.
+#
+# Variables: CONVERTER, INPUT, OUTPUT (json), REFERENCE
+
+include("${CMAKE_CURRENT_LIST_DIR}/pcapng.cmake")
+
+file(REMOVE "${OUTPUT}")
+execute_process(
+    COMMAND "${CONVERTER}" "--summary" "${INPUT}" "${OUTPUT}"
+    RESULT_VARIABLE result
+    ERROR_VARIABLE errors
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Summary of ${INPUT} failed:\n${errors}")
+endif()
+file(READ "${OUTPUT}" json)
+
+foreach(field measurement_start_ns first_ns last_ns objects messages errors)
+    if(NOT json MATCHES "\"${field}\": ([0-9]+)")
+        message(FATAL_ERROR "No ${field} in ${OUTPUT}:\n${json}")
+    endif()
+    set(summary_${field} ${CMAKE_MATCH_1})
+endforeach()
+if(summary_objects EQUAL 0)
+    message(FATAL_ERROR "No objects counted in ${OUTPUT}")
+endif()
+
+pcapng_read("${REFERENCE}" reference)
+foreach(link_type IN LISTS reference_link_types)
+    if(NOT link_type EQUAL 227 AND NOT link_type EQUAL 212)
+        return()
+    endif()
+endforeach()
+
+math(EXPR total "${summary_messages} + ${summary_errors}")
+if(NOT total EQUAL reference_packets)
+    message(FATAL_ERROR "${summary_messages} messages and ${summary_errors} errors, the reference has ${reference_packets} packets")
+endif()
+
+set(channel_pattern "\"bus\": \"([a-z]+)\",\n *\"channel\": ([0-9]+),\n *\"messages\": ([0-9]+),\n *\"errors\": ([0-9]+),\n *\"first_ns\": ([0-9]+),\n *\"last_ns\": ([0-9]+),\n *\"ids\": \\[([^]]*)\\]")
+string(REGEX MATCHALL "${channel_pattern}" channels "${json}")
+set(summary_channels "")
+foreach(channel IN LISTS channels)
+    string(REGEX MATCH "${channel_pattern}" channel "${channel}")
+    set(bus ${CMAKE_MATCH_1})
+    if(bus STREQUAL "can")
+        set(bus_link_type 227)
+    else()
+        set(bus_link_type 212)
+    endif()
+    set(number ${CMAKE_MATCH_2})
+    list(APPEND summary_channels ${number})
+    math(EXPR frames "${CMAKE_MATCH_3} + ${CMAKE_MATCH_4}")
+    # Summary times are relative to the measurement start, packet times are absolute
+    math(EXPR first "${summary_measurement_start_ns} + ${CMAKE_MATCH_5}")
+    math(EXPR last "${summary_measurement_start_ns} + ${CMAKE_MATCH_6}")
+    set(ids "${CMAKE_MATCH_7}")
+
+    set(packets 0)
+    set(packet_first "")
+    set(packet_last "")
+    set(packet_ids "")
+    set(packet 0)
+    foreach(data IN LISTS reference_data)
+        list(GET reference_packet_interfaces ${packet} interface)
+        list(GET reference_timestamps ${packet} timestamp)
+        math(EXPR packet "${packet} + 1")
+        list(GET reference_names ${interface} name)
+        list(GET reference_link_types ${interface} link_type)
+        if(NOT name STREQUAL number OR NOT link_type EQUAL bus_link_type)
+            continue()
+        endif()
+        math(EXPR packets "${packets} + 1")
+        if(packet_first STREQUAL "" OR timestamp LESS packet_first)
+            set(packet_first ${timestamp})
+        endif()
+        if(packet_last STREQUAL "" OR timestamp GREATER packet_last)
+            set(packet_last ${timestamp})
+        endif()
+        # CAN messages by id and CAN_EFF_FLAG of the SocketCAN id, error frames are not counted per id
+        string(SUBSTRING "${data}" 0 2 flags)
+        if(bus STREQUAL "can" AND NOT flags MATCHES "^[2367abef]")
+            pcapng_uint_be("${data}" 0 4 id)
+            math(EXPR id "${id} & 2684354559")
+            list(APPEND packet_ids ${id})
+        endif()
+    endforeach()
+
+    if(NOT "${frames} ${first} ${last}" STREQUAL "${packets} ${packet_first} ${packet_last}")
+        message(FATAL_ERROR "${bus} channel ${number}: ${frames} frames from ${first} to ${last} ns, "
+            "the reference has ${packets} packets from ${packet_first} to ${packet_last} ns")
+    endif()
+    if(bus STREQUAL "can")
+        string(REGEX MATCHALL "\"id\": [0-9]+, \"extended\": [a-z]+, \"count\": [0-9]+" id_counts "${ids}")
+        set(counted 0)
+        foreach(id_count IN LISTS id_counts)
+            string(REGEX MATCH "\"id\": ([0-9]+), \"extended\": (true|false), \"count\": ([0-9]+)" id_count "${id_count}")
+            set(id ${CMAKE_MATCH_1})
+            set(count ${CMAKE_MATCH_3})
+            if(CMAKE_MATCH_2 STREQUAL "true")
+                math(EXPR id "${id} + 2147483648")
+            endif()
+            set(matching ${packet_ids})
+            list(FILTER matching INCLUDE REGEX "^${id}$")
+            list(LENGTH matching expected)
+            if(NOT count EQUAL expected)
+                message(FATAL_ERROR "can channel ${number}: {${id_count}}, the reference has ${expected} packets")
+            endif()
+            math(EXPR counted "${counted} + ${count}")
+        endforeach()
+        list(LENGTH packet_ids expected)
+        if(NOT counted EQUAL expected)
+            message(FATAL_ERROR "can channel ${number}: ${counted} messages counted per id, the reference has ${expected}")
+        endif()
+    endif()
+endforeach()
+
+list(LENGTH summary_channels count)
+if(NOT count EQUAL reference_interfaces)
+    message(FATAL_ERROR "${count} channels in ${OUTPUT}, the reference has ${reference_interfaces} interfaces")
+endif()
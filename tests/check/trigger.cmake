@@ -0,0 +1,66 @@
+# Converts INPUT with --trigger TRIGGER, and compares the packets with the ones of the pcapng
+# REFERENCE within PRE_NS before to POST_NS after a trigger. TRIGGER must name the error objects
+# of the input: the triggers are the CAN error frames and the LIN frames with errors of REFERENCE.
+#
+# Variables: CONVERTER, INPUT, OUTPUT, REFERENCE, TRIGGER, PRE_NS, POST_NS, optional THREADS
+
+include("${CMAKE_CURRENT_LIST_DIR}/pcapng.cmake")
+
+set(options "")
+if(DEFINED THREADS)
+    list(APPEND options "--threads" "${THREADS}")
+endif()
+
+file(REMOVE "${OUTPUT}")
+execute_process(
+    COMMAND "${CONVERTER}" ${options} "--trigger" "${TRIGGER}" "--pre" "${PRE_NS}ns" "--post" "${POST_NS}ns" "${INPUT}" "${OUTPUT}"
+    RESULT_VARIABLE result
+    ERROR_VARIABLE errors
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Conversion of ${INPUT} failed:\n${errors}")
+endif()
+
+pcapng_read("${REFERENCE}" reference)
+set(triggers "")
+set(packet 0)
+foreach(data IN LISTS reference_data)
+    list(GET reference_packet_interfaces ${packet} interface)
+    list(GET reference_timestamps ${packet} timestamp)
+    math(EXPR packet "${packet} + 1")
+    list(GET reference_link_types ${interface} link_type)
+    string(SUBSTRING "${data}" 0 1 flags)
+    string(SUBSTRING "${data}" 14 2 lin_errors)
+    if((link_type EQUAL 227 AND flags MATCHES "[2367abef]") OR (link_type EQUAL 212 AND NOT lin_errors STREQUAL "00"))
+        list(APPEND triggers ${timestamp})
+    endif()
+endforeach()
+
+set(expected "")
+set(packet 0)
+foreach(data IN LISTS reference_data)
+    list(GET reference_timestamps ${packet} timestamp)
+    math(EXPR packet "${packet} + 1")
+    foreach(trigger IN LISTS triggers)
+        math(EXPR from "${trigger} - ${PRE_NS}")
+        math(EXPR until "${trigger} + ${POST_NS}")
+        if(timestamp GREATER_EQUAL from AND timestamp LESS_EQUAL until)
+            list(APPEND expected "${timestamp}:${data}")
+            break()
+        endif()
+    endforeach()
+endforeach()
+
+pcapng_read("${OUTPUT}" output)
+set(actual "")
+set(packet 0)
+foreach(data IN LISTS output_data)
+    list(GET output_timestamps ${packet} timestamp)
+    math(EXPR packet "${packet} + 1")
+    list(APPEND actual "${timestamp}:${data}")
+endforeach()
+if(NOT actual STREQUAL expected)
+    list(LENGTH triggers count)
+    message(FATAL_ERROR "${output_packets} packets around ${count} triggers:\n${actual}\nexpected:\n${expected}")
+endif()
+pcapng_check_statistics(output)
@@ -0,0 +1,45 @@
+# Converts the large INPUT with --trigger TRIGGER under --max-memory MAX_MEMORY, and fails if the
+# resident memory reported by --stats exceeds MAX_RESIDENT_MIB. The frames left out by the trigger
+# must still be counted: the statistics of the interfaces receive all OBJECTS of the input.
+#
+# Variables: CONVERTER, INPUT, OUTPUT, TRIGGER, OBJECTS, MAX_MEMORY, MAX_RESIDENT_MIB, optional THREADS
+
+include("${CMAKE_CURRENT_LIST_DIR}/pcapng.cmake")
+
+set(options "")
+if(DEFINED THREADS)
+    list(APPEND options "--threads" "${THREADS}")
+endif()
+
+file(REMOVE "${OUTPUT}")
+execute_process(
+    COMMAND "${CONVERTER}" ${options} "--trigger" "${TRIGGER}" "--pre" "10ms" "--post" "10ms"
+        "--max-memory" "${MAX_MEMORY}" "--stats" "${INPUT}" "${OUTPUT}"
+    RESULT_VARIABLE result
+    ERROR_VARIABLE errors
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Conversion of ${INPUT} failed:\n${errors}")
+endif()
+
+if(NOT errors MATCHES "Peak memory: ([0-9]+) MiB resident")
+    message(FATAL_ERROR "No peak memory in the statistics:\n${errors}")
+endif()
+set(resident ${CMAKE_MATCH_1})
+if(resident GREATER MAX_RESIDENT_MIB)
+    message(FATAL_ERROR "${resident} MiB resident, at most ${MAX_RESIDENT_MIB} MiB expected:\n${errors}")
+endif()
+
+pcapng_read("${OUTPUT}" output)
+if(output_packets EQUAL 0)
+    message(FATAL_ERROR "No packets around the triggers of ${INPUT}")
+endif()
+pcapng_check_statistics(output)
+set(received 0)
+foreach(count IN LISTS output_received)
+    math(EXPR received "${received} + ${count}")
+endforeach()
+if(NOT received EQUAL OBJECTS)
+    message(FATAL_ERROR "The statistics count ${received} received frames of ${OBJECTS}")
+endif()
+message(STATUS "${output_packets} packets, ${resident} MiB resident")
@@ -0,0 +1,19 @@
+# Converts INPUT, whose last container is cut off by the end of the file, and fails unless the
+# conversion reports the truncation and exits with an error, with and without --threads.
+#
+# Variables: CONVERTER, INPUT, OUTPUT
+
+foreach(threads 1 2)
+    file(REMOVE "${OUTPUT}")
+    execute_process(
+        COMMAND "${CONVERTER}" "--threads" "${threads}" "${INPUT}" "${OUTPUT}"
+        RESULT_VARIABLE result
+        ERROR_VARIABLE errors
+    )
+    if(result EQUAL 0)
+        message(FATAL_ERROR "Conversion of ${INPUT} with ${threads} threads succeeded:\n${errors}")
+    endif()
+    if(NOT errors MATCHES "Truncated container")
+        message(FATAL_ERROR "No truncation reported with ${threads} threads:\n${errors}")
+    endif()
+endforeach()
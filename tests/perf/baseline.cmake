@@ -0,0 +1,16 @@
+# Baseline of the perf.* tests: conversion throughput and peak resident memory per workload.
+#
+# The numbers only hold for the machine they were measured on, so none are committed and the
+# perf.* tests are skipped without them. The CI workflow does not gate on throughput: its shared
+# runners vary too much and it excludes the perf label. A change to the conversion path is gated
+# on a fixed machine instead, before it is merged:
+#   1. On the target branch, configure a Release build with -DBLF_PERF_UPDATE=ON and run
+#      ctest -C Release -L perf once to record the baseline in this file (do not commit it).
+#   2. Reconfigure with -DBLF_PERF_UPDATE=OFF, build the change and run ctest -C Release -L perf.
+#      Each workload fails if it is more than BLF_PERF_TOLERANCE percent slower, or uses that
+#      much more peak memory, than the baseline.
+# Keep the machine otherwise idle; BLF_PERF_TOLERANCE (default 25) covers the remaining noise.
+#
+# Each workload adds two lines:
+#   set(perf_<workload>_objects_per_second <measured>)
+#   set(perf_<workload>_peak_mib <measured>)
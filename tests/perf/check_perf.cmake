@@ -0,0 +1,60 @@
+# Converts a generated workload and compares its throughput and peak memory with the baseline.
+# Without a baseline for the workload the test is skipped.
+#
+# Variables: CONVERTER, WORKLOAD, INPUT, OUTPUT, BASELINE, TOLERANCE (percent), UPDATE (record as baseline)
+
+execute_process(
+    COMMAND "${CONVERTER}" "--stats" "${INPUT}" "${OUTPUT}"
+    RESULT_VARIABLE result
+    ERROR_VARIABLE stats
+)
+file(REMOVE "${OUTPUT}")
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Conversion of ${INPUT} failed:\n${stats}")
+endif()
+
+if(NOT stats MATCHES "Converted [0-9]+ objects in [0-9.]+ s, ([0-9]+) objects/s")
+    message(FATAL_ERROR "No throughput in the output:\n${stats}")
+endif()
+set(objects_per_second ${CMAKE_MATCH_1})
+if(NOT stats MATCHES "Peak memory: ([0-9]+) MiB resident")
+    message(FATAL_ERROR "No peak memory in the output:\n${stats}")
+endif()
+set(peak_mib ${CMAKE_MATCH_1})
+message(STATUS "${WORKLOAD}: ${objects_per_second} objects/s, ${peak_mib} MiB peak")
+
+if(UPDATE)
+    file(READ "${BASELINE}" baseline)
+    set(line_objects_per_second "set(perf_${WORKLOAD}_objects_per_second ${objects_per_second})")
+    set(line_peak_mib "set(perf_${WORKLOAD}_peak_mib ${peak_mib})")
+    if(baseline MATCHES "\nset\\(perf_${WORKLOAD}_objects_per_second [0-9]+\\)")
+        string(REGEX REPLACE "\nset\\(perf_${WORKLOAD}_objects_per_second [0-9]+\\)"
+            "\n${line_objects_per_second}" baseline "${baseline}")
+        string(REGEX REPLACE "\nset\\(perf_${WORKLOAD}_peak_mib [0-9]+\\)"
+            "\n${line_peak_mib}" baseline "${baseline}")
+    else()
+        string(APPEND baseline "\n${line_objects_per_second}\n${line_peak_mib}\n")
+    endif()
+    file(WRITE "${BASELINE}" "${baseline}")
+    message(STATUS "Recorded as baseline in ${BASELINE}")
+    return()
+endif()
+
+include("${BASELINE}")
+set(expected_objects_per_second ${perf_${WORKLOAD}_objects_per_second})
+set(expected_peak_mib ${perf_${WORKLOAD}_peak_mib})
+if(NOT DEFINED expected_objects_per_second OR NOT DEFINED expected_peak_mib)
+    # Matched by SKIP_REGULAR_EXPRESSION, the test is reported as skipped
+    message(STATUS "Skipped: no baseline for ${WORKLOAD} in ${BASELINE}. "
+        "Record one with -DBLF_PERF_UPDATE=ON and ctest -C Release -L perf")
+    return()
+endif()
+
+math(EXPR min_objects_per_second "${expected_objects_per_second} * (100 - ${TOLERANCE}) / 100")
+math(EXPR max_peak_mib "${expected_peak_mib} * (100 + ${TOLERANCE}) / 100")
+if(objects_per_second LESS min_objects_per_second)
+    message(FATAL_ERROR "${WORKLOAD}: ${objects_per_second} objects/s, baseline ${expected_objects_per_second} objects/s allows ${min_objects_per_second}")
+endif()
+if(peak_mib GREATER max_peak_mib)
+    message(FATAL_ERROR "${WORKLOAD}: ${peak_mib} MiB peak, baseline ${expected_peak_mib} MiB allows ${max_peak_mib}")
+endif()
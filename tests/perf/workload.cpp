@@ -0,0 +1,154 @@
+/*
+  Copyright (c) 2020 Technica Engineering GmbH
+  GNU General Public License v3.0+ (see LICENSE or https://www.gnu.org/licenses/gpl-3.0.txt)
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+
+#include <Vector/BLF.h>
+
+using namespace Vector::BLF;
+
+/// Fixed seed, every run writes the same objects
+#define WORKLOAD_SEED 20200101
+
+/* Deterministic workloads for the perf tests, the payload bytes repeat like real bus traffic */
+struct workload {
+	std::mt19937 random { WORKLOAD_SEED };
+	ULONGLONG ns = 0;
+
+	std::uint32_t next(std::uint32_t range) {
+		return random() % range;
+	}
+
+	template<class T>
+	T* stamp(T* obj) {
+		ns += 10000 + next(90000);
+		obj->objectFlags = ObjectHeader::ObjectFlags::TimeOneNans;
+		obj->objectTimeStamp = ns;
+		return obj;
+	}
+
+	ObjectHeaderBase* can() {
+		auto obj = stamp(new CanMessage2());
+		obj->channel = 1 + next(4);
+		obj->id = 0x100 + next(64);
+		obj->dlc = 8;
+		obj->data.assign(8, 0);
+		for (std::size_t i = 0; i < obj->data.size(); i++) {
+			obj->data[i] = (BYTE)(obj->id + i + (ns >> 20));
+		}
+		return obj;
+	}
+
+	ObjectHeaderBase* can_error() {
+		auto obj = stamp(new CanErrorFrame());
+		obj->channel = 1 + next(4);
+		obj->length = 0;
+		return obj;
+	}
+
+	ObjectHeaderBase* can_fd() {
+		auto obj = stamp(new CanFdMessage64());
+		obj->channel = 1 + next(4);
+		obj->id = 0x200 + next(64);
+		obj->dlc = 15;
+		obj->validDataBytes = 64;
+		obj->data.assign(64, 0);
+		for (std::size_t i = 0; i < obj->data.size(); i++) {
+			obj->data[i] = (BYTE)(obj->id + i);
+		}
+		return obj;
+	}
+
+	ObjectHeaderBase* ethernet(std::size_t length) {
+		auto obj = stamp(new EthernetFrameEx());
+		obj->channel = 1 + next(2);
+		obj->hardwareChannel = 1;
+		obj->dir = 0;
+		obj->frameData.assign(length, 0);
+		for (std::size_t i = 0; i < length; i++) {
+			obj->frameData[i] = (BYTE)(i * 7);
+		}
+		obj->frameLength = (WORD)length;
+		return obj;
+	}
+
+	ObjectHeaderBase* flexray() {
+		auto obj = stamp(new FlexRayVFrReceiveMsgEx());
+		obj->channel = 1;
+		obj->channelMask = 1 + next(2);
+		obj->frameId = 1 + next(100);
+		obj->cycle = (WORD)next(64);
+		obj->byteCount = 32;
+		obj->dataCount = 32;
+		obj->dataBytes.assign(32, 0);
+		for (std::size_t i = 0; i < obj->dataBytes.size(); i++) {
+			obj->dataBytes[i] = (BYTE)(obj->frameId + i);
+		}
+		return obj;
+	}
+
+	ObjectHeaderBase* lin() {
+		auto obj = stamp(new LinMessage());
+		obj->channel = 1;
+		obj->id = (BYTE)next(60);
+		obj->dlc = 8;
+		for (std::size_t i = 0; i < obj->data.size(); i++) {
+			obj->data[i] = (BYTE)(obj->id + i);
+		}
+		return obj;
+	}
+
+	ObjectHeaderBase* mixed() {
+		std::uint32_t kind = next(100);
+		if (kind < 60) return can();
+		if (kind < 75) return can_fd();
+		if (kind < 85) return lin();
+		if (kind < 95) return flexray();
+		return ethernet(1500);
+	}
+};
+
+int main(int argc, char* argv[]) {
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s can|ethernet|flexray|mixed|trigger|triggers outfile\n", argv[0]);
+		return 1;
+	}
+	std::string name = argv[1];
+	std::uint32_t count;
+	if (name == "can") count = 2000000;
+	else if (name == "ethernet") count = 20000;
+	else if (name == "flexray") count = 1000000;
+	else if (name == "mixed") count = 1000000;
+	else if (name == "trigger") count = 2000000;
+	else if (name == "triggers") count = 200;
+	else {
+		fprintf(stderr, "Unknown workload: %s\n", name.c_str());
+		return 1;
+	}
+
+	File file;
+	file.compressionLevel = 6;
+	file.open(argv[2], std::ios_base::out);
+	if (!file.is_open()) {
+		fprintf(stderr, "Unable to create: %s\n", argv[2]);
+		return 1;
+	}
+	workload w;
+	for (std::uint32_t i = 0; i < count; i++) {
+		if (name == "can") file.write(w.can());
+		else if (name == "ethernet") file.write(w.ethernet(9000));
+		else if (name == "flexray") file.write(w.flexray());
+		// CAN traffic with a rare error frame, most frames are left out by --trigger
+		else if (name == "trigger") file.write(i % 500000 == 250000 ? w.can_error() : w.can());
+		// Two error frames about 2 ms apart, within one batch of CAN messages
+		else if (name == "triggers") file.write(i == 100 || i == 140 ? w.can_error() : w.can());
+		else file.write(w.mixed());
+	}
+	file.close();
+	return 0;
+}